@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+
+"""
+Check that Recognizer.input_finished() decodes all of the audio without
+tail padding: Every frame is processed and no token is after the end of
+the audio.
+"""
+
+import wave
+
+import numpy as np
+import sherpa_ncnn
+
+
+def read_wave(filename: str):
+    with wave.open(filename) as f:
+        assert f.getnchannels() == 1, f.getnchannels()
+        assert f.getsampwidth() == 2, f.getsampwidth()  # it is in bytes
+        num_samples = f.getnframes()
+        samples = f.readframes(num_samples)
+        samples_int16 = np.frombuffer(samples, dtype=np.int16)
+        samples_float32 = samples_int16.astype(np.float32)
+
+        return samples_float32 / 32768, f.getframerate()
+
+
+def main():
+    d = "./sherpa-ncnn-conv-emformer-transducer-2022-12-06"
+    for i in range(5):
+        recognizer = sherpa_ncnn.Recognizer(
+            tokens=f"{d}/tokens.txt",
+            encoder_param=f"{d}/encoder_jit_trace-pnnx.ncnn.param",
+            encoder_bin=f"{d}/encoder_jit_trace-pnnx.ncnn.bin",
+            decoder_param=f"{d}/decoder_jit_trace-pnnx.ncnn.param",
+            decoder_bin=f"{d}/decoder_jit_trace-pnnx.ncnn.bin",
+            joiner_param=f"{d}/joiner_jit_trace-pnnx.ncnn.param",
+            joiner_bin=f"{d}/joiner_jit_trace-pnnx.ncnn.bin",
+            num_threads=2,
+        )
+
+        filename = f"{d}/test_wavs/{i}.wav"
+        samples, sample_rate = read_wave(filename)
+        duration = samples.shape[0] / sample_rate
+
+        recognizer.accept_waveform(sample_rate, samples)
+        recognizer.input_finished()
+
+        stream = recognizer.stream
+        assert stream.num_processed_frames == stream.num_frames_ready, (
+            filename,
+            stream.num_processed_frames,
+            stream.num_frames_ready,
+        )
+
+        assert recognizer.text, filename
+        for t in recognizer.timestamps:
+            assert t < duration, (filename, t, duration)
+
+        print(filename, recognizer.text)
+
+
+if __name__ == "__main__":
+    main()
@@ -63,8 +63,7 @@ def main():
         # simulate streaming by sleeping
         time.sleep(0.1)
 
-    tail_paddings = np.zeros(int(wave_file_sample_rate * 0.5), dtype=np.float32)
-    recognizer.accept_waveform(wave_file_sample_rate, tail_paddings)
+    # It decodes the remaining audio, so no tail padding is needed
     recognizer.input_finished()
     text = recognizer.text
     if text:
@@ -22,8 +22,11 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "sherpa-ncnn/c-api/fill-result-buffers.h"
 #include "sherpa-ncnn/csrc/display.h"
+#include "sherpa-ncnn/csrc/metrics.h"
 #include "sherpa-ncnn/csrc/model.h"
 #include "sherpa-ncnn/csrc/recognizer.h"
 #include "sherpa-ncnn/csrc/version.h"
@@ -38,6 +41,11 @@ struct SherpaNcnnRecognizer {
 
 struct SherpaNcnnStream {
   std::unique_ptr<sherpa_ncnn::Stream> stream;
+
+  // Tokens that FillNewTokens() failed to return since the buffers
+  // were too small
+  sherpa_ncnn::RecognitionResultDelta pending;
+  bool has_pending = false;
 };
 
 struct SherpaNcnnDisplay {
@@ -94,6 +102,11 @@ SherpaNcnnRecognizer *CreateRecognizer(
   config.feat_config.feature_dim =
       SHERPA_NCNN_OR(in_config->feat_config.feature_dim, 80);
 
+  if (!config.Validate()) {
+    NCNN_LOGE("Errors in config: %s", config.ToString().c_str());
+    return nullptr;
+  }
+
   auto recognizer = std::make_unique<sherpa_ncnn::Recognizer>(config);
 
   if (!recognizer->GetModel()) {
@@ -117,6 +130,25 @@ SherpaNcnnStream *CreateStream(SherpaNcnnRecognizer *p) {
 
 void DestroyStream(SherpaNcnnStream *s) { delete s; }
 
+SherpaNcnnStream *CreateStreamWithHotwords(SherpaNcnnRecognizer *p,
+                                           const char *hotwords) {
+  auto ans = new SherpaNcnnStream;
+  ans->stream = p->recognizer->CreateStream(hotwords ? hotwords : "");
+  return ans;
+}
+
+int32_t SetHotwords(SherpaNcnnRecognizer *p, const char *hotwords,
+                    int32_t update_existing_streams) {
+  return p->recognizer->SetHotwords(hotwords ? hotwords : "",
+                                    update_existing_streams != 0);
+}
+
+int32_t SetStreamHotwords(SherpaNcnnRecognizer *p, SherpaNcnnStream *s,
+                          const char *hotwords) {
+  return p->recognizer->SetHotwords(s->stream.get(),
+                                    hotwords ? hotwords : "");
+}
+
 void AcceptWaveform(SherpaNcnnStream *s, float sample_rate,
                     const float *samples, int32_t n) {
   s->stream->AcceptWaveform(sample_rate, samples, n);
@@ -130,9 +162,23 @@ void Decode(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
   p->recognizer->DecodeStream(s->stream.get());
 }
 
+void FinalizeStream(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
+  p->recognizer->FinalizeStream(s->stream.get());
+}
+
+void DecodeMultipleStreams(SherpaNcnnRecognizer *p, SherpaNcnnStream **streams,
+                           int32_t n) {
+  std::vector<sherpa_ncnn::Stream *> ss(n);
+  for (int32_t i = 0; i != n; ++i) {
+    ss[i] = streams[i]->stream.get();
+  }
+
+  p->recognizer->DecodeStreams(ss.data(), n);
+}
+
 SherpaNcnnResult *GetResult(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
-  std::string text = p->recognizer->GetResult(s->stream.get()).text;
   auto res = p->recognizer->GetResult(s->stream.get());
+  const std::string &text = res.text;
 
   auto r = new SherpaNcnnResult;
   r->text = new char[text.size() + 1];
@@ -140,10 +186,15 @@ SherpaNcnnResult *GetResult(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
   const_cast<char *>(r->text)[text.size()] = 0;
   r->count = res.tokens.size();
   if (r->count > 0) {
+    int32_t tokens_size = 0;
+    for (const auto &t : res.stokens) {
+      tokens_size += t.size() + 1;
+    }
+
     // Each word ends with nullptr
-    r->tokens = new char[text.size() + r->count];
+    r->tokens = new char[tokens_size];
     memset(reinterpret_cast<void *>(const_cast<char *>(r->tokens)), 0,
-           text.size() + r->count);
+           tokens_size);
     r->timestamps = new float[r->count];
     int pos = 0;
     for (int32_t i = 0; i < r->count; ++i) {
@@ -167,12 +218,81 @@ void DestroyResult(const SherpaNcnnResult *r) {
   delete r;
 }
 
+int32_t FillResult(SherpaNcnnRecognizer *p, SherpaNcnnStream *s,
+                   SherpaNcnnResultBuffers *r) {
+  auto res = p->recognizer->GetResult(s->stream.get());
+  r->start = 0;
+  r->num_stable_tokens = 0;
+  return sherpa_ncnn::FillResultBuffers(res.stokens, res.timestamps, r);
+}
+
+int32_t FillNewTokens(SherpaNcnnRecognizer *p, SherpaNcnnStream *s,
+                      SherpaNcnnResultBuffers *r) {
+  auto delta = p->recognizer->GetResultDelta(s->stream.get());
+
+  if (s->has_pending) {
+    // Merge the new delta into the one that has not been returned.
+    // delta.start >= pending.start since stable tokens never change.
+    auto &pending = s->pending;
+    int32_t keep = delta.start - pending.start;
+
+    pending.tokens.resize(keep);
+    pending.stokens.resize(keep);
+    pending.timestamps.resize(keep);
+
+    pending.tokens.insert(pending.tokens.end(), delta.tokens.begin(),
+                          delta.tokens.end());
+    pending.stokens.insert(pending.stokens.end(), delta.stokens.begin(),
+                           delta.stokens.end());
+    pending.timestamps.insert(pending.timestamps.end(),
+                              delta.timestamps.begin(), delta.timestamps.end());
+    pending.num_stable_tokens = delta.num_stable_tokens;
+  } else {
+    s->pending = std::move(delta);
+  }
+
+  const auto &d = s->pending;
+  r->start = d.start;
+  r->num_stable_tokens = d.num_stable_tokens;
+
+  int32_t ok = sherpa_ncnn::FillResultBuffers(d.stokens, d.timestamps, r);
+  s->has_pending = !ok;
+
+  return ok;
+}
+
 void Reset(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
   p->recognizer->Reset(s->stream.get());
+  s->has_pending = false;
 }
 
 void InputFinished(SherpaNcnnStream *s) { s->stream->InputFinished(); }
 
+const char *GetStats(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
+  std::string json = s ? s->stream->GetStatsReport().ToJson()
+                       : p->recognizer->GetStats().ToJson();
+
+  char *ans = new char[json.size() + 1];
+  std::copy(json.begin(), json.end(), ans);
+  ans[json.size()] = 0;
+  return ans;
+}
+
+void DestroyStats(const char *stats) { delete[] stats; }
+
+void ResetStats(SherpaNcnnRecognizer *p) { p->recognizer->ResetStats(); }
+
+const char *GetMetrics() {
+  std::string text = sherpa_ncnn::MetricsRegistry::Global().ToString();
+
+  char *ans = new char[text.size() + 1];
+  std::copy(text.begin(), text.end(), ans);
+  ans[text.size()] = 0;
+  return ans;
+}
+
+void DestroyMetrics(const char *metrics) { delete[] metrics; }
+
 int32_t IsEndpoint(SherpaNcnnRecognizer *p, SherpaNcnnStream *s) {
   return p->recognizer->IsEndpoint(s->stream.get());
 }
@@ -196,6 +196,9 @@ SHERPA_NCNN_API SherpaNcnnRecognizer *CreateRecognizer(
 
 /// Free a pointer returned by CreateRecognizer()
 ///
+/// Streams created by it may be destroyed before or after it, but they
+/// must not be passed to any function taking a recognizer afterwards.
+///
 /// @param p A pointer returned by CreateRecognizer()
 SHERPA_NCNN_API void DestroyRecognizer(SherpaNcnnRecognizer *p);
 
@@ -208,6 +211,45 @@ SHERPA_NCNN_API SherpaNcnnStream *CreateStream(SherpaNcnnRecognizer *p);
 
 SHERPA_NCNN_API void DestroyStream(SherpaNcnnStream *s);
 
+/// Create a stream with extra hotwords for this stream only.
+/// Used only when decoding_method is modified_beam_search.
+///
+/// @param p A pointer returned by CreateRecognizer
+/// @param hotwords Hotwords separated by /, e.g., "HELLO WORLD/HI :2.0".
+///                 Each hotword is either tokens separated by spaces or
+///                 text, which is split into tokens of the model. An
+///                 optional boosting score starting with : can follow it.
+/// @return Return a pointer to a stream. The caller MUST invoke
+///         DestroyStream at the end to avoid memory leak.
+SHERPA_NCNN_API SherpaNcnnStream *CreateStreamWithHotwords(
+    SherpaNcnnRecognizer *p, const char *hotwords);
+
+/// Replace the hotwords shared by all streams without recreating the
+/// recognizer. It can be called from a thread other than the one
+/// calling Decode().
+///
+/// @param p A pointer returned by CreateRecognizer
+/// @param hotwords Same format as in CreateStreamWithHotwords(). An empty
+///                 string removes all hotwords.
+/// @param update_existing_streams If 1, existing streams use the new
+///                                hotwords after their next Decode().
+///                                If 0, only new streams use them.
+/// @return Return 1 on success. Return 0 if hotwords are invalid.
+SHERPA_NCNN_API int32_t SetHotwords(SherpaNcnnRecognizer *p,
+                                    const char *hotwords,
+                                    int32_t update_existing_streams);
+
+/// Replace the hotwords of a single stream. It must not be called
+/// while the stream is being decoded.
+///
+/// @param p A pointer returned by CreateRecognizer
+/// @param s A pointer returned by CreateStream()
+/// @param hotwords Same format as in CreateStreamWithHotwords().
+/// @return Return 1 on success. Return 0 if hotwords are invalid.
+SHERPA_NCNN_API int32_t SetStreamHotwords(SherpaNcnnRecognizer *p,
+                                          SherpaNcnnStream *s,
+                                          const char *hotwords);
+
 /// Accept input audio samples and compute the features.
 ///
 /// @param s  A pointer returned by CreateStream().
@@ -240,6 +282,29 @@ SHERPA_NCNN_API int32_t IsReady(SherpaNcnnRecognizer *p, SherpaNcnnStream *s);
 /// @param s A pointer returned by CreateStream()
 SHERPA_NCNN_API void Decode(SherpaNcnnRecognizer *p, SherpaNcnnStream *s);
 
+/// Decode all remaining audio of a stream after InputFinished() without
+/// the need to append silence to it. The result returned by GetResult()
+/// afterwards is final.
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param s A pointer returned by CreateStream()
+SHERPA_NCNN_API void FinalizeStream(SherpaNcnnRecognizer *p,
+                                    SherpaNcnnStream *s);
+
+/// Decode one chunk of each stream that is ready. Streams that are not
+/// ready are skipped. It is equivalent to, but cheaper than, calling
+/// IsReady() and Decode() on each stream.
+///
+/// The common usage is:
+///   DecodeMultipleStreams(p, streams, n);
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param streams An array of n pointers returned by CreateStream()
+/// @param n Number of streams in the array.
+SHERPA_NCNN_API void DecodeMultipleStreams(SherpaNcnnRecognizer *p,
+                                           SherpaNcnnStream **streams,
+                                           int32_t n);
+
 /// Get the decoding results so far.
 ///
 /// @param p A pointer returned by CreateRecognizer().
@@ -254,6 +319,81 @@ SHERPA_NCNN_API SherpaNcnnResult *GetResult(SherpaNcnnRecognizer *p,
 /// @param r A pointer returned by GetResult()
 SHERPA_NCNN_API void DestroyResult(const SherpaNcnnResult *r);
 
+/// Buffers provided by the caller for FillResult() and FillNewTokens().
+/// The caller owns all of the memory, so nothing has to be freed after
+/// each call and the buffers can be reused across calls.
+///
+/// A buffer with capacity 0 is not requested, e.g., set only text and
+/// text_capacity if tokens and timestamps are not needed.
+SHERPA_NCNN_API typedef struct SherpaNcnnResultBuffers {
+  /// [in] Buffer for the text. If text_capacity > 0, the text is
+  /// always terminated by 0, even if it is truncated.
+  /// It can be NULL if text_capacity is 0.
+  char *text;
+  int32_t text_capacity;
+
+  /// [in] Buffer for tokens. Each token is followed by 0.
+  /// It can be NULL if tokens_capacity is 0.
+  char *tokens;
+  int32_t tokens_capacity;
+
+  /// [in] Buffer for the timestamps of tokens in seconds.
+  /// It can be NULL if timestamps_capacity is 0.
+  float *timestamps;
+  int32_t timestamps_capacity;
+
+  /// [out] Length of the text in bytes, excluding the terminating 0
+  int32_t text_size;
+
+  /// [out] Number of bytes of all tokens, including the terminating 0s
+  int32_t tokens_size;
+
+  /// [out] Number of tokens
+  int32_t count;
+
+  /// [out] Set only by FillNewTokens(). Index of the first returned token
+  /// in the result of the utterance. Tokens with index >= start returned
+  /// by previous calls should be replaced by the returned tokens.
+  int32_t start;
+
+  /// [out] Set only by FillNewTokens(). Tokens with index <
+  /// num_stable_tokens in the result of the utterance won't change any
+  /// more.
+  int32_t num_stable_tokens;
+} SherpaNcnnResultBuffers;
+
+/// Get the decoding results so far into buffers provided by the caller.
+///
+/// @param p A pointer returned by CreateRecognizer().
+/// @param s A pointer returned by CreateStream()
+/// @param r Buffers for the result. On return, its text_size, tokens_size
+///          and count fields are set to the sizes of the full result even
+///          if some of the buffers are too small.
+/// @return Return 1 if all of the requested buffers are large enough.
+///         Return 0 if any of them is truncated, in which case the caller
+///         can enlarge them according to the [out] fields and call it
+///         again.
+SHERPA_NCNN_API int32_t FillResult(SherpaNcnnRecognizer *p,
+                                   SherpaNcnnStream *s,
+                                   SherpaNcnnResultBuffers *r);
+
+/// Same as FillResult(), but it returns only tokens that are new or may
+/// have changed since the last call of this function for the stream, or
+/// since the stream was created or Reset(). The text is the concatenation
+/// of the returned tokens. Its cost does not depend on the length of the
+/// utterance.
+///
+/// With greedy_search, returned tokens never change. With
+/// modified_beam_search, tokens after r->num_stable_tokens may be changed
+/// by later chunks. They are returned again in that case, starting at
+/// r->start.
+///
+/// If the buffers are too small, the tokens will be returned again in the
+/// next call.
+SHERPA_NCNN_API int32_t FillNewTokens(SherpaNcnnRecognizer *p,
+                                      SherpaNcnnStream *s,
+                                      SherpaNcnnResultBuffers *r);
+
 /// Reset a stream
 ///
 /// @param p A pointer returned by CreateRecognizer().
@@ -278,6 +418,36 @@ SHERPA_NCNN_API void InputFinished(SherpaNcnnStream *s);
 SHERPA_NCNN_API int32_t IsEndpoint(SherpaNcnnRecognizer *p,
                                    SherpaNcnnStream *s);
 
+/// Get the time spent in each stage, i.e., feature, encoder, decoder,
+/// joiner, and search, as a JSON string.
+///
+/// All numbers are 0 if sherpa-ncnn is built with
+/// -DSHERPA_NCNN_ENABLE_STATS=OFF.
+///
+/// @param p A pointer returned by CreateRecognizer()
+/// @param s A pointer returned by CreateStream(). If it is NULL, statistics
+///          of all streams of the recognizer are returned.
+/// @return A JSON string. The user has to invoke DestroyStats() to free it.
+SHERPA_NCNN_API const char *GetStats(SherpaNcnnRecognizer *p,
+                                     SherpaNcnnStream *s);
+
+/// Free the pointer returned by GetStats().
+SHERPA_NCNN_API void DestroyStats(const char *stats);
+
+/// Clear the statistics of the recognizer, but not those of its streams.
+SHERPA_NCNN_API void ResetStats(SherpaNcnnRecognizer *p);
+
+/// Get metrics of all recognizers, VADs and TTS engines in this process,
+/// e.g., number of active streams and decoding latency, in the Prometheus
+/// text exposition format. It can be served on an HTTP endpoint or
+/// saved to a file.
+///
+/// @return The user has to invoke DestroyMetrics() to free it.
+SHERPA_NCNN_API const char *GetMetrics();
+
+/// Free the pointer returned by GetMetrics().
+SHERPA_NCNN_API void DestroyMetrics(const char *metrics);
+
 // for displaying results on Linux/macOS.
 SHERPA_NCNN_API typedef struct SherpaNcnnDisplay SherpaNcnnDisplay;
 
@@ -0,0 +1,54 @@
+// sherpa-ncnn/c-api/fill-result-buffers.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/c-api/fill-result-buffers.h"
+
+#include <algorithm>
+
+namespace sherpa_ncnn {
+
+int32_t FillResultBuffers(const std::vector<std::string> &stokens,
+                          const std::vector<float> &timestamps,
+                          SherpaNcnnResultBuffers *r) {
+  r->count = stokens.size();
+  r->text_size = 0;
+  r->tokens_size = 0;
+
+  // Number of bytes of the text that are copied. Tokens that don't fit
+  // are not copied partially.
+  int32_t text_copied = 0;
+
+  for (int32_t i = 0; i != r->count; ++i) {
+    const std::string &t = stokens[i];
+    int32_t n = t.size();
+
+    // the text is the concatenation of all tokens
+    if (r->text_size + n < r->text_capacity) {
+      std::copy(t.begin(), t.end(), r->text + r->text_size);
+      text_copied += n;
+    }
+    r->text_size += n;
+
+    if (r->tokens_size + n + 1 <= r->tokens_capacity) {
+      std::copy(t.begin(), t.end(), r->tokens + r->tokens_size);
+      r->tokens[r->tokens_size + n] = 0;
+    }
+    r->tokens_size += n + 1;
+
+    if (i < r->timestamps_capacity &&
+        i < static_cast<int32_t>(timestamps.size())) {
+      r->timestamps[i] = timestamps[i];
+    }
+  }
+
+  if (r->text_capacity > 0) {
+    r->text[text_copied] = 0;
+  }
+
+  return (r->text_capacity == 0 || r->text_size < r->text_capacity) &&
+         (r->tokens_capacity == 0 || r->tokens_size <= r->tokens_capacity) &&
+         (r->timestamps_capacity == 0 || r->count <= r->timestamps_capacity);
+}
+
+}  // namespace sherpa_ncnn
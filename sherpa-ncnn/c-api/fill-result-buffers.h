@@ -0,0 +1,29 @@
+// sherpa-ncnn/c-api/fill-result-buffers.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_C_API_FILL_RESULT_BUFFERS_H_
+#define SHERPA_NCNN_C_API_FILL_RESULT_BUFFERS_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/c-api/c-api.h"
+
+namespace sherpa_ncnn {
+
+/** Copy the given tokens and their timestamps to the buffers of r and set
+ * the [out] fields of r. A buffer with capacity 0 is not requested. It is
+ * not written to and its size does not affect the return value.
+ *
+ * @return Return 1 if all of the requested buffers are large enough.
+ *         Return 0 otherwise.
+ */
+int32_t FillResultBuffers(const std::vector<std::string> &stokens,
+                          const std::vector<float> &timestamps,
+                          SherpaNcnnResultBuffers *r);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_C_API_FILL_RESULT_BUFFERS_H_
@@ -0,0 +1,120 @@
+// sherpa-ncnn/c-api/test-fill-result-buffers.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+// FillResult() and FillNewTokens() return the value of
+// FillResultBuffers(). FillNewTokens() returns the same tokens again in
+// the next call if it is 0.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/c-api/fill-result-buffers.h"
+
+static int32_t num_failures = 0;
+
+static void Expect(bool ok, const char *name, const char *what) {
+  if (!ok) {
+    fprintf(stderr, "%s: %s\n", name, what);
+    ++num_failures;
+  }
+}
+
+static const std::vector<std::string> kTokens = {"▁HE", "LL", "O"};
+static const std::vector<float> kTimestamps = {0.1f, 0.2f, 0.3f};
+
+// "▁HELLO" in UTF-8
+static const char *kText = "\xe2\x96\x81HELLO";
+
+static void TestTextOnly() {
+  const char *name = "TestTextOnly";
+
+  char text[64];
+  SherpaNcnnResultBuffers r;
+  memset(&r, 0, sizeof(r));
+  r.text = text;
+  r.text_capacity = sizeof(text);
+
+  int32_t ok = sherpa_ncnn::FillResultBuffers(kTokens, kTimestamps, &r);
+  Expect(ok == 1, name, "it should return 1");
+  Expect(strcmp(text, kText) == 0, name, "wrong text");
+  Expect(r.text_size == static_cast<int32_t>(strlen(kText)), name,
+         "wrong text_size");
+  Expect(r.count == 3, name, "wrong count");
+}
+
+static void TestTokensOnly() {
+  const char *name = "TestTokensOnly";
+
+  char tokens[64];
+  SherpaNcnnResultBuffers r;
+  memset(&r, 0, sizeof(r));
+  r.tokens = tokens;
+  r.tokens_capacity = sizeof(tokens);
+
+  int32_t ok = sherpa_ncnn::FillResultBuffers(kTokens, kTimestamps, &r);
+  Expect(ok == 1, name, "it should return 1");
+  Expect(r.count == 3, name, "wrong count");
+
+  int32_t expected_size = 0;
+  const char *p = tokens;
+  for (const auto &t : kTokens) {
+    Expect(t == p, name, "wrong token");
+    p += t.size() + 1;
+    expected_size += t.size() + 1;
+  }
+  Expect(r.tokens_size == expected_size, name, "wrong tokens_size");
+}
+
+static void TestTimestampsOnly() {
+  const char *name = "TestTimestampsOnly";
+
+  float timestamps[3];
+  SherpaNcnnResultBuffers r;
+  memset(&r, 0, sizeof(r));
+  r.timestamps = timestamps;
+  r.timestamps_capacity = 3;
+
+  int32_t ok = sherpa_ncnn::FillResultBuffers(kTokens, kTimestamps, &r);
+  Expect(ok == 1, name, "it should return 1");
+  Expect(std::vector<float>(timestamps, timestamps + 3) == kTimestamps, name,
+         "wrong timestamps");
+}
+
+static void TestTruncated() {
+  const char *name = "TestTruncated";
+
+  // Room for "▁HE" and the terminating 0, but not for "LL"
+  char text[6];
+  char tokens[64];
+  SherpaNcnnResultBuffers r;
+  memset(&r, 0, sizeof(r));
+  r.text = text;
+  r.text_capacity = sizeof(text);
+  r.tokens = tokens;
+  r.tokens_capacity = sizeof(tokens);
+
+  int32_t ok = sherpa_ncnn::FillResultBuffers(kTokens, kTimestamps, &r);
+  Expect(ok == 0, name, "it should return 0");
+  Expect(strcmp(text, "\xe2\x96\x81HE") == 0, name, "wrong truncated text");
+  Expect(r.text_size == static_cast<int32_t>(strlen(kText)), name,
+         "text_size should be the size of the full text");
+}
+
+int32_t main() {
+  TestTextOnly();
+  TestTokensOnly();
+  TestTimestampsOnly();
+  TestTruncated();
+
+  if (num_failures != 0) {
+    fprintf(stderr, "%d test(s) failed\n", num_failures);
+    return -1;
+  }
+
+  return 0;
+}
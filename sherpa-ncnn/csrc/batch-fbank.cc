@@ -0,0 +1,633 @@
+// sherpa-ncnn/csrc/batch-fbank.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/batch-fbank.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+namespace sherpa_ncnn {
+
+// Number of frames that are processed together. Loops over the frames of
+// a batch have a fixed trip count and access consecutive floats, so they
+// are compiled to SIMD instructions (4 lanes for NEON/SSE, 8 for AVX).
+static constexpr int32_t kLanes = 8;
+
+static int32_t RoundUpToNearestPowerOfTwo(int32_t n) {
+  int32_t ans = 1;
+  while (ans < n) {
+    ans <<= 1;
+  }
+  return ans;
+}
+
+static float MelScale(float freq) {
+  return 1127.0f * logf(1.0f + freq / 700.0f);
+}
+
+static int32_t WindowSize(const knf::FrameExtractionOptions &opts) {
+  return static_cast<int32_t>(opts.samp_freq * 0.001 * opts.frame_length_ms);
+}
+
+static int32_t WindowShift(const knf::FrameExtractionOptions &opts) {
+  return static_cast<int32_t>(opts.samp_freq * 0.001 * opts.frame_shift_ms);
+}
+
+static int32_t PaddedWindowSize(const knf::FrameExtractionOptions &opts) {
+  return opts.round_to_power_of_two
+             ? RoundUpToNearestPowerOfTwo(WindowSize(opts))
+             : WindowSize(opts);
+}
+
+std::shared_ptr<const BatchFbank> BatchFbank::Get(
+    const knf::FbankOptions &opts) {
+  if (!IsSupported(opts)) {
+    return nullptr;
+  }
+
+  const auto &f = opts.frame_opts;
+  const auto &m = opts.mel_opts;
+
+  using Key = std::tuple<float, float, float, float, bool, std::string, bool,
+                         float, bool, int32_t, float, float, bool, bool>;
+
+  // Like filter banks of the resampler, there are only a few
+  // combinations of options in a process, so objects are never removed.
+  static std::mutex mutex;
+  static std::map<Key, std::shared_ptr<const BatchFbank>> cache;
+
+  Key key{f.samp_freq,
+          f.frame_shift_ms,
+          f.frame_length_ms,
+          f.preemph_coeff,
+          f.remove_dc_offset,
+          f.window_type,
+          f.round_to_power_of_two,
+          f.blackman_coeff,
+          f.snip_edges,
+          m.num_bins,
+          m.low_freq,
+          m.high_freq,
+          opts.use_log_fbank,
+          opts.use_power};
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &ans = cache[key];
+  if (!ans) {
+    ans.reset(new BatchFbank(opts));
+  }
+
+  return ans;
+}
+
+bool BatchFbank::IsSupported(const knf::FbankOptions &opts) {
+  const auto &f = opts.frame_opts;
+  const auto &m = opts.mel_opts;
+
+  if (f.dither != 0 || m.is_librosa || m.htk_mode || opts.use_energy) {
+    return false;
+  }
+
+  if (f.window_type != "povey" && f.window_type != "hamming" &&
+      f.window_type != "hanning" && f.window_type != "sine" &&
+      f.window_type != "rectangular" && f.window_type != "blackman") {
+    return false;
+  }
+
+  int32_t frame_length = WindowSize(f);
+  int32_t padded_length = PaddedWindowSize(f);
+
+  // The FFT below needs a power of two not less than 4
+  return frame_length > 1 && WindowShift(f) > 0 && m.num_bins > 0 &&
+         padded_length >= 4 && (padded_length & (padded_length - 1)) == 0;
+}
+
+BatchFbank::BatchFbank(const knf::FbankOptions &opts)
+    : opts_(opts),
+      frame_length_(WindowSize(opts.frame_opts)),
+      frame_shift_(WindowShift(opts.frame_opts)),
+      padded_length_(PaddedWindowSize(opts.frame_opts)),
+      num_bins_(opts.mel_opts.num_bins) {
+  InitWindow(opts.frame_opts);
+  InitFft();
+  InitMelBanks(opts.mel_opts, opts.frame_opts.samp_freq);
+}
+
+void BatchFbank::InitWindow(const knf::FrameExtractionOptions &opts) {
+  window_.resize(frame_length_);
+
+  double a = 2 * M_PI / (frame_length_ - 1);
+  for (int32_t i = 0; i != frame_length_; ++i) {
+    double x = a * i;
+    if (opts.window_type == "hanning") {
+      window_[i] = 0.5 - 0.5 * cos(x);
+    } else if (opts.window_type == "sine") {
+      window_[i] = sin(0.5 * x);
+    } else if (opts.window_type == "hamming") {
+      window_[i] = 0.54 - 0.46 * cos(x);
+    } else if (opts.window_type == "povey") {
+      window_[i] = pow(0.5 - 0.5 * cos(x), 0.85);
+    } else if (opts.window_type == "rectangular") {
+      window_[i] = 1.0;
+    } else {  // blackman
+      window_[i] = opts.blackman_coeff - 0.5 * cos(x) +
+                   (0.5 - opts.blackman_coeff) * cos(2 * x);
+    }
+  }
+}
+
+void BatchFbank::InitFft() {
+  // A real FFT of size N is computed with a complex FFT of size N/2
+  int32_t n = padded_length_ / 2;
+
+  fft_cos_.resize(n / 2);
+  fft_sin_.resize(n / 2);
+  for (int32_t i = 0; i != n / 2; ++i) {
+    fft_cos_[i] = cos(2 * M_PI * i / n);
+    fft_sin_[i] = sin(2 * M_PI * i / n);
+  }
+
+  rfft_cos_.resize(n);
+  rfft_sin_.resize(n);
+  for (int32_t i = 0; i != n; ++i) {
+    rfft_cos_[i] = cos(2 * M_PI * i / padded_length_);
+    rfft_sin_[i] = sin(2 * M_PI * i / padded_length_);
+  }
+
+  int32_t num_bits = 0;
+  while ((1 << num_bits) < n) {
+    ++num_bits;
+  }
+
+  bit_reverse_.resize(n);
+  for (int32_t i = 0; i != n; ++i) {
+    int32_t r = 0;
+    for (int32_t b = 0; b != num_bits; ++b) {
+      r |= ((i >> b) & 1) << (num_bits - 1 - b);
+    }
+    bit_reverse_[i] = r;
+  }
+}
+
+// Same as MelBanks in kaldi-native-fbank without VTLN
+void BatchFbank::InitMelBanks(const knf::MelBanksOptions &opts,
+                              float samp_freq) {
+  int32_t num_fft_bins = padded_length_ / 2;
+  float nyquist = 0.5f * samp_freq;
+
+  float low_freq = opts.low_freq;
+  float high_freq =
+      opts.high_freq > 0 ? opts.high_freq : nyquist + opts.high_freq;
+
+  float fft_bin_width = samp_freq / padded_length_;
+
+  float mel_low_freq = MelScale(low_freq);
+  float mel_high_freq = MelScale(high_freq);
+  float mel_freq_delta = (mel_high_freq - mel_low_freq) / (num_bins_ + 1);
+
+  mel_first_.resize(num_bins_);
+  mel_size_.resize(num_bins_);
+  mel_offset_.resize(num_bins_);
+
+  for (int32_t bin = 0; bin != num_bins_; ++bin) {
+    float left_mel = mel_low_freq + bin * mel_freq_delta;
+    float center_mel = mel_low_freq + (bin + 1) * mel_freq_delta;
+    float right_mel = mel_low_freq + (bin + 2) * mel_freq_delta;
+
+    mel_first_[bin] = 0;
+    mel_size_[bin] = 0;
+    mel_offset_[bin] = mel_weights_.size();
+
+    for (int32_t i = 0; i != num_fft_bins; ++i) {
+      float mel = MelScale(fft_bin_width * i);
+      if (mel <= left_mel || mel >= right_mel) {
+        continue;
+      }
+
+      float weight = mel <= center_mel
+                         ? (mel - left_mel) / (center_mel - left_mel)
+                         : (right_mel - mel) / (right_mel - center_mel);
+
+      if (mel_size_[bin] == 0) {
+        mel_first_[bin] = i;
+      }
+
+      // Weights of a bin are contiguous, so no gaps are filled here
+      mel_weights_.push_back(weight);
+      mel_size_[bin] += 1;
+    }
+  }
+}
+
+int32_t BatchFbank::NumFrames(int64_t num_samples, bool flush) const {
+  if (opts_.frame_opts.snip_edges) {
+    if (num_samples < frame_length_) {
+      return 0;
+    }
+    return 1 + (num_samples - frame_length_) / frame_shift_;
+  }
+
+  int32_t num_frames = (num_samples + frame_shift_ / 2) / frame_shift_;
+  if (flush) {
+    return num_frames;
+  }
+
+  // Don't count frames that would be extended by reflection at the end
+  int64_t end_sample_of_last_frame =
+      FirstSampleOfFrame(num_frames - 1) + frame_length_;
+  while (num_frames > 0 && end_sample_of_last_frame > num_samples) {
+    num_frames -= 1;
+    end_sample_of_last_frame -= frame_shift_;
+  }
+
+  return num_frames;
+}
+
+int64_t BatchFbank::FirstSampleOfFrame(int32_t frame) const {
+  if (opts_.frame_opts.snip_edges) {
+    return static_cast<int64_t>(frame) * frame_shift_;
+  }
+
+  int64_t midpoint_of_frame =
+      static_cast<int64_t>(frame_shift_) * frame + frame_shift_ / 2;
+  return midpoint_of_frame - frame_length_ / 2;
+}
+
+void BatchFbank::Compute(const float *const *frames, int32_t n,
+                         float *const *out) const {
+  int32_t half = padded_length_ / 2;
+  std::vector<float> scratch(3 * half * kLanes + padded_length_);
+
+  // Frames that do not fill all lanes are computed with fewer lanes, so
+  // that no time is spent on empty lanes
+  int32_t start = 0;
+  for (; n - start >= kLanes; start += kLanes) {
+    ComputeLanes<kLanes>(frames + start, out + start, scratch.data());
+  }
+
+  if (n - start >= kLanes / 2) {
+    ComputeLanes<kLanes / 2>(frames + start, out + start, scratch.data());
+    start += kLanes / 2;
+  }
+
+  for (; start < n; ++start) {
+    ComputeLanes<1>(frames + start, out + start, scratch.data());
+  }
+}
+
+template <int32_t L>
+void BatchFbank::ComputeLanes(const float *const *frames, float *const *out,
+                              float *scratch) const {
+  const auto &frame_opts = opts_.frame_opts;
+  int32_t half = padded_length_ / 2;
+
+  // Element j of lane l is at re[j * L + l] and im[j * L + l]
+  float *re = scratch;
+  float *im = re + half * L;
+  float *power = im + half * L;
+  float *window = power + half * L;
+
+  std::fill(window + frame_length_, window + padded_length_, 0);
+
+  // Step 1: Pre-process each frame and pack sample 2j + 1 as the
+  // imaginary part of sample 2j. Samples are stored in bit reversed order
+  // for the FFT.
+  for (int32_t l = 0; l != L; ++l) {
+    std::copy(frames[l], frames[l] + frame_length_, window);
+
+    if (frame_opts.remove_dc_offset) {
+      float sum = 0;
+      for (int32_t i = 0; i != frame_length_; ++i) {
+        sum += window[i];
+      }
+
+      float mean = sum / frame_length_;
+      for (int32_t i = 0; i != frame_length_; ++i) {
+        window[i] -= mean;
+      }
+    }
+
+    float preemph_coeff = frame_opts.preemph_coeff;
+    if (preemph_coeff != 0) {
+      for (int32_t i = frame_length_ - 1; i > 0; --i) {
+        window[i] -= preemph_coeff * window[i - 1];
+      }
+      window[0] -= preemph_coeff * window[0];
+    }
+
+    for (int32_t i = 0; i != frame_length_; ++i) {
+      window[i] *= window_[i];
+    }
+
+    for (int32_t j = 0; j != half; ++j) {
+      int32_t k = bit_reverse_[j] * L + l;
+      re[k] = window[2 * j];
+      im[k] = window[2 * j + 1];
+    }
+  }
+
+  // Step 2: Complex FFT of size half on all lanes
+  for (int32_t size = 2; size <= half; size *= 2) {
+    int32_t m = size / 2;
+    int32_t step = half / size;
+    for (int32_t start = 0; start < half; start += size) {
+      for (int32_t j = 0; j != m; ++j) {
+        float c = fft_cos_[j * step];
+        float s = fft_sin_[j * step];
+
+        float *ar = re + (start + j) * L;
+        float *ai = im + (start + j) * L;
+        float *br = re + (start + j + m) * L;
+        float *bi = im + (start + j + m) * L;
+
+        for (int32_t l = 0; l != L; ++l) {
+          // b * exp(-2 pi i j / size)
+          float tr = br[l] * c + bi[l] * s;
+          float ti = bi[l] * c - br[l] * s;
+          br[l] = ar[l] - tr;
+          bi[l] = ai[l] - ti;
+          ar[l] += tr;
+          ai[l] += ti;
+        }
+      }
+    }
+  }
+
+  // Step 3: Power spectrum of the real FFT. Bin k of the real FFT is
+  // computed from bins k and half - k of the complex FFT.
+  for (int32_t l = 0; l != L; ++l) {
+    float dc = re[l] + im[l];
+    power[l] = dc * dc;
+  }
+
+  for (int32_t k = 1; k != half; ++k) {
+    float c = rfft_cos_[k];
+    float s = rfft_sin_[k];
+
+    const float *ar = re + k * L;
+    const float *ai = im + k * L;
+    const float *br = re + (half - k) * L;
+    const float *bi = im + (half - k) * L;
+    float *p = power + k * L;
+
+    for (int32_t l = 0; l != L; ++l) {
+      // even part
+      float er = 0.5f * (ar[l] + br[l]);
+      float ei = 0.5f * (ai[l] - bi[l]);
+
+      // odd part
+      float or_ = 0.5f * (ai[l] + bi[l]);
+      float oi = -0.5f * (ar[l] - br[l]);
+
+      // even + odd * exp(-2 pi i k / padded_length_)
+      float xr = er + or_ * c + oi * s;
+      float xi = ei + oi * c - or_ * s;
+
+      p[l] = xr * xr + xi * xi;
+    }
+  }
+
+  if (!opts_.use_power) {
+    for (int32_t i = 0; i != half * L; ++i) {
+      power[i] = std::sqrt(power[i]);
+    }
+  }
+
+  // Step 4: Mel projection. Each weight is applied to all lanes at once.
+  float energies[L];
+  const float epsilon = std::numeric_limits<float>::epsilon();
+
+  for (int32_t bin = 0; bin != num_bins_; ++bin) {
+    std::fill(energies, energies + L, 0);
+
+    const float *w = mel_weights_.data() + mel_offset_[bin];
+    const float *p = power + mel_first_[bin] * L;
+    for (int32_t i = 0; i != mel_size_[bin]; ++i, p += L) {
+      for (int32_t l = 0; l != L; ++l) {
+        energies[l] += w[i] * p[l];
+      }
+    }
+
+    for (int32_t l = 0; l != L; ++l) {
+      float e = energies[l];
+      if (opts_.use_log_fbank) {
+        e = std::log(std::max(e, epsilon));
+      }
+
+      out[l][bin] = e;
+    }
+  }
+}
+
+OnlineBatchFbank::OnlineBatchFbank(const knf::FbankOptions &opts)
+    : computer_(BatchFbank::Get(opts)),
+      sampling_rate_(opts.frame_opts.samp_freq) {
+  if (!computer_) {
+    fallback_ = std::make_unique<knf::OnlineFbank>(opts);
+  }
+}
+
+int32_t OnlineBatchFbank::Dim() const {
+  return computer_ ? computer_->Dim() : fallback_->Dim();
+}
+
+int32_t OnlineBatchFbank::NumFramesReady() const {
+  return computer_ ? num_frames_ : fallback_->NumFramesReady();
+}
+
+const float *OnlineBatchFbank::GetFrame(int32_t frame) const {
+  if (!computer_) {
+    return fallback_->GetFrame(frame);
+  }
+
+  assert(frame >= num_popped_frames_ && frame < num_frames_);
+
+  return features_.data() +
+         static_cast<int64_t>(frame - num_popped_frames_) * computer_->Dim();
+}
+
+void OnlineBatchFbank::AcceptWaveform(float sampling_rate,
+                                      const float *waveform, int32_t n) {
+  if (!computer_) {
+    fallback_->AcceptWaveform(sampling_rate, waveform, n);
+    return;
+  }
+
+  waveform_.insert(waveform_.end(), waveform, waveform + n);
+  ComputeFeatures();
+}
+
+void OnlineBatchFbank::AcceptWaveforms(OnlineBatchFbank *const *fbanks,
+                                       int32_t n,
+                                       const float *const *waveforms,
+                                       const int32_t *num_samples) {
+  std::vector<OnlineBatchFbank *> batch;
+  for (int32_t i = 0; i != n; ++i) {
+    OnlineBatchFbank *f = fbanks[i];
+    if (!f->computer_) {
+      f->fallback_->AcceptWaveform(f->sampling_rate_, waveforms[i],
+                                   num_samples[i]);
+      continue;
+    }
+
+    f->waveform_.insert(f->waveform_.end(), waveforms[i],
+                        waveforms[i] + num_samples[i]);
+    batch.push_back(f);
+  }
+
+  // Objects with the same options share a BatchFbank
+  std::stable_sort(batch.begin(), batch.end(),
+                   [](const OnlineBatchFbank *a, const OnlineBatchFbank *b) {
+                     return std::less<const BatchFbank *>()(
+                         a->computer_.get(), b->computer_.get());
+                   });
+
+  int32_t num_batch = batch.size();
+  for (int32_t start = 0; start < num_batch;) {
+    int32_t end = start + 1;
+    while (end < num_batch &&
+           batch[end]->computer_ == batch[start]->computer_) {
+      ++end;
+    }
+
+    ComputeFeatures(batch.data() + start, end - start);
+    start = end;
+  }
+}
+
+void OnlineBatchFbank::InputFinished() {
+  if (!computer_) {
+    fallback_->InputFinished();
+    return;
+  }
+
+  input_finished_ = true;
+  ComputeFeatures();
+}
+
+void OnlineBatchFbank::Pop(int32_t n) {
+  if (!computer_) {
+    fallback_->Pop(n);
+    return;
+  }
+
+  n = std::min(n, num_frames_ - num_popped_frames_);
+  features_.erase(features_.begin(),
+                  features_.begin() + static_cast<int64_t>(n) * Dim());
+  num_popped_frames_ += n;
+}
+
+void OnlineBatchFbank::ComputeFeatures() {
+  OnlineBatchFbank *self = this;
+  ComputeFeatures(&self, 1);
+}
+
+void OnlineBatchFbank::ComputeFeatures(OnlineBatchFbank *const *fbanks,
+                                       int32_t n) {
+  const BatchFbank *computer = fbanks[0]->computer_.get();
+  int32_t frame_length = computer->FrameLength();
+  int32_t dim = computer->Dim();
+
+  std::vector<float> windows;
+  std::vector<int32_t> num_new_frames(n);
+  for (int32_t i = 0; i != n; ++i) {
+    num_new_frames[i] = fbanks[i]->ExtractNewFrames(&windows);
+  }
+
+  // windows does not change any more, so pointers into it stay valid
+  std::vector<const float *> frames;
+  std::vector<float *> out;
+  const float *w = windows.data();
+  for (int32_t i = 0; i != n; ++i) {
+    OnlineBatchFbank *f = fbanks[i];
+    float *p = f->features_.data() +
+               static_cast<int64_t>(f->num_frames_ - f->num_popped_frames_) *
+                   dim;
+    for (int32_t k = 0; k != num_new_frames[i]; ++k) {
+      frames.push_back(w);
+      out.push_back(p);
+      w += frame_length;
+      p += dim;
+    }
+  }
+
+  if (!frames.empty()) {
+    computer->Compute(frames.data(), frames.size(), out.data());
+  }
+
+  for (int32_t i = 0; i != n; ++i) {
+    fbanks[i]->num_frames_ += num_new_frames[i];
+    fbanks[i]->DiscardSamples();
+  }
+}
+
+int32_t OnlineBatchFbank::ExtractNewFrames(std::vector<float> *windows) {
+  int64_t num_samples = waveform_offset_ + waveform_.size();
+  int32_t n = computer_->NumFrames(num_samples, input_finished_) - num_frames_;
+  if (n <= 0) {
+    return 0;
+  }
+
+  int32_t frame_length = computer_->FrameLength();
+  int64_t num_old = windows->size();
+  windows->resize(num_old + static_cast<int64_t>(n) * frame_length);
+
+  for (int32_t i = 0; i != n; ++i) {
+    ExtractFrame(num_frames_ + i, windows->data() + num_old +
+                                      static_cast<int64_t>(i) * frame_length);
+  }
+
+  features_.resize(features_.size() +
+                   static_cast<int64_t>(n) * computer_->Dim());
+
+  return n;
+}
+
+void OnlineBatchFbank::DiscardSamples() {
+  int64_t first_sample_of_next_frame =
+      computer_->FirstSampleOfFrame(num_frames_);
+  int64_t samples_to_discard = first_sample_of_next_frame - waveform_offset_;
+  if (samples_to_discard > 0) {
+    samples_to_discard =
+        std::min<int64_t>(samples_to_discard, waveform_.size());
+    waveform_.erase(waveform_.begin(),
+                    waveform_.begin() + samples_to_discard);
+    waveform_offset_ += samples_to_discard;
+  }
+}
+
+void OnlineBatchFbank::ExtractFrame(int32_t frame, float *window) const {
+  int32_t frame_length = computer_->FrameLength();
+  int64_t start = computer_->FirstSampleOfFrame(frame) - waveform_offset_;
+  int64_t num_samples = waveform_.size();
+
+  if (start >= 0 && start + frame_length <= num_samples) {
+    std::copy(waveform_.begin() + start,
+              waveform_.begin() + start + frame_length, window);
+    return;
+  }
+
+  for (int32_t i = 0; i != frame_length; ++i) {
+    int64_t k = start + i;
+    while (k < 0 || k >= num_samples) {
+      k = k < 0 ? -k - 1 : 2 * num_samples - 1 - k;
+    }
+    window[i] = waveform_[k];
+  }
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,186 @@
+// sherpa-ncnn/csrc/batch-fbank.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_BATCH_FBANK_H_
+#define SHERPA_NCNN_CSRC_BATCH_FBANK_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "kaldi-native-fbank/csrc/online-feature.h"
+
+namespace sherpa_ncnn {
+
+/** Compute fbank features of many frames at once.
+ *
+ * It produces the same features as knf::OnlineFbank, but processes a
+ * batch of frames together: The FFT and the mel projection run on
+ * several frames in parallel with SIMD instructions, and the window,
+ * FFT twiddle factors and mel weights are shared by all streams that
+ * use the same options instead of being copied into each stream.
+ *
+ * It has no state of its own, so it can be used by several threads at
+ * the same time.
+ */
+class BatchFbank {
+ public:
+  /** Return the object for the given options. Objects are cached, so
+   * streams with the same options share one object.
+   *
+   * @return Return nullptr if the options are not supported, e.g.,
+   *         dither is not 0 or is_librosa is true. Use knf::OnlineFbank
+   *         in that case.
+   */
+  static std::shared_ptr<const BatchFbank> Get(const knf::FbankOptions &opts);
+
+  int32_t Dim() const { return num_bins_; }
+
+  // Number of samples per frame
+  int32_t FrameLength() const { return frame_length_; }
+
+  // Number of samples between two frames
+  int32_t FrameShift() const { return frame_shift_; }
+
+  /** Number of frames in the first num_samples samples of a stream.
+   *
+   * @param flush If false, only frames that would not change when more
+   *              samples arrive are counted. Matters only if snip_edges
+   *              is false.
+   */
+  int32_t NumFrames(int64_t num_samples, bool flush) const;
+
+  // Index of the first sample of the given frame. It is negative for the
+  // first frame if snip_edges is false.
+  int64_t FirstSampleOfFrame(int32_t frame) const;
+
+  /** Compute features of n frames.
+   *
+   * @param frames frames[i] points to FrameLength() samples of the i-th
+   *               frame. Frames may come from different streams.
+   * @param n Number of frames.
+   * @param out out[i] points to Dim() floats for the features of the i-th
+   *            frame.
+   */
+  void Compute(const float *const *frames, int32_t n, float *const *out) const;
+
+ private:
+  explicit BatchFbank(const knf::FbankOptions &opts);
+
+  static bool IsSupported(const knf::FbankOptions &opts);
+
+  void InitWindow(const knf::FrameExtractionOptions &opts);
+  void InitFft();
+  void InitMelBanks(const knf::MelBanksOptions &opts, float samp_freq);
+
+  // Compute features of L frames at once
+  template <int32_t L>
+  void ComputeLanes(const float *const *frames, float *const *out,
+                    float *scratch) const;
+
+ private:
+  knf::FbankOptions opts_;
+  int32_t frame_length_;
+  int32_t frame_shift_;
+  int32_t padded_length_;  // FFT size, a power of two
+  int32_t num_bins_;
+
+  std::vector<float> window_;
+
+  // Twiddle factors of the complex FFT of size padded_length_ / 2, and
+  // of the step that turns it into a real FFT of size padded_length_
+  std::vector<float> fft_cos_;
+  std::vector<float> fft_sin_;
+  std::vector<float> rfft_cos_;
+  std::vector<float> rfft_sin_;
+  std::vector<int32_t> bit_reverse_;
+
+  // Non-zero weights of mel bin i are mel_weights_[mel_offset_[i]...]
+  // and apply to FFT bins mel_first_[i], mel_first_[i] + 1, ...
+  std::vector<int32_t> mel_first_;
+  std::vector<int32_t> mel_size_;
+  std::vector<int32_t> mel_offset_;
+  std::vector<float> mel_weights_;
+};
+
+/** Compute fbank features of a stream.
+ *
+ * It has the same interface as knf::OnlineFbank. It uses a shared
+ * BatchFbank if the options are supported and falls back to
+ * knf::OnlineFbank otherwise. All new frames of an AcceptWaveform() call
+ * are computed in one batch. Use AcceptWaveforms() to compute frames of
+ * different streams in one batch.
+ */
+class OnlineBatchFbank {
+ public:
+  explicit OnlineBatchFbank(const knf::FbankOptions &opts);
+
+  int32_t Dim() const;
+
+  int32_t NumFramesReady() const;
+
+  // The returned pointer is valid until the next call of a non-const
+  // method.
+  const float *GetFrame(int32_t frame) const;
+
+  void AcceptWaveform(float sampling_rate, const float *waveform, int32_t n);
+
+  /** Same as calling AcceptWaveform() on each of the given objects, but
+   * new frames of objects that share a BatchFbank are computed in one
+   * batch, so that frames of different streams fill the SIMD lanes.
+   *
+   * @param fbanks Distinct objects. Samples are at the sampling rate of
+   *               the options of each object.
+   * @param n Number of objects.
+   * @param waveforms waveforms[i] contains num_samples[i] samples for
+   *                  fbanks[i].
+   */
+  static void AcceptWaveforms(OnlineBatchFbank *const *fbanks, int32_t n,
+                              const float *const *waveforms,
+                              const int32_t *num_samples);
+
+  void InputFinished();
+
+  // Discard the first n frames that are not discarded yet. GetFrame()
+  // must not be called for them afterwards.
+  void Pop(int32_t n);
+
+ private:
+  void ComputeFeatures();
+
+  // Compute new frames of the given objects. All of them use the same
+  // BatchFbank.
+  static void ComputeFeatures(OnlineBatchFbank *const *fbanks, int32_t n);
+
+  // Append the windows of frames that can be computed now to *windows
+  // and make room for their features. Return the number of such frames.
+  int32_t ExtractNewFrames(std::vector<float> *windows);
+
+  // Discard samples that are not needed by later frames
+  void DiscardSamples();
+
+  // Copy samples of the given frame into window, reflecting at the edges
+  // of waveform_ like kaldi does.
+  void ExtractFrame(int32_t frame, float *window) const;
+
+ private:
+  std::shared_ptr<const BatchFbank> computer_;
+  std::unique_ptr<knf::OnlineFbank> fallback_;  // if computer_ is null
+  float sampling_rate_;
+
+  // Samples that may still be needed by later frames
+  std::vector<float> waveform_;
+  // Index of waveform_[0] in the stream
+  int64_t waveform_offset_ = 0;
+  bool input_finished_ = false;
+
+  // Features of frames num_popped_frames_, num_popped_frames_ + 1, ...
+  std::vector<float> features_;
+  int32_t num_frames_ = 0;
+  int32_t num_popped_frames_ = 0;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_BATCH_FBANK_H_
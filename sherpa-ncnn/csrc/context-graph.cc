@@ -12,10 +12,23 @@
 #include <utility>
 
 namespace sherpa_ncnn {
+
+namespace {
+
+// A node of the trie that is used only while building the graph
+struct TrieNode {
+  ContextState state;
+  std::string phrase;
+  // (token, index of the child), sorted by token
+  std::vector<std::pair<int32_t, int32_t>> next;
+};
+
+}  // namespace
+
 void ContextGraph::Build(const std::vector<std::vector<int32_t>> &token_ids,
                          const std::vector<float> &scores,
                          const std::vector<std::string> &phrases,
-                         const std::vector<float> &ac_thresholds) const {
+                         const std::vector<float> &ac_thresholds) {
   if (!scores.empty()) {
     assert(token_ids.size() == scores.size());
   }
@@ -25,8 +38,12 @@ void ContextGraph::Build(const std::vector<std::vector<int32_t>> &token_ids,
   if (!ac_thresholds.empty()) {
     assert(token_ids.size() == ac_thresholds.size());
   }
+
+  // Step 1: Build a trie
+  std::vector<TrieNode> trie(1);
+
   for (int32_t i = 0; i < token_ids.size(); ++i) {
-    auto node = root_.get();
+    int32_t node = 0;
     float score = scores.empty() ? 0.0f : scores[i];
     score = score == 0.0f ? context_score_ : score;
     float ac_threshold = ac_thresholds.empty() ? 0.0f : ac_thresholds[i];
@@ -35,65 +52,216 @@ void ContextGraph::Build(const std::vector<std::vector<int32_t>> &token_ids,
 
     for (int32_t j = 0; j < token_ids[i].size(); ++j) {
       int32_t token = token_ids[i][j];
-      if (0 == node->next.count(token)) {
-        bool is_end = j == token_ids[i].size() - 1;
-        node->next[token] = std::make_unique<ContextState>(
-            token, score, node->node_score + score,
-            is_end ? node->node_score + score : 0, j + 1,
-            is_end ? ac_threshold : 0.0f, is_end,
-            is_end ? phrase : std::string());
+      assert(token >= 0);
+
+      bool is_last = j == token_ids[i].size() - 1;
+
+      auto &next = trie[node].next;
+      auto it = std::lower_bound(
+          next.begin(), next.end(), token,
+          [](const std::pair<int32_t, int32_t> &p, int32_t t) {
+            return p.first < t;
+          });
+      if (it == next.end() || it->first != token) {
+        TrieNode child;
+        child.state.token = token;
+        child.state.token_score = score;
+        child.state.node_score = trie[node].state.node_score + score;
+        child.state.output_score = is_last ? child.state.node_score : 0;
+        child.state.level = j + 1;
+        child.state.ac_threshold = is_last ? ac_threshold : 0.0f;
+        child.state.is_end = is_last;
+        if (is_last) {
+          child.phrase = phrase;
+        }
+
+        int32_t index = static_cast<int32_t>(trie.size());
+        next.insert(it, {token, index});
+        trie.push_back(std::move(child));
+        node = index;
       } else {
-        float token_score = std::max(score, node->next[token]->token_score);
-        node->next[token]->token_score = token_score;
-        float node_score = node->node_score + token_score;
-        node->next[token]->node_score = node_score;
-        bool is_end =
-            (j == token_ids[i].size() - 1) || node->next[token]->is_end;
-        node->next[token]->output_score = is_end ? node_score : 0.0f;
-        node->next[token]->is_end = is_end;
-        if (j == token_ids[i].size() - 1) {
-          node->next[token]->phrase = phrase;
-          node->next[token]->ac_threshold = ac_threshold;
+        int32_t parent = node;
+        node = it->second;
+
+        ContextState &state = trie[node].state;
+        float token_score = std::max(score, state.token_score);
+        state.token_score = token_score;
+        float node_score = trie[parent].state.node_score + token_score;
+        state.node_score = node_score;
+        bool is_end = is_last || state.is_end;
+        state.output_score = is_end ? node_score : 0.0f;
+        state.is_end = is_end;
+        if (is_last) {
+          trie[node].phrase = phrase;
+          state.ac_threshold = ac_threshold;
         }
       }
-      node = node->next[token].get();
     }
   }
-  FillFailOutput();
+
+  // Step 2: Number the nodes in breadth-first order so that nodes close
+  // to the root, which are visited most often, are next to each other
+  std::vector<int32_t> order;  // order[i] is the index in the trie of node i
+  order.reserve(trie.size());
+
+  std::vector<int32_t> parents;
+  parents.reserve(trie.size());
+
+  order.push_back(0);
+  parents.push_back(-1);
+  for (int32_t i = 0; i != static_cast<int32_t>(order.size()); ++i) {
+    for (const auto &kv : trie[order[i]].next) {
+      order.push_back(kv.second);
+      parents.push_back(i);
+    }
+  }
+
+  int32_t num_nodes = static_cast<int32_t>(order.size());
+
+  std::vector<int32_t> new_index(num_nodes);
+  for (int32_t i = 0; i != num_nodes; ++i) {
+    new_index[order[i]] = i;
+  }
+
+  nodes_.resize(num_nodes);
+  phrases_.clear();
+  for (int32_t i = 0; i != num_nodes; ++i) {
+    TrieNode &t = trie[order[i]];
+    nodes_[i] = t.state;
+    nodes_[i].phrase_offset = static_cast<int32_t>(phrases_.size());
+    nodes_[i].phrase_length = static_cast<int32_t>(t.phrase.size());
+    phrases_.append(t.phrase);
+  }
+
+  // Step 3: Put the transitions into a double array. For each node,
+  // find the smallest base such that the slots base + token of all its
+  // children are unused.
+  transitions_.clear();
+
+  // next_free[k] is used to find the first unused slot not less than k.
+  // It is a disjoint set forest with path compression.
+  std::vector<int32_t> next_free;
+  auto find_free = [&next_free](int32_t k) {
+    if (k >= static_cast<int32_t>(next_free.size())) {
+      return k;
+    }
+
+    int32_t r = k;
+    while (r < static_cast<int32_t>(next_free.size()) && next_free[r] != r) {
+      r = next_free[r];
+    }
+
+    while (k != r) {
+      int32_t tmp = next_free[k];
+      next_free[k] = r;
+      k = tmp;
+    }
+    return r;
+  };
+
+  int32_t last_base = 0;
+
+  // Nodes with more children are harder to place, so place them first
+  std::vector<int32_t> placement;
+  for (int32_t i = 0; i != num_nodes; ++i) {
+    if (!trie[order[i]].next.empty()) {
+      placement.push_back(i);
+    }
+  }
+  std::stable_sort(placement.begin(), placement.end(),
+                   [&trie, &order](int32_t a, int32_t b) {
+                     return trie[order[a]].next.size() >
+                            trie[order[b]].next.size();
+                   });
+
+  for (int32_t i : placement) {
+    const auto &next = trie[order[i]].next;
+
+    int32_t min_token = next.front().first;
+    int32_t max_token = next.back().first;
+
+    // Holes left before the last node with several children are
+    // usually too small for another such node, so we skip them
+    int32_t start = next.size() > 1 ? last_base + min_token : min_token;
+
+    int32_t base = 0;
+    for (int32_t k = find_free(start);; k = find_free(k + 1)) {
+      base = k - min_token;
+
+      bool ok = true;
+      for (const auto &kv : next) {
+        size_t p = static_cast<size_t>(base) + kv.first;
+        if (p < transitions_.size() && transitions_[p].check != -1) {
+          ok = false;
+          break;
+        }
+      }
+
+      if (ok) {
+        break;
+      }
+    }
+
+    int32_t size = base + max_token + 1;
+    if (static_cast<int32_t>(transitions_.size()) < size) {
+      int32_t old_size = static_cast<int32_t>(next_free.size());
+      transitions_.resize(size);
+      next_free.resize(size);
+      for (int32_t k = old_size; k != size; ++k) {
+        next_free[k] = k;
+      }
+    }
+
+    if (next.size() > 1) {
+      last_base = base;
+    }
+
+    nodes_[i].base = base;
+    for (const auto &kv : next) {
+      int32_t p = base + kv.first;
+      transitions_[p] = {i, new_index[kv.second]};
+      next_free[p] = p + 1;
+    }
+  }
+  transitions_.shrink_to_fit();
+
+  FillFailOutput(parents);
 }
 
 std::tuple<float, const ContextState *, const ContextState *>
 ContextGraph::ForwardOneStep(const ContextState *state, int32_t token,
                              bool strict_mode /*= true*/) const {
-  const ContextState *node;
+  int32_t n = Goto(Index(state), token);
   float score;
-  if (1 == state->next.count(token)) {
-    node = state->next.at(token).get();
-    score = node->token_score;
+  if (n != -1) {
+    score = nodes_[n].token_score;
   } else {
-    node = state->fail;
-    while (0 == node->next.count(token)) {
-      node = node->fail;
-      if (-1 == node->token) break;  // root
+    n = state->fail;
+    int32_t next = Goto(n, token);
+    while (next == -1 && n != 0) {
+      n = nodes_[n].fail;
+      next = Goto(n, token);
     }
-    if (1 == node->next.count(token)) {
-      node = node->next.at(token).get();
+
+    if (next != -1) {
+      n = next;
     }
-    score = node->node_score - state->node_score;
+    score = nodes_[n].node_score - state->node_score;
   }
 
-  assert(nullptr != node);
+  const ContextState *node = &nodes_[n];
+  const ContextState *output =
+      node->output != -1 ? &nodes_[node->output] : nullptr;
 
-  const ContextState *matched_node =
-      node->is_end ? node : (node->output != nullptr ? node->output : nullptr);
+  const ContextState *matched_node = node->is_end ? node : output;
 
   if (!strict_mode && node->output_score != 0) {
     assert(nullptr != matched_node);
     float output_score =
         node->is_end ? node->node_score
-                     : (node->output != nullptr ? node->output->node_score
-                                                : node->node_score);
-    return std::make_tuple(score + output_score - node->node_score, root_.get(),
+                     : (output != nullptr ? output->node_score
+                                          : node->node_score);
+    return std::make_tuple(score + output_score - node->node_score, Root(),
                            matched_node);
   }
   return std::make_tuple(score + node->output_score, node, matched_node);
@@ -102,7 +270,7 @@ ContextGraph::ForwardOneStep(const ContextState *state, int32_t token,
 std::pair<float, const ContextState *> ContextGraph::Finalize(
     const ContextState *state) const {
   float score = -state->node_score;
-  return std::make_pair(score, root_.get());
+  return std::make_pair(score, Root());
 }
 
 std::pair<bool, const ContextState *> ContextGraph::IsMatched(
@@ -113,50 +281,45 @@ std::pair<bool, const ContextState *> ContextGraph::IsMatched(
     status = true;
     node = state;
   } else {
-    if (state->output != nullptr) {
+    if (state->output != -1) {
       status = true;
-      node = state->output;
+      node = &nodes_[state->output];
     }
   }
   return std::make_pair(status, node);
 }
 
-void ContextGraph::FillFailOutput() const {
-  std::queue<const ContextState *> node_queue;
-  for (auto &kv : root_->next) {
-    kv.second->fail = root_.get();
-    node_queue.push(kv.second.get());
-  }
-  while (!node_queue.empty()) {
-    auto current_node = node_queue.front();
-    node_queue.pop();
-    for (auto &kv : current_node->next) {
-      auto fail = current_node->fail;
-      if (1 == fail->next.count(kv.first)) {
-        fail = fail->next.at(kv.first).get();
-      } else {
-        fail = fail->fail;
-        while (0 == fail->next.count(kv.first)) {
-          fail = fail->fail;
-          if (-1 == fail->token) break;
-        }
-        if (1 == fail->next.count(kv.first))
-          fail = fail->next.at(kv.first).get();
+void ContextGraph::FillFailOutput(const std::vector<int32_t> &parents) {
+  // Nodes are in breadth-first order, so the failure node and the output
+  // node of a node have been processed before the node itself.
+  int32_t num_nodes = static_cast<int32_t>(nodes_.size());
+  for (int32_t i = 1; i < num_nodes; ++i) {
+    ContextState &node = nodes_[i];
+    int32_t parent = parents[i];
+
+    int32_t fail = 0;
+    if (parent != 0) {
+      fail = nodes_[parent].fail;
+      int32_t next = Goto(fail, node.token);
+      while (next == -1 && fail != 0) {
+        fail = nodes_[fail].fail;
+        next = Goto(fail, node.token);
       }
-      kv.second->fail = fail;
-      // fill the output arc
-      auto output = fail;
-      while (!output->is_end) {
-        output = output->fail;
-        if (-1 == output->token) {
-          output = nullptr;
-          break;
-        }
+
+      if (next != -1) {
+        fail = next;
       }
-      kv.second->output = output;
-      kv.second->output_score += output == nullptr ? 0 : output->output_score;
-      node_queue.push(kv.second.get());
     }
+    node.fail = fail;
+
+    // fill the output arc
+    int32_t output = fail;
+    while (output != 0 && !nodes_[output].is_end) {
+      output = nodes_[output].fail;
+    }
+    node.output = output != 0 ? output : -1;
+    node.output_score += output == 0 ? 0 : nodes_[output].output_score;
   }
 }
+
 }  // namespace sherpa_ncnn
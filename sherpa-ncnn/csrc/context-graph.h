@@ -8,40 +8,44 @@
 #include <memory>
 #include <string>
 #include <tuple>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace sherpa_ncnn {
 
 class ContextGraph;
-using ContextGraphPtr = std::shared_ptr<ContextGraph>;
 
+// A context graph is immutable once it is built, so it can be shared
+// by all streams of a recognizer.
+using ContextGraphPtr = std::shared_ptr<const ContextGraph>;
+
+// A node of the context graph.
+//
+// All nodes of a graph are stored contiguously in breadth-first order.
+// Links to other nodes are indexes into that array; -1 means no link.
 struct ContextState {
-  int32_t token;
-  float token_score;
-  float node_score;
-  float output_score;
-  int32_t level;
-  float ac_threshold;
-  bool is_end;
-  std::string phrase;
-  std::unordered_map<int32_t, std::unique_ptr<ContextState>> next;
-  const ContextState *fail = nullptr;
-  const ContextState *output = nullptr;
-
-  ContextState() = default;
-  ContextState(int32_t token, float token_score, float node_score,
-               float output_score, int32_t level = 0, float ac_threshold = 0.0f,
-               bool is_end = false, const std::string &phrase = {})
-      : token(token),
-        token_score(token_score),
-        node_score(node_score),
-        output_score(output_score),
-        level(level),
-        ac_threshold(ac_threshold),
-        is_end(is_end),
-        phrase(phrase) {}
+  int32_t token = -1;
+  float token_score = 0;
+  float node_score = 0;
+  float output_score = 0;
+  int32_t level = 0;
+  float ac_threshold = 0;
+  bool is_end = false;
+
+  // Index of the failure node
+  int32_t fail = 0;
+
+  // Index of the nearest end node along the failure links
+  int32_t output = -1;
+
+  // Transitions to the children start at this offset in the double-array
+  // transition table. -1 if the node has no children.
+  int32_t base = -1;
+
+  // The phrase is stored in the string pool of the graph.
+  // Use ContextGraph::Phrase() to get it.
+  int32_t phrase_offset = 0;
+  int32_t phrase_length = 0;
 };
 
 class ContextGraph {
@@ -53,8 +57,6 @@ class ContextGraph {
                const std::vector<std::string> &phrases = {},
                const std::vector<float> &ac_thresholds = {})
       : context_score_(context_score), ac_threshold_(ac_threshold) {
-    root_ = std::make_unique<ContextState>(-1, 0, 0, 0);
-    root_->fail = root_.get();
     Build(token_ids, scores, phrases, ac_thresholds);
   }
 
@@ -74,17 +76,61 @@ class ContextGraph {
   std::pair<float, const ContextState *> Finalize(
       const ContextState *state) const;
 
-  const ContextState *Root() const { return root_.get(); }
+  const ContextState *Root() const { return nodes_.data(); }
+
+  // Return the phrase of an end node. It is empty if no phrases
+  // were given.
+  std::string Phrase(const ContextState *state) const {
+    return phrases_.substr(state->phrase_offset, state->phrase_length);
+  }
+
+  int32_t NumStates() const { return static_cast<int32_t>(nodes_.size()); }
 
  private:
-  float context_score_;
-  float ac_threshold_;
-  std::unique_ptr<ContextState> root_;
+  // An entry of the double-array transition table. Node s has a transition
+  // with label t iff transitions_[s.base + t].check == s, in which case
+  // the destination is transitions_[s.base + t].next.
+  struct Transition {
+    int32_t check = -1;
+    int32_t next = -1;
+  };
+
+  // Return the index of the child of node s with the given token,
+  // or -1 if there is no such child.
+  int32_t Goto(int32_t s, int32_t token) const {
+    int32_t base = nodes_[s].base;
+    if (base < 0 || token < 0) {
+      return -1;
+    }
+
+    size_t k = static_cast<size_t>(base) + token;
+    if (k >= transitions_.size() || transitions_[k].check != s) {
+      return -1;
+    }
+
+    return transitions_[k].next;
+  }
+
+  int32_t Index(const ContextState *state) const {
+    return static_cast<int32_t>(state - nodes_.data());
+  }
+
   void Build(const std::vector<std::vector<int32_t>> &token_ids,
              const std::vector<float> &scores,
              const std::vector<std::string> &phrases,
-             const std::vector<float> &ac_thresholds) const;
-  void FillFailOutput() const;
+             const std::vector<float> &ac_thresholds);
+  // @param parents parents[i] is the index of the parent of node i
+  void FillFailOutput(const std::vector<int32_t> &parents);
+
+ private:
+  float context_score_;
+  float ac_threshold_;
+
+  std::vector<ContextState> nodes_;
+  std::vector<Transition> transitions_;
+
+  // String pool for phrases of all end nodes
+  std::string phrases_;
 };
 
 }  // namespace sherpa_ncnn
@@ -34,4 +34,13 @@ std::string DecoderConfig::ToString() const {
   return os.str();
 }
 
+void DecoderResult::SetBestPath(const Hypothesis &hyp) {
+  tokens.resize(num_committed_tokens);
+  tokens.insert(tokens.end(), hyp.ys.begin(), hyp.ys.end());
+
+  timestamps.resize(num_committed_tokens);
+  timestamps.insert(timestamps.end(), hyp.timestamps.begin(),
+                    hyp.timestamps.end());
+}
+
 }  // namespace sherpa_ncnn
@@ -53,11 +53,30 @@ struct DecoderResult {
 
   std::vector<int32_t> timestamps;
 
+  /// Number of tokens at the beginning of `tokens`, including the leading
+  /// blanks, that will not be changed by decoding more frames
+  int32_t num_stable_tokens = 0;
+
+  /// Value of num_stable_tokens in the last call of
+  /// Recognizer::GetResultDelta()
+  int32_t num_returned_stable_tokens = 0;
+
+  /// Used only by modified_beam_search.
+  /// Stable tokens are removed from the hypotheses in `hyps` from time to
+  /// time, so that their cost does not grow with the length of the
+  /// utterance. This is the number of tokens at the beginning of `tokens`
+  /// (and of `timestamps`) that have been removed from every hypothesis.
+  int32_t num_committed_tokens = 0;
+
   // Cache the decoder_out just before endpointing
   ncnn::Mat decoder_out;
 
   // used only for modified_beam_search
   Hypotheses hyps;
+
+  /// Used only by modified_beam_search. Set tokens and timestamps to
+  /// the committed tokens followed by the tokens of hyp.
+  void SetBestPath(const Hypothesis &hyp);
 };
 
 class Stream;
@@ -0,0 +1,157 @@
+// sherpa-ncnn/csrc/execution-profile.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/execution-profile.h"
+
+#include <functional>
+#include <string>
+
+#include "sherpa-ncnn/csrc/file-utils.h"
+#include "sherpa-ncnn/csrc/macros.h"
+
+namespace sherpa_ncnn {
+
+namespace {
+
+using FileExistsFunc = std::function<bool(const std::string &)>;
+
+// Replace the suffix of filename, e.g., from .param to .int8.param.
+// Return an empty string if filename does not end with from.
+std::string ReplaceSuffix(const std::string &filename, const std::string &from,
+                          const std::string &to) {
+  if (filename.size() < from.size() ||
+      filename.compare(filename.size() - from.size(), from.size(), from) != 0) {
+    return {};
+  }
+
+  return filename.substr(0, filename.size() - from.size()) + to;
+}
+
+bool IsInt8Model(const std::string &param) {
+  return param.find(".int8.param") != std::string::npos;
+}
+
+// Switch a net between its fp32 and int8 model files if both files of
+// the other variant exist. Return true if the net uses int8 model files
+// afterwards.
+bool SelectModelFiles(bool use_int8, const FileExistsFunc &file_exists,
+                      std::string *param, std::string *bin) {
+  if (use_int8 == IsInt8Model(*param)) {
+    return use_int8;
+  }
+
+  std::string new_param;
+  std::string new_bin;
+  if (use_int8) {
+    new_param = ReplaceSuffix(*param, ".param", ".int8.param");
+    new_bin = ReplaceSuffix(*bin, ".bin", ".int8.bin");
+  } else {
+    new_param = ReplaceSuffix(*param, ".int8.param", ".param");
+    new_bin = ReplaceSuffix(*bin, ".int8.bin", ".bin");
+  }
+
+  if (new_param.empty() || new_bin.empty() || !file_exists(new_param) ||
+      !file_exists(new_bin)) {
+    return IsInt8Model(*param);
+  }
+
+  *param = new_param;
+  *bin = new_bin;
+
+  return use_int8;
+}
+
+void SetPrecision(bool fp16_storage, bool fp16_arithmetic, bool int8,
+                  ncnn::Option *opt) {
+  opt->use_fp16_packed = fp16_storage;
+  opt->use_fp16_storage = fp16_storage;
+  opt->use_fp16_arithmetic = fp16_arithmetic;
+  opt->use_bf16_storage = false;
+  opt->use_int8_inference = int8;
+  opt->use_int8_packed = int8;
+  opt->use_int8_storage = int8;
+  opt->use_packing_layout = true;
+  opt->use_sgemm_convolution = true;
+}
+
+bool ApplyExecutionProfileImpl(const FileExistsFunc &file_exists,
+                               ModelConfig *config) {
+  const std::string &profile = config->execution_profile;
+  if (profile.empty()) {
+    return true;
+  }
+
+  if (!IsValidExecutionProfile(profile)) {
+    SHERPA_NCNN_LOGE(
+        "Unknown execution profile '%s'. Valid values are: accurate, "
+        "balanced, fast",
+        profile.c_str());
+    return false;
+  }
+
+  bool fast = profile == "fast";
+
+  // The decoder is tiny and int8 versions of it are not provided, so it
+  // always uses fp32 model files.
+  bool encoder_int8 = SelectModelFiles(
+      fast, file_exists, &config->encoder_param, &config->encoder_bin);
+  bool decoder_int8 = SelectModelFiles(
+      false, file_exists, &config->decoder_param, &config->decoder_bin);
+  bool joiner_int8 = SelectModelFiles(fast, file_exists, &config->joiner_param,
+                                      &config->joiner_bin);
+
+  if (!fast && (encoder_int8 || joiner_int8)) {
+    SHERPA_NCNN_LOGE(
+        "Execution profile '%s': fp32 model files are not found. Use the "
+        "given int8 model files",
+        profile.c_str());
+  }
+
+  bool fp16_storage = profile != "accurate";
+  bool fp16_arithmetic = fast;
+
+  SetPrecision(fp16_storage, fp16_arithmetic, encoder_int8,
+               &config->encoder_opt);
+  SetPrecision(fp16_storage, fp16_arithmetic, decoder_int8,
+               &config->decoder_opt);
+  SetPrecision(fp16_storage, fp16_arithmetic, joiner_int8,
+               &config->joiner_opt);
+
+  // Winograd convolution trades a little accuracy for speed
+  bool winograd = profile != "accurate";
+  config->encoder_opt.use_winograd_convolution = winograd;
+  config->decoder_opt.use_winograd_convolution = winograd;
+  config->joiner_opt.use_winograd_convolution = winograd;
+
+  return true;
+}
+
+}  // namespace
+
+bool IsValidExecutionProfile(const std::string &profile) {
+  return profile.empty() || profile == "accurate" || profile == "balanced" ||
+         profile == "fast";
+}
+
+bool ApplyExecutionProfile(ModelConfig *config) {
+  return ApplyExecutionProfileImpl(FileExists, config);
+}
+
+#if __ANDROID_API__ >= 9
+bool ApplyExecutionProfile(AAssetManager *mgr, ModelConfig *config) {
+  auto file_exists = [mgr](const std::string &filename) {
+    AAsset *asset =
+        AAssetManager_open(mgr, filename.c_str(), AASSET_MODE_UNKNOWN);
+    if (!asset) {
+      return false;
+    }
+    AAsset_close(asset);
+    return true;
+  };
+
+  return ApplyExecutionProfileImpl(file_exists, config);
+}
+#endif
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,48 @@
+// sherpa-ncnn/csrc/execution-profile.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_EXECUTION_PROFILE_H_
+#define SHERPA_NCNN_CSRC_EXECUTION_PROFILE_H_
+
+#include <string>
+
+#if __ANDROID_API__ >= 9
+#include "android/asset_manager.h"
+#include "android/asset_manager_jni.h"
+#endif
+
+#include "sherpa-ncnn/csrc/model.h"
+
+namespace sherpa_ncnn {
+
+/** Set the ncnn options of the encoder, decoder and joiner according to
+ * config->execution_profile and select the matching model files.
+ *
+ *  - accurate: fp32 storage and arithmetic, no winograd convolution.
+ *              fp32 model files are used if the given files are int8
+ *              models and the fp32 ones exist next to them.
+ *  - balanced: fp16 storage, fp32 arithmetic. fp32 model files are
+ *              selected like in accurate.
+ *  - fast: fp16 storage and arithmetic. The encoder and joiner use int8
+ *          model files, e.g., encoder.ncnn.int8.param and
+ *          encoder.ncnn.int8.bin, if they exist next to the given files.
+ *
+ * num_threads and use_vulkan_compute are not changed. An empty profile
+ * leaves config unchanged.
+ *
+ * @return Return false if the profile is unknown.
+ */
+bool ApplyExecutionProfile(ModelConfig *config);
+
+#if __ANDROID_API__ >= 9
+// Like the above one, but model files are looked up in the assets
+bool ApplyExecutionProfile(AAssetManager *mgr, ModelConfig *config);
+#endif
+
+// Return true if the given profile is empty or known
+bool IsValidExecutionProfile(const std::string &profile);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_EXECUTION_PROFILE_H_
@@ -0,0 +1,61 @@
+// sherpa-ncnn/csrc/feature-pipeline.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/feature-pipeline.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace sherpa_ncnn {
+
+FeaturePipeline::FeaturePipeline(int32_t num_threads) {
+  num_threads = std::max(num_threads, 1);
+
+  threads_.reserve(num_threads);
+  for (int32_t i = 0; i != num_threads; ++i) {
+    threads_.emplace_back([this]() { Run(); });
+  }
+}
+
+FeaturePipeline::~FeaturePipeline() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+
+  for (auto &t : threads_) {
+    t.join();
+  }
+}
+
+void FeaturePipeline::Submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  cond_.notify_one();
+}
+
+void FeaturePipeline::Run() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+
+      // Finish queued tasks before exiting
+      if (tasks_.empty()) {
+        return;
+      }
+
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+
+    task();
+  }
+}
+
+}  // namespace sherpa_ncnn
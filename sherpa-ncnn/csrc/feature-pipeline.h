@@ -0,0 +1,57 @@
+// sherpa-ncnn/csrc/feature-pipeline.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_FEATURE_PIPELINE_H_
+#define SHERPA_NCNN_CSRC_FEATURE_PIPELINE_H_
+
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+namespace sherpa_ncnn {
+
+/** A pool of threads that computes features for streams.
+ *
+ * If a stream is attached to it (see Stream::SetFeaturePipeline()),
+ * Stream::AcceptWaveform() only queues the samples and returns. Features
+ * are then computed by the threads of this pool while other threads run
+ * the neural networks in Recognizer::DecodeStream().
+ *
+ * Samples of a stream are processed in order and by at most one thread
+ * at a time.
+ */
+class FeaturePipeline {
+ public:
+  explicit FeaturePipeline(int32_t num_threads);
+
+  // It waits for all submitted tasks to finish
+  ~FeaturePipeline();
+
+  FeaturePipeline(const FeaturePipeline &) = delete;
+  FeaturePipeline &operator=(const FeaturePipeline &) = delete;
+
+  // Run the task on one of the threads of this pool
+  void Submit(std::function<void()> task);
+
+  int32_t NumThreads() const { return threads_.size(); }
+
+ private:
+  void Run();
+
+ private:
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<std::function<void()>> tasks_;
+  bool stop_ = false;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_FEATURE_PIPELINE_H_
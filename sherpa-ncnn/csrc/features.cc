@@ -19,12 +19,14 @@
 #include "sherpa-ncnn/csrc/features.h"
 
 #include <algorithm>
+#include <functional>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <vector>
 
 #include "kaldi-native-fbank/csrc/online-feature.h"
 #include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/batch-fbank.h"
 #include "sherpa-ncnn/csrc/resample.h"
 
 namespace sherpa_ncnn {
@@ -78,11 +80,58 @@ class FeatureExtractor::Impl {
     // https://github.com/k2-fsa/sherpa-onnx/issues/514
     opts_.mel_opts.high_freq = -400;
 
-    fbank_ = std::make_unique<knf::OnlineFbank>(opts_);
+    fbank_ = std::make_unique<OnlineBatchFbank>(opts_);
+    feature_dim_ = config.feature_dim;
   }
 
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(compute_mutex_);
+    std::vector<float> samples;
+    waveform = Resample(sampling_rate, waveform, &n, &samples);
+    fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, waveform, n);
+    MoveNewFrames();
+  }
+
+  static void AcceptWaveforms(Impl *const *impls, int32_t n,
+                              int32_t sampling_rate,
+                              const float *const *waveforms,
+                              const int32_t *num_samples) {
+    // Lock in the order of addresses, so that calls with overlapping
+    // extractors from different threads don't deadlock
+    std::vector<Impl *> sorted(impls, impls + n);
+    std::sort(sorted.begin(), sorted.end(), std::less<Impl *>());
+
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(n);
+    for (auto *impl : sorted) {
+      locks.emplace_back(impl->compute_mutex_);
+    }
+
+    std::vector<OnlineBatchFbank *> fbanks(n);
+    std::vector<const float *> samples(n);
+    std::vector<int32_t> sizes(n);
+    std::vector<std::vector<float>> resampled(n);
+    for (int32_t i = 0; i != n; ++i) {
+      fbanks[i] = impls[i]->fbank_.get();
+      sizes[i] = num_samples[i];
+      samples[i] = impls[i]->Resample(sampling_rate, waveforms[i], &sizes[i],
+                                      &resampled[i]);
+    }
+
+    OnlineBatchFbank::AcceptWaveforms(fbanks.data(), n, samples.data(),
+                                      sizes.data());
+
+    for (int32_t i = 0; i != n; ++i) {
+      impls[i]->MoveNewFrames();
+    }
+  }
+
+  // Return samples at the sampling rate of the features. If waveform has
+  // to be resampled, the result is saved in *buf and *n is updated.
+  //
+  // The caller must hold compute_mutex_.
+  const float *Resample(int32_t sampling_rate, const float *waveform,
+                        int32_t *n, std::vector<float> *buf) {
     if (resampler_) {
       if (sampling_rate != resampler_->GetInputSamplingRate()) {
         NCNN_LOGE(
@@ -92,11 +141,9 @@ class FeatureExtractor::Impl {
         exit(-1);
       }
 
-      std::vector<float> samples;
-      resampler_->Resample(waveform, n, false, &samples);
-      fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, samples.data(),
-                             samples.size());
-      return;
+      resampler_->Resample(waveform, *n, false, buf);
+      *n = buf->size();
+      return buf->data();
     }
 
     if (sampling_rate != opts_.frame_opts.samp_freq) {
@@ -115,35 +162,34 @@ class FeatureExtractor::Impl {
           sampling_rate, opts_.frame_opts.samp_freq, lowpass_cutoff,
           lowpass_filter_width);
 
-      std::vector<float> samples;
-      resampler_->Resample(waveform, n, false, &samples);
-      fbank_->AcceptWaveform(opts_.frame_opts.samp_freq, samples.data(),
-                             samples.size());
-      return;
+      resampler_->Resample(waveform, *n, false, buf);
+      *n = buf->size();
+      return buf->data();
     }
 
-    fbank_->AcceptWaveform(sampling_rate, waveform, n);
+    return waveform;
   }
 
   void InputFinished() {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(compute_mutex_);
     fbank_->InputFinished();
+    MoveNewFrames(true);
   }
 
   int32_t NumFramesReady() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return fbank_->NumFramesReady();
+    std::lock_guard<std::mutex> lock(frames_mutex_);
+    return num_frames_ready_;
   }
 
   bool IsLastFrame(int32_t frame) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return fbank_->IsLastFrame(frame);
+    std::lock_guard<std::mutex> lock(frames_mutex_);
+    return input_finished_ && frame == num_frames_ready_ - 1;
   }
 
   ncnn::Mat GetFrames(int32_t frame_index, int32_t n) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (frame_index + n > fbank_->NumFramesReady()) {
-      NCNN_LOGE("%d + %d > %d", frame_index, n, fbank_->NumFramesReady());
+    std::lock_guard<std::mutex> lock(frames_mutex_);
+    if (frame_index + n > num_frames_ready_) {
+      NCNN_LOGE("%d + %d > %d", frame_index, n, num_frames_ready_);
       exit(-1);
     }
 
@@ -154,15 +200,16 @@ class FeatureExtractor::Impl {
       exit(-1);
     }
 
-    fbank_->Pop(discard_num);
+    frames_.erase(frames_.begin(),
+                  frames_.begin() + discard_num * feature_dim_);
 
-    int32_t feature_dim = fbank_->Dim();
     ncnn::Mat features;
-    features.create(feature_dim, n);
+    features.create(feature_dim_, n);
 
+    const float *f = frames_.data();
     for (int32_t i = 0; i != n; ++i) {
-      const float *f = fbank_->GetFrame(i + frame_index);
-      std::copy(f, f + feature_dim, features.row(i));
+      std::copy(f, f + feature_dim_, features.row(i));
+      f += feature_dim_;
     }
 
     last_frame_index_ = frame_index;
@@ -171,10 +218,44 @@ class FeatureExtractor::Impl {
   }
 
  private:
-  std::unique_ptr<knf::OnlineFbank> fbank_;
+  // Move frames computed by fbank_ to frames_, so that reading them in
+  // GetFrames() is not blocked by AcceptWaveform() from another thread.
+  //
+  // The caller must hold compute_mutex_.
+  void MoveNewFrames(bool input_finished = false) {
+    int32_t num_frames = fbank_->NumFramesReady();
+    int32_t n = num_frames - num_moved_frames_;
+
+    std::vector<float> buf(n * feature_dim_);
+    for (int32_t i = 0; i != n; ++i) {
+      const float *f = fbank_->GetFrame(num_moved_frames_ + i);
+      std::copy(f, f + feature_dim_, buf.data() + i * feature_dim_);
+    }
+    fbank_->Pop(n);
+    num_moved_frames_ = num_frames;
+
+    std::lock_guard<std::mutex> lock(frames_mutex_);
+    frames_.insert(frames_.end(), buf.begin(), buf.end());
+    num_frames_ready_ = num_frames;
+    input_finished_ = input_finished_ || input_finished;
+  }
+
+ private:
+  // Protects fbank_, resampler_, and num_moved_frames_. It is held while
+  // computing features.
+  std::mutex compute_mutex_;
+  std::unique_ptr<OnlineBatchFbank> fbank_;
   knf::FbankOptions opts_;
-  mutable std::mutex mutex_;
   std::unique_ptr<LinearResample> resampler_;
+  int32_t feature_dim_;
+  int32_t num_moved_frames_ = 0;
+
+  // Protects the following members. It is held only for copying frames.
+  mutable std::mutex frames_mutex_;
+  // Frames with index >= last_frame_index_, in row-major
+  std::vector<float> frames_;
+  int32_t num_frames_ready_ = 0;
+  bool input_finished_ = false;
   int32_t last_frame_index_ = 0;
 };
 
@@ -188,6 +269,19 @@ void FeatureExtractor::AcceptWaveform(int32_t sampling_rate,
   impl_->AcceptWaveform(sampling_rate, waveform, n);
 }
 
+void FeatureExtractor::AcceptWaveforms(FeatureExtractor *const *extractors,
+                                       int32_t n, int32_t sampling_rate,
+                                       const float *const *waveforms,
+                                       const int32_t *num_samples) {
+  std::vector<Impl *> impls(n);
+  for (int32_t i = 0; i != n; ++i) {
+    impls[i] = extractors[i]->impl_.get();
+  }
+
+  Impl::AcceptWaveforms(impls.data(), n, sampling_rate, waveforms,
+                        num_samples);
+}
+
 void FeatureExtractor::InputFinished() { impl_->InputFinished(); }
 
 int32_t FeatureExtractor::NumFramesReady() const {
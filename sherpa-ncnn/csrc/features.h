@@ -92,6 +92,21 @@ class FeatureExtractor {
    */
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n);
 
+  /** Same as calling AcceptWaveform() on each of the given extractors,
+   * but new frames of all of them are computed in one batch. See
+   * OnlineBatchFbank::AcceptWaveforms().
+   *
+   * @param extractors Distinct extractors.
+   * @param n Number of extractors.
+   * @param sampling_rate The sampling rate of all of the waveforms.
+   * @param waveforms waveforms[i] contains num_samples[i] samples for
+   *                  extractors[i].
+   */
+  static void AcceptWaveforms(FeatureExtractor *const *extractors, int32_t n,
+                              int32_t sampling_rate,
+                              const float *const *waveforms,
+                              const int32_t *num_samples);
+
   // InputFinished() tells the class you won't be providing any
   // more waveform.  This will help flush out the last frame or two
   // of features, in the case where snip-edges == false; it also
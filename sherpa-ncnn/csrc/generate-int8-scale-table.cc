@@ -23,7 +23,14 @@
 #include <float.h>
 #include <stdio.h>  // for FLT_MAX
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <fstream>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "kaldi-native-fbank/csrc/online-feature.h"
@@ -34,6 +41,7 @@
 #include "net.h"
 #include "sherpa-ncnn/csrc/features.h"
 #include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
 #include "sherpa-ncnn/csrc/recognizer.h"
 #include "sherpa-ncnn/csrc/wave-reader.h"
 
@@ -257,17 +265,51 @@ class QuantNet : public ncnn::Net {
   void print_quant_info() const;
   int save_table_encoder(const char *tablepath);
   int save_table_joiner(const char *tablepath);
+  int save_sensitivity_report(const char *path) const;
   int quantize_KL(const std::vector<std::string> &wave_filenames);
   int quantize_ACIQ();
   int quantize_EQ();
 
  private:
+  // Called with the index of a conv bottom blob and its value
+  using BlobCallback = std::function<void(int, const ncnn::Mat &)>;
+
   int init_encoder();
   int init_joiner();
 
   void quantize_encoder_weight();
   void quantize_joiner_weight();
 
+  // Decode a wave file with greedy search and pass the conv bottom blobs
+  // of each chunk and frame to the callbacks. Thread-safe.
+  bool run_file(const std::string &filename, ncnn::Allocator *blob_allocator,
+                ncnn::Allocator *workspace_allocator,
+                const BlobCallback &on_encoder_blob,
+                const BlobCallback &on_joiner_blob) const;
+
+  // Process the files not done yet in the current pass with num_workers
+  // threads
+  void run_pass(const std::vector<std::string> &wave_filenames);
+
+  void merge_stats(const std::vector<QuantBlobStat> &src,
+                   std::vector<QuantBlobStat> *dst) const;
+
+  void init_histograms();
+
+  bool save_checkpoint(const std::vector<std::string> &wave_filenames) const;
+  bool load_checkpoint(const std::vector<std::string> &wave_filenames);
+
+ public:
+  // Number of files that are processed in parallel
+  int32_t num_workers = 1;
+
+  // If not empty, statistics are saved to this file every
+  // checkpoint_interval files and loaded from it on start
+  std::string checkpoint;
+  int32_t checkpoint_interval = 100;
+
+  static constexpr int num_histogram_bins = 2048;
+
  public:
   std::vector<int> encoder_conv_layers;
   std::vector<int> encoder_conv_bottom_blobs;
@@ -283,6 +325,18 @@ class QuantNet : public ncnn::Net {
   std::vector<QuantBlobStat> joiner_quant_blob_stats;
   std::vector<ncnn::Mat> joiner_weight_scales;
   std::vector<ncnn::Mat> joiner_bottom_blob_scales;
+
+ private:
+  enum { kPassAbsmax = 1, kPassHistogram = 2, kPassFinished = 3 };
+
+  int pass = kPassAbsmax;
+
+  // done[i] is 1 if the i-th file has been processed in the current pass
+  std::vector<char> done;
+
+  // Protects the stats, done and the checkpoint file while files are
+  // processed
+  std::mutex stats_mutex;
 };
 
 QuantNet::QuantNet(sherpa_ncnn::Model *model)
@@ -535,335 +589,524 @@ void QuantNet::quantize_joiner_weight() {
   }    // for (int i = 0; i < joiner_conv_layer_count; i++)
 }
 
-int QuantNet::quantize_KL(const std::vector<std::string> &wave_filenames) {
-  const int encoder_conv_bottom_blob_count =
-      (int)encoder_conv_bottom_blobs.size();
+// Run fn(i, worker) for i in [0, n) on num_workers threads.
+// worker is in [0, num_workers) and identifies the calling thread.
+static void ParallelFor(int32_t n, int32_t num_workers,
+                        const std::function<void(int32_t, int32_t)> &fn) {
+  std::atomic<int32_t> next{0};
+  auto work = [&](int32_t worker) {
+    while (true) {
+      int32_t i = next++;
+      if (i >= n) {
+        break;
+      }
+      fn(i, worker);
+    }
+  };
 
-  const int joiner_conv_bottom_blob_count =
-      (int)joiner_conv_bottom_blobs.size();
+  num_workers = std::max(1, std::min(num_workers, n));
 
-  fprintf(stderr, "num files: %d\n", (int)wave_filenames.size());
+  std::vector<std::thread> threads;
+  for (int32_t w = 1; w < num_workers; ++w) {
+    threads.emplace_back(work, w);
+  }
+  work(0);
+
+  for (auto &t : threads) {
+    t.join();
+  }
+}
 
-  const int num_histogram_bins = 2048;
-  std::vector<ncnn::UnlockedPoolAllocator> blob_allocators(1);
-  std::vector<ncnn::UnlockedPoolAllocator> workspace_allocators(1);
+static void AccumulateAbsmax(const ncnn::Mat &out, QuantBlobStat *stat) {
+  float absmax = 0.f;
 
-  // initialize conv weight scales
-  quantize_encoder_weight();
-  quantize_joiner_weight();
+  const int outc = out.c;
+  const int outsize = out.w * out.h;
+  for (int p = 0; p < outc; p++) {
+    const float *ptr = out.channel(p);
+    for (int k = 0; k < outsize; k++) {
+      absmax = std::max(absmax, (float)fabs(ptr[k]));
+    }
+  }
 
+  stat->absmax = std::max(stat->absmax, absmax);
+}
+
+static void AccumulateHistogram(const ncnn::Mat &out, float absmax,
+                                QuantBlobStat *stat) {
+  const int num_histogram_bins = (int)stat->histogram.size();
+
+  const int outc = out.c;
+  const int outsize = out.w * out.h;
+  for (int p = 0; p < outc; p++) {
+    const float *ptr = out.channel(p);
+    for (int k = 0; k < outsize; k++) {
+      if (ptr[k] == 0.f) continue;
+
+      const int index =
+          std::min((int)(fabs(ptr[k]) / absmax * num_histogram_bins),
+                   (num_histogram_bins - 1));
+
+      stat->histogram[index] += 1;
+    }
+  }
+}
+
+// FNV-1a hash of the filenames. It is saved in checkpoints to detect
+// that a checkpoint belongs to a different list of files.
+static uint64_t HashFilenames(const std::vector<std::string> &filenames) {
+  uint64_t h = 14695981039346656037ull;
+  for (const auto &f : filenames) {
+    for (unsigned char c : f) {
+      h ^= c;
+      h *= 1099511628211ull;
+    }
+    h ^= '\n';
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+bool QuantNet::run_file(const std::string &filename,
+                        ncnn::Allocator *blob_allocator,
+                        ncnn::Allocator *workspace_allocator,
+                        const BlobCallback &on_encoder_blob,
+                        const BlobCallback &on_joiner_blob) const {
   float expected_sampling_rate = 16000;
 
-  knf::FbankOptions fbank_opts;
-  fbank_opts.frame_opts.dither = 0;
-  fbank_opts.frame_opts.snip_edges = false;
-  fbank_opts.frame_opts.samp_freq = expected_sampling_rate;
-  fbank_opts.mel_opts.num_bins = 80;
+  bool is_ok = false;
+  std::vector<float> samples =
+      sherpa_ncnn::ReadWave(filename, expected_sampling_rate, &is_ok);
+  if (!is_ok) {
+    fprintf(stderr, "Failed to read %s\n", filename.c_str());
+    return false;
+  }
 
-  // Please see
-  // https://github.com/lhotse-speech/lhotse/blob/master/lhotse/features/fbank.py#L27
-  // and
-  // https://github.com/k2-fsa/sherpa-onnx/issues/514
-  fbank_opts.mel_opts.high_freq = -400;
+  sherpa_ncnn::FeatureExtractorConfig config;
+  config.sampling_rate = 16000;
+  config.feature_dim = 80;
+  sherpa_ncnn::FeatureExtractor feature_extractor(config);
+  feature_extractor.AcceptWaveform(expected_sampling_rate, samples.data(),
+                                   samples.size());
+  feature_extractor.InputFinished();
 
   int32_t segment = model->Segment();
   int32_t offset = model->Offset();
+  int32_t context_size = model->ContextSize();
+  int32_t blank_id = model->BlankId();
 
-  // count the absmax
-  for (const auto &filename : wave_filenames) {
-    bool is_ok = false;
-    std::vector<float> samples =
-        sherpa_ncnn::ReadWave(filename, expected_sampling_rate, &is_ok);
-    if (!is_ok) {
-      fprintf(stderr, "Failed to read %s\n", filename.c_str());
-      continue;
-    }
-    fprintf(stderr, "Processing %s\n", filename.c_str());
+  const int encoder_conv_bottom_blob_count =
+      (int)encoder_conv_bottom_blobs.size();
 
-    sherpa_ncnn::FeatureExtractorConfig config;
-    config.sampling_rate = 16000;
-    config.feature_dim = 80;
-    sherpa_ncnn::FeatureExtractor feature_extractor(config);
-    feature_extractor.AcceptWaveform(expected_sampling_rate, samples.data(),
-                                     samples.size());
-    feature_extractor.InputFinished();
+  const int joiner_conv_bottom_blob_count =
+      (int)joiner_conv_bottom_blobs.size();
 
-    int32_t context_size = model->ContextSize();
-    int32_t blank_id = model->BlankId();
+  std::vector<int32_t> hyp(context_size, blank_id);
 
-    std::vector<int32_t> hyp(context_size, blank_id);
+  ncnn::Mat decoder_input(context_size);
+  for (int32_t i = 0; i != context_size; ++i) {
+    static_cast<int32_t *>(decoder_input)[i] = blank_id;
+  }
 
-    ncnn::Mat decoder_input(context_size);
-    for (int32_t i = 0; i != context_size; ++i) {
-      static_cast<int32_t *>(decoder_input)[i] = blank_id;
-    }
+  ncnn::Mat decoder_out = model->RunDecoder(decoder_input);
 
-    ncnn::Mat decoder_out = model->RunDecoder(decoder_input);
+  std::vector<ncnn::Mat> states;
+  ncnn::Mat encoder_out;
 
-    std::vector<ncnn::Mat> states;
-    ncnn::Mat encoder_out;
+  int32_t num_processed = 0;
+  while (feature_extractor.NumFramesReady() - num_processed >= segment) {
+    ncnn::Extractor encoder_ex = model->GetEncoder().create_extractor();
+    encoder_ex.set_light_mode(false);
+    encoder_ex.set_blob_allocator(blob_allocator);
+    encoder_ex.set_workspace_allocator(workspace_allocator);
 
-    int32_t num_processed = 0;
-    while (feature_extractor.NumFramesReady() - num_processed >= segment) {
-      ncnn::Extractor encoder_ex = model->GetEncoder().create_extractor();
-      encoder_ex.set_light_mode(false);
-      encoder_ex.set_blob_allocator(&blob_allocators[0]);
-      encoder_ex.set_workspace_allocator(&workspace_allocators[0]);
+    ncnn::Mat features = feature_extractor.GetFrames(num_processed, segment);
+    num_processed += offset;
+    std::tie(encoder_out, states) =
+        model->RunEncoder(features, states, &encoder_ex);
 
+    for (int j = 0; j < encoder_conv_bottom_blob_count; j++) {
+      ncnn::Mat out;
+      encoder_ex.extract(encoder_conv_bottom_blobs[j], out);
+      on_encoder_blob(j, out);
+    }
+
+    // now for joiner
+    for (int32_t t = 0; t != encoder_out.h; ++t) {
+      // An extractor caches the blobs it has computed, so each frame
+      // needs a new one. Otherwise, all frames would see the blobs of
+      // the first frame.
       ncnn::Extractor joiner_ex = model->GetJoiner().create_extractor();
       joiner_ex.set_light_mode(false);
-      joiner_ex.set_blob_allocator(&blob_allocators[0]);
-      joiner_ex.set_workspace_allocator(&workspace_allocators[0]);
+      joiner_ex.set_blob_allocator(blob_allocator);
+      joiner_ex.set_workspace_allocator(workspace_allocator);
 
-      ncnn::Mat features = feature_extractor.GetFrames(num_processed, segment);
-      num_processed += offset;
-      std::tie(encoder_out, states) =
-          model->RunEncoder(features, states, &encoder_ex);
+      ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
+      ncnn::Mat joiner_out =
+          model->RunJoiner(encoder_out_t, decoder_out, &joiner_ex);
 
-      for (int j = 0; j < encoder_conv_bottom_blob_count; j++) {
+      for (int j = 0; j < joiner_conv_bottom_blob_count; j++) {
         ncnn::Mat out;
-        encoder_ex.extract(encoder_conv_bottom_blobs[j], out);
-
-        {
-          // count absmax
-          float absmax = 0.f;
-
-          const int outc = out.c;
-          const int outsize = out.w * out.h;
-          for (int p = 0; p < outc; p++) {
-            const float *ptr = out.channel(p);
-            for (int k = 0; k < outsize; k++) {
-              absmax = std::max(absmax, (float)fabs(ptr[k]));
-            }
-          }
-
-          QuantBlobStat &stat = encoder_quant_blob_stats[j];
-          stat.absmax = std::max(stat.absmax, absmax);
-        }
-      }  // for (int j = 0; j < encoder_conv_bottom_blob_count; j++)
-
-      // now for joiner
-      for (int32_t t = 0; t != encoder_out.h; ++t) {
-        ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
-        ncnn::Mat joiner_out =
-            model->RunJoiner(encoder_out_t, decoder_out, &joiner_ex);
-
-        for (int j = 0; j < joiner_conv_bottom_blob_count; j++) {
-          ncnn::Mat out;
-          joiner_ex.extract(joiner_conv_bottom_blobs[j], out);
-
-          {
-            // count absmax
-            float absmax = 0.f;
-
-            const int outc = out.c;
-            const int outsize = out.w * out.h;
-            for (int p = 0; p < outc; p++) {
-              const float *ptr = out.channel(p);
-              for (int k = 0; k < outsize; k++) {
-                absmax = std::max(absmax, (float)fabs(ptr[k]));
-              }
-            }
-
-            QuantBlobStat &stat = joiner_quant_blob_stats[j];
-            stat.absmax = std::max(stat.absmax, absmax);
-          }
-        }  // for (int j = 0; j < joiner_conv_bottom_blob_count; j++)
-
-        auto y = static_cast<int32_t>(std::distance(
-            static_cast<const float *>(joiner_out),
-            std::max_element(
-                static_cast<const float *>(joiner_out),
-                static_cast<const float *>(joiner_out) + joiner_out.w)));
-
-        if (y != blank_id) {
-          static_cast<int32_t *>(decoder_input)[0] = hyp.back();
-          static_cast<int32_t *>(decoder_input)[1] = y;
-          hyp.push_back(y);
-
-          decoder_out = model->RunDecoder(decoder_input);
-        }
-      }  // for (int32_t t = 0; t != encoder_out.h; ++t)
+        joiner_ex.extract(joiner_conv_bottom_blobs[j], out);
+        on_joiner_blob(j, out);
+      }
 
-    }  // while (feature_extractor.NumFramesReady() - num_processed >=
-       // segment)
-  }    // for (const auto &filename : wave_filenames)
+      auto y = static_cast<int32_t>(std::distance(
+          static_cast<const float *>(joiner_out),
+          std::max_element(
+              static_cast<const float *>(joiner_out),
+              static_cast<const float *>(joiner_out) + joiner_out.w)));
 
-  // initialize histogram
-  for (int i = 0; i < encoder_conv_bottom_blob_count; i++) {
-    QuantBlobStat &stat = encoder_quant_blob_stats[i];
+      if (y != blank_id) {
+        static_cast<int32_t *>(decoder_input)[0] = hyp.back();
+        static_cast<int32_t *>(decoder_input)[1] = y;
+        hyp.push_back(y);
 
-    stat.histogram.resize(num_histogram_bins, 0);
-    stat.histogram_normed.resize(num_histogram_bins, 0);
-  }
+        decoder_out = model->RunDecoder(decoder_input);
+      }
+    }  // for (int32_t t = 0; t != encoder_out.h; ++t)
+  }    // while (feature_extractor.NumFramesReady() - num_processed >= segment)
 
-  for (int i = 0; i < joiner_conv_bottom_blob_count; i++) {
-    QuantBlobStat &stat = joiner_quant_blob_stats[i];
+  return true;
+}
+
+void QuantNet::run_pass(const std::vector<std::string> &wave_filenames) {
+  const int encoder_conv_bottom_blob_count =
+      (int)encoder_conv_bottom_blobs.size();
+
+  const int joiner_conv_bottom_blob_count =
+      (int)joiner_conv_bottom_blobs.size();
 
-    stat.histogram.resize(num_histogram_bins, 0);
-    stat.histogram_normed.resize(num_histogram_bins, 0);
+  std::vector<int32_t> todo;
+  for (int32_t i = 0; i != (int32_t)wave_filenames.size(); ++i) {
+    if (!done[i]) {
+      todo.push_back(i);
+    }
   }
 
-  // build histogram
-  for (const auto &filename : wave_filenames) {
-    bool is_ok = false;
-    std::vector<float> samples =
-        sherpa_ncnn::ReadWave(filename, expected_sampling_rate, &is_ok);
-    if (!is_ok) {
-      fprintf(stderr, "Failed to read %s\n", filename.c_str());
-      continue;
+  fprintf(stderr, "%s: %d of %d files to process\n",
+          pass == kPassAbsmax ? "absmax" : "histogram", (int)todo.size(),
+          (int)wave_filenames.size());
+
+  int32_t workers = std::max(1, std::min(num_workers, (int32_t)todo.size()));
+  std::vector<ncnn::UnlockedPoolAllocator> blob_allocators(workers);
+  std::vector<ncnn::UnlockedPoolAllocator> workspace_allocators(workers);
+
+  int32_t num_done = (int32_t)(wave_filenames.size() - todo.size());
+  int32_t num_since_checkpoint = 0;
+
+  ParallelFor((int32_t)todo.size(), workers, [&](int32_t k, int32_t worker) {
+    int32_t i = todo[k];
+
+    // Statistics of this file only. They are merged into the global ones
+    // after the whole file is processed, so that a checkpoint never
+    // contains a part of a file.
+    std::vector<QuantBlobStat> encoder_stats(encoder_conv_bottom_blob_count);
+    std::vector<QuantBlobStat> joiner_stats(joiner_conv_bottom_blob_count);
+
+    BlobCallback on_encoder_blob;
+    BlobCallback on_joiner_blob;
+    if (pass == kPassAbsmax) {
+      on_encoder_blob = [&](int j, const ncnn::Mat &out) {
+        AccumulateAbsmax(out, &encoder_stats[j]);
+      };
+      on_joiner_blob = [&](int j, const ncnn::Mat &out) {
+        AccumulateAbsmax(out, &joiner_stats[j]);
+      };
+    } else {
+      for (auto &s : encoder_stats) {
+        s.histogram.resize(num_histogram_bins, 0);
+      }
+      for (auto &s : joiner_stats) {
+        s.histogram.resize(num_histogram_bins, 0);
+      }
+
+      // absmax is not changed in this pass, so it can be read without
+      // holding the lock
+      on_encoder_blob = [&](int j, const ncnn::Mat &out) {
+        AccumulateHistogram(out, encoder_quant_blob_stats[j].absmax,
+                            &encoder_stats[j]);
+      };
+      on_joiner_blob = [&](int j, const ncnn::Mat &out) {
+        AccumulateHistogram(out, joiner_quant_blob_stats[j].absmax,
+                            &joiner_stats[j]);
+      };
     }
-    fprintf(stderr, "Processing %s\n", filename.c_str());
 
-    sherpa_ncnn::FeatureExtractorConfig config;
-    config.sampling_rate = 16000;
-    config.feature_dim = 80;
-    sherpa_ncnn::FeatureExtractor feature_extractor(config);
-    feature_extractor.AcceptWaveform(expected_sampling_rate, samples.data(),
-                                     samples.size());
-    feature_extractor.InputFinished();
+    bool ok = run_file(wave_filenames[i], &blob_allocators[worker],
+                       &workspace_allocators[worker], on_encoder_blob,
+                       on_joiner_blob);
 
-    int32_t context_size = model->ContextSize();
-    int32_t blank_id = model->BlankId();
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    if (ok) {
+      merge_stats(encoder_stats, &encoder_quant_blob_stats);
+      merge_stats(joiner_stats, &joiner_quant_blob_stats);
+    }
 
-    std::vector<int32_t> hyp(context_size, blank_id);
+    done[i] = 1;
+    ++num_done;
+    fprintf(stderr, "[%d/%d] Processed %s\n", num_done,
+            (int)wave_filenames.size(), wave_filenames[i].c_str());
 
-    ncnn::Mat decoder_input(context_size);
-    for (int32_t i = 0; i != context_size; ++i) {
-      static_cast<int32_t *>(decoder_input)[i] = blank_id;
+    if (!checkpoint.empty() && ++num_since_checkpoint >= checkpoint_interval) {
+      save_checkpoint(wave_filenames);
+      num_since_checkpoint = 0;
     }
+  });
+}
 
-    ncnn::Mat decoder_out = model->RunDecoder(decoder_input);
+void QuantNet::merge_stats(const std::vector<QuantBlobStat> &src,
+                           std::vector<QuantBlobStat> *dst) const {
+  for (size_t j = 0; j != src.size(); ++j) {
+    QuantBlobStat &stat = (*dst)[j];
+    if (pass == kPassAbsmax) {
+      stat.absmax = std::max(stat.absmax, src[j].absmax);
+    } else {
+      for (int k = 0; k < num_histogram_bins; k++) {
+        stat.histogram[k] += src[j].histogram[k];
+      }
+    }
+  }
+}
 
-    std::vector<ncnn::Mat> states;
-    ncnn::Mat encoder_out;
+void QuantNet::init_histograms() {
+  for (auto &stat : encoder_quant_blob_stats) {
+    stat.histogram.assign(num_histogram_bins, 0);
+    stat.histogram_normed.assign(num_histogram_bins, 0);
+  }
 
-    int32_t num_processed = 0;
-    while (feature_extractor.NumFramesReady() - num_processed >= segment) {
-      ncnn::Extractor encoder_ex = model->GetEncoder().create_extractor();
-      encoder_ex.set_light_mode(false);
-      encoder_ex.set_blob_allocator(&blob_allocators[0]);
-      encoder_ex.set_workspace_allocator(&workspace_allocators[0]);
+  for (auto &stat : joiner_quant_blob_stats) {
+    stat.histogram.assign(num_histogram_bins, 0);
+    stat.histogram_normed.assign(num_histogram_bins, 0);
+  }
+}
 
-      ncnn::Extractor joiner_ex = model->GetJoiner().create_extractor();
-      joiner_ex.set_light_mode(false);
-      joiner_ex.set_blob_allocator(&blob_allocators[0]);
-      joiner_ex.set_workspace_allocator(&workspace_allocators[0]);
+/* The checkpoint is a text file:
 
-      ncnn::Mat features = feature_extractor.GetFrames(num_processed, segment);
-      num_processed += offset;
-      std::tie(encoder_out, states) =
-          model->RunEncoder(features, states, &encoder_ex);
+  sherpa-ncnn-int8-calibration 1
+  num_files <num_files> <hash of the filenames>
+  num_blobs <encoder blob count> <joiner blob count> <num_histogram_bins>
+  pass <1 for absmax, 2 for histogram, 3 if finished>
+  done <one 0 or 1 for each file>
+  absmax <encoder absmax values> <joiner absmax values>
+  histogram <encoder histograms> <joiner histograms>
 
-      for (int j = 0; j < encoder_conv_bottom_blob_count; j++) {
-        ncnn::Mat out;
-        encoder_ex.extract(encoder_conv_bottom_blobs[j], out);
+The line of histograms exists only if pass is not 1.
+ */
+static const char *kCheckpointMagic = "sherpa-ncnn-int8-calibration";
+
+bool QuantNet::save_checkpoint(
+    const std::vector<std::string> &wave_filenames) const {
+  // Write to a temporary file first so that an interrupted write does
+  // not destroy the last checkpoint
+  std::string tmp = checkpoint + ".tmp";
+  FILE *fp = fopen(tmp.c_str(), "wb");
+  if (!fp) {
+    fprintf(stderr, "fopen %s failed\n", tmp.c_str());
+    return false;
+  }
 
-        // count histogram bin
-        {
-          const float absmax = encoder_quant_blob_stats[j].absmax;
+  fprintf(fp, "%s 1\n", kCheckpointMagic);
+  fprintf(fp, "num_files %d %llu\n", (int)wave_filenames.size(),
+          (unsigned long long)HashFilenames(wave_filenames));
+  fprintf(fp, "num_blobs %d %d %d\n", (int)encoder_quant_blob_stats.size(),
+          (int)joiner_quant_blob_stats.size(), num_histogram_bins);
+  fprintf(fp, "pass %d\n", pass);
 
-          std::vector<uint64_t> histogram(num_histogram_bins, 0);
+  fprintf(fp, "done ");
+  for (char d : done) {
+    fputc(d ? '1' : '0', fp);
+  }
+  fprintf(fp, "\n");
 
-          const int outc = out.c;
-          const int outsize = out.w * out.h;
-          for (int p = 0; p < outc; p++) {
-            const float *ptr = out.channel(p);
-            for (int k = 0; k < outsize; k++) {
-              if (ptr[k] == 0.f) continue;
+  fprintf(fp, "absmax");
+  for (const auto &stat : encoder_quant_blob_stats) {
+    fprintf(fp, " %.9g", stat.absmax);
+  }
+  for (const auto &stat : joiner_quant_blob_stats) {
+    fprintf(fp, " %.9g", stat.absmax);
+  }
+  fprintf(fp, "\n");
 
-              const int index =
-                  std::min((int)(fabs(ptr[k]) / absmax * num_histogram_bins),
-                           (num_histogram_bins - 1));
+  if (pass != kPassAbsmax) {
+    fprintf(fp, "histogram");
+    for (const auto &stat : encoder_quant_blob_stats) {
+      for (uint64_t c : stat.histogram) {
+        fprintf(fp, " %llu", (unsigned long long)c);
+      }
+    }
+    for (const auto &stat : joiner_quant_blob_stats) {
+      for (uint64_t c : stat.histogram) {
+        fprintf(fp, " %llu", (unsigned long long)c);
+      }
+    }
+    fprintf(fp, "\n");
+  }
 
-              histogram[index] += 1;
-            }
-          }
+  bool ok = !ferror(fp);
+  ok = (fclose(fp) == 0) && ok;
 
-          QuantBlobStat &stat = encoder_quant_blob_stats[j];
+  if (!ok || rename(tmp.c_str(), checkpoint.c_str()) != 0) {
+    fprintf(stderr, "Failed to write checkpoint %s\n", checkpoint.c_str());
+    return false;
+  }
 
-          for (int k = 0; k < num_histogram_bins; k++) {
-            stat.histogram[k] += histogram[k];
-          }
-        }
-      }  // for (int j = 0; j < encoder_conv_bottom_blob_count; j++)
-
-      // now for joiner
-      for (int32_t t = 0; t != encoder_out.h; ++t) {
-        ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
-        ncnn::Mat joiner_out =
-            model->RunJoiner(encoder_out_t, decoder_out, &joiner_ex);
-
-        for (int j = 0; j < joiner_conv_bottom_blob_count; j++) {
-          ncnn::Mat out;
-          joiner_ex.extract(joiner_conv_bottom_blobs[j], out);
-
-          // count histogram bin
-          {
-            const float absmax = joiner_quant_blob_stats[j].absmax;
-
-            std::vector<uint64_t> histogram(num_histogram_bins, 0);
-
-            const int outc = out.c;
-            const int outsize = out.w * out.h;
-            for (int p = 0; p < outc; p++) {
-              const float *ptr = out.channel(p);
-              for (int k = 0; k < outsize; k++) {
-                if (ptr[k] == 0.f) continue;
-
-                const int index =
-                    std::min((int)(fabs(ptr[k]) / absmax * num_histogram_bins),
-                             (num_histogram_bins - 1));
-
-                histogram[index] += 1;
-              }
-            }
-
-            QuantBlobStat &stat = joiner_quant_blob_stats[j];
-
-            for (int k = 0; k < num_histogram_bins; k++) {
-              stat.histogram[k] += histogram[k];
-            }
-          }
-        }  // for (int j = 0; j < joiner_conv_bottom_blob_count; j++)
-
-        auto y = static_cast<int32_t>(std::distance(
-            static_cast<const float *>(joiner_out),
-            std::max_element(
-                static_cast<const float *>(joiner_out),
-                static_cast<const float *>(joiner_out) + joiner_out.w)));
-
-        if (y != blank_id) {
-          static_cast<int32_t *>(decoder_input)[0] = hyp.back();
-          static_cast<int32_t *>(decoder_input)[1] = y;
-          hyp.push_back(y);
-
-          decoder_out = model->RunDecoder(decoder_input);
+  return true;
+}
+
+bool QuantNet::load_checkpoint(const std::vector<std::string> &wave_filenames) {
+  std::ifstream is(checkpoint);
+  if (!is) {
+    return false;
+  }
+
+  std::string key;
+  int version = 0;
+  is >> key >> version;
+  if (key != kCheckpointMagic || version != 1) {
+    fprintf(stderr, "%s is not a calibration checkpoint\n",
+            checkpoint.c_str());
+    return false;
+  }
+
+  int num_files = 0;
+  unsigned long long hash = 0;
+  int encoder_blob_count = 0;
+  int joiner_blob_count = 0;
+  int bins = 0;
+  int saved_pass = 0;
+  std::string saved_done;
+
+  is >> key >> num_files >> hash;
+  is >> key >> encoder_blob_count >> joiner_blob_count >> bins;
+  is >> key >> saved_pass;
+  is >> key >> saved_done;
+
+  if (!is || num_files != (int)wave_filenames.size() ||
+      hash != HashFilenames(wave_filenames) ||
+      encoder_blob_count != (int)encoder_quant_blob_stats.size() ||
+      joiner_blob_count != (int)joiner_quant_blob_stats.size() ||
+      bins != num_histogram_bins || saved_pass < kPassAbsmax ||
+      saved_pass > kPassFinished || (int)saved_done.size() != num_files) {
+    fprintf(stderr,
+            "Checkpoint %s does not match the given models and files. "
+            "Ignore it\n",
+            checkpoint.c_str());
+    return false;
+  }
+
+  std::vector<QuantBlobStat> encoder_stats(encoder_blob_count);
+  std::vector<QuantBlobStat> joiner_stats(joiner_blob_count);
+
+  is >> key;
+  for (auto &stat : encoder_stats) {
+    is >> stat.absmax;
+  }
+  for (auto &stat : joiner_stats) {
+    is >> stat.absmax;
+  }
+
+  if (saved_pass != kPassAbsmax) {
+    is >> key;
+    for (auto *stats : {&encoder_stats, &joiner_stats}) {
+      for (auto &stat : *stats) {
+        stat.histogram.resize(num_histogram_bins);
+        stat.histogram_normed.resize(num_histogram_bins, 0);
+        for (auto &c : stat.histogram) {
+          unsigned long long v = 0;
+          is >> v;
+          c = v;
         }
-      }  // for (int32_t t = 0; t != encoder_out.h; ++t)
+      }
+    }
+  }
+
+  if (!is) {
+    fprintf(stderr, "Checkpoint %s is truncated. Ignore it\n",
+            checkpoint.c_str());
+    return false;
+  }
+
+  encoder_quant_blob_stats = std::move(encoder_stats);
+  joiner_quant_blob_stats = std::move(joiner_stats);
+  pass = saved_pass;
+  for (int i = 0; i != num_files; ++i) {
+    done[i] = saved_done[i] == '1';
+  }
+
+  fprintf(stderr, "Resume from checkpoint %s\n", checkpoint.c_str());
+
+  return true;
+}
+
+int QuantNet::quantize_KL(const std::vector<std::string> &wave_filenames) {
+  const int encoder_conv_bottom_blob_count =
+      (int)encoder_conv_bottom_blobs.size();
+
+  const int joiner_conv_bottom_blob_count =
+      (int)joiner_conv_bottom_blobs.size();
+
+  fprintf(stderr, "num files: %d\n", (int)wave_filenames.size());
+  fprintf(stderr, "num workers: %d\n", num_workers);
 
-    }  // while (feature_extractor.NumFramesReady() - num_processed >=
-       // segment)
-  }    // for (const auto &filename : wave_filenames)
+  // initialize conv weight scales
+  quantize_encoder_weight();
+  quantize_joiner_weight();
+
+  pass = kPassAbsmax;
+  done.assign(wave_filenames.size(), 0);
+
+  if (!checkpoint.empty()) {
+    load_checkpoint(wave_filenames);
+  }
+
+  // count the absmax
+  if (pass == kPassAbsmax) {
+    run_pass(wave_filenames);
+
+    pass = kPassHistogram;
+    done.assign(wave_filenames.size(), 0);
+    init_histograms();
+
+    if (!checkpoint.empty()) {
+      save_checkpoint(wave_filenames);
+    }
+  }
+
+  // build histogram
+  if (pass == kPassHistogram) {
+    run_pass(wave_filenames);
+
+    pass = kPassFinished;
+
+    if (!checkpoint.empty()) {
+      save_checkpoint(wave_filenames);
+    }
+  }
 
   // using kld to find the best threshold value
-  for (int i = 0; i < encoder_conv_bottom_blob_count; i++) {
-    QuantBlobStat &stat = encoder_quant_blob_stats[i];
+  auto compute_scale = [this, encoder_conv_bottom_blob_count](
+                           int32_t i, int32_t /*worker*/) {
+    if (i < encoder_conv_bottom_blob_count) {
+      QuantBlobStat &stat = encoder_quant_blob_stats[i];
 
-    float scale = compute_kl_threshold(stat, num_histogram_bins);
+      float scale = compute_kl_threshold(stat, num_histogram_bins);
 
-    encoder_bottom_blob_scales[i].create(1);
-    encoder_bottom_blob_scales[i][0] = scale;
-  }  // for (int i = 0; i < encoder_conv_bottom_blob_count; i++)
+      encoder_bottom_blob_scales[i].create(1);
+      encoder_bottom_blob_scales[i][0] = scale;
+    } else {
+      i -= encoder_conv_bottom_blob_count;
+      QuantBlobStat &stat = joiner_quant_blob_stats[i];
 
-  for (int i = 0; i < joiner_conv_bottom_blob_count; i++) {
-    QuantBlobStat &stat = joiner_quant_blob_stats[i];
+      float scale = compute_kl_threshold(stat, num_histogram_bins);
 
-    float scale = compute_kl_threshold(stat, num_histogram_bins);
+      joiner_bottom_blob_scales[i].create(1);
+      joiner_bottom_blob_scales[i][0] = scale;
+    }
+  };
 
-    joiner_bottom_blob_scales[i].create(1);
-    joiner_bottom_blob_scales[i][0] = scale;
-  }  // for (int i = 0; i < joiner_conv_bottom_blob_count; i++)
+  ParallelFor(encoder_conv_bottom_blob_count + joiner_conv_bottom_blob_count,
+              num_workers, compute_scale);
 
   return 0;
 }
@@ -972,6 +1215,160 @@ int QuantNet::save_table_joiner(const char *tablepath) {
   return 0;
 }
 
+// Return the weights of a quantized layer and the number of output
+// channels, each of which has its own weight scale.
+static bool GetWeightData(const ncnn::Layer *layer, ncnn::Mat *weight_data,
+                          int *num_channels) {
+  if (layer->type == "Convolution") {
+    const auto *convolution = (const ncnn::Convolution *)layer;
+    *weight_data = convolution->weight_data;
+    *num_channels = convolution->num_output;
+  } else if (layer->type == "ConvolutionDepthWise") {
+    const auto *convolutiondepthwise =
+        (const ncnn::ConvolutionDepthWise *)layer;
+    *weight_data = convolutiondepthwise->weight_data;
+    *num_channels = convolutiondepthwise->group;
+  } else if (layer->type == "InnerProduct") {
+    const auto *innerproduct = (const ncnn::InnerProduct *)layer;
+    *weight_data = innerproduct->weight_data;
+    *num_channels = innerproduct->num_output;
+  } else {
+    return false;
+  }
+
+  return !weight_data->empty() && *num_channels > 0;
+}
+
+// Ratio of the int8 quantization noise power to the signal power of
+// the weights of a layer
+static double WeightNoiseRatio(const ncnn::Layer *layer,
+                               const ncnn::Mat &weight_scales) {
+  ncnn::Mat weight_data;
+  int num_channels = 0;
+  if (!GetWeightData(layer, &weight_data, &num_channels) ||
+      weight_scales.w != num_channels) {
+    return 0;
+  }
+
+  const int size = weight_data.w / num_channels;
+
+  double signal = 0;
+  double noise = 0;
+  for (int n = 0; n < num_channels; n++) {
+    const float scale = weight_scales[n];
+    const float *w = (const float *)weight_data + size * n;
+    for (int k = 0; k < size; k++) {
+      signal += (double)w[k] * w[k];
+      if (scale > 0 && std::isfinite(scale)) {
+        double e = w[k] - std::round(w[k] * scale) / scale;
+        noise += e * e;
+      }
+    }
+  }
+
+  return signal > 0 ? noise / signal : 0;
+}
+
+// Ratio of the int8 quantization noise power to the signal power of the
+// input of a layer, estimated from its histogram: Values above the
+// threshold are clipped, the others are rounded to a step of
+// threshold / 127.
+static double ActivationNoiseRatio(const QuantBlobStat &stat) {
+  const int num_histogram_bins = (int)stat.histogram.size();
+  if (num_histogram_bins == 0 || stat.absmax <= 0 || stat.threshold <= 0) {
+    return 0;
+  }
+
+  const double step = stat.threshold / 127.0;
+  const double rounding_noise = step * step / 12;
+
+  double signal = 0;
+  double noise = 0;
+  for (int k = 0; k < num_histogram_bins; k++) {
+    const double c = (k + 0.5) * stat.absmax / num_histogram_bins;
+    const double count = (double)stat.histogram[k];
+
+    signal += count * c * c;
+    if (c > stat.threshold) {
+      noise += count * ((c - stat.threshold) * (c - stat.threshold) +
+                        rounding_noise);
+    } else {
+      noise += count * std::min(c * c, rounding_noise);
+    }
+  }
+
+  return signal > 0 ? noise / signal : 0;
+}
+
+static double ToDecibel(double noise_ratio) {
+  if (noise_ratio <= 0) {
+    return 200;  // no measurable noise
+  }
+
+  return -10 * log10(noise_ratio);
+}
+
+int QuantNet::save_sensitivity_report(const char *path) const {
+  struct Entry {
+    const char *model;
+    const ncnn::Layer *layer;
+    double activation_sqnr;
+    double weight_sqnr;
+    double sqnr;
+  };
+
+  std::vector<Entry> entries;
+
+  auto add = [&entries](const char *model, const ncnn::Layer *layer,
+                        const QuantBlobStat &stat,
+                        const ncnn::Mat &weight_scales) {
+    double r_act = ActivationNoiseRatio(stat);
+    double r_w = WeightNoiseRatio(layer, weight_scales);
+
+    entries.push_back({model, layer, ToDecibel(r_act), ToDecibel(r_w),
+                       ToDecibel(r_act + r_w)});
+  };
+
+  for (int i = 0; i < (int)encoder_conv_layers.size(); i++) {
+    add("encoder", encoder_layers[encoder_conv_layers[i]],
+        encoder_quant_blob_stats[i], encoder_weight_scales[i]);
+  }
+
+  for (int i = 0; i < (int)joiner_conv_layers.size(); i++) {
+    add("joiner", joiner_layers[joiner_conv_layers[i]],
+        joiner_quant_blob_stats[i], joiner_weight_scales[i]);
+  }
+
+  // Most sensitive layers first
+  std::stable_sort(
+      entries.begin(), entries.end(),
+      [](const Entry &a, const Entry &b) { return a.sqnr < b.sqnr; });
+
+  FILE *fp = fopen(path, "wb");
+  if (!fp) {
+    fprintf(stderr, "fopen %s failed\n", path);
+    return -1;
+  }
+
+  fprintf(fp,
+          "# Layers sorted by the estimated signal-to-quantization-noise "
+          "ratio (dB) of their output\n"
+          "# when quantized to int8. Layers at the top lose the most "
+          "accuracy; consider keeping them in fp32.\n");
+  fprintf(fp, "# %-8s %-40s %-22s %10s %10s %10s\n", "model", "layer", "type",
+          "sqnr", "input", "weight");
+
+  for (const auto &e : entries) {
+    fprintf(fp, "%-10s %-40s %-22s %10.2f %10.2f %10.2f\n", e.model,
+            e.layer->name.c_str(), e.layer->type.c_str(), e.sqnr,
+            e.activation_sqnr, e.weight_sqnr);
+  }
+
+  fclose(fp);
+
+  return 0;
+}
+
 static std::vector<std::string> ReadWaveFilenames(const char *f) {
   std::ifstream in(f);
   std::vector<std::string> ans;
@@ -982,37 +1379,81 @@ static std::vector<std::string> ReadWaveFilenames(const char *f) {
   return ans;
 }
 
-static void ShowUsage() {
-  fprintf(
-      stderr,
-      "Usage:\ngenerate-int8-scale-table encoder.param "
-      "encoder.bin decoder.param decoder.bin joiner.param joiner.bin "
-      "encoder-scale-table.txt joiner-scale-table.txt wave_filenames.txt\n\n"
-      "Each line in wave_filenames.txt is a path to some 16k Hz mono wave "
-      "file.\n");
-}
+int main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Generate int8 scale tables for the encoder and the joiner.
+
+Usage:
+
+./bin/generate-int8-scale-table \
+  --num-workers=8 \
+  --checkpoint=./calibration.ckpt \
+  --sensitivity-report=./sensitivity.txt \
+  encoder.param encoder.bin decoder.param decoder.bin joiner.param \
+  joiner.bin encoder-scale-table.txt joiner-scale-table.txt \
+  wave_filenames.txt
+
+Each line in wave_filenames.txt is a path to some 16k Hz mono wave file.
+
+Files are processed by --num-workers threads in parallel. If --checkpoint
+is given, the statistics collected so far are saved to it every
+--checkpoint-interval files, and a later run with the same arguments
+continues from it instead of starting over.
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  int32_t num_workers = 1;
+  int32_t num_threads = 1;
+  std::string checkpoint;
+  int32_t checkpoint_interval = 100;
+  std::string sensitivity_report;
+
+  po.Register("num-workers", &num_workers,
+              "Number of wave files to process in parallel. Each worker "
+              "holds its own activations, so memory grows with it");
+  po.Register("num-threads", &num_threads,
+              "Number of ncnn threads used by each worker");
+  po.Register("checkpoint", &checkpoint,
+              "If not empty, save the collected statistics to this file and "
+              "resume from it if it exists");
+  po.Register("checkpoint-interval", &checkpoint_interval,
+              "Save a checkpoint after this number of files");
+  po.Register("sensitivity-report", &sensitivity_report,
+              "If not empty, write the layers sorted by their estimated "
+              "accuracy loss when quantized to this file");
+
+  po.Read(argc, argv);
+
+  if (po.NumArgs() != 9) {
+    fprintf(stderr, "Please provide 9 args. Currently given: %d\n",
+            po.NumArgs());
+
+    po.PrintUsage();
+    return 1;
+  }
 
-int main(int argc, char **argv) {
-  if (argc != 10) {
-    fprintf(stderr, "Please provide 10 arg. Currently given: %d\n", argc);
+  num_workers = std::max(1, num_workers);
 
-    ShowUsage();
+  if (num_threads < 1 || checkpoint_interval < 1) {
+    fprintf(stderr,
+            "--num-threads and --checkpoint-interval must be positive\n");
     return 1;
   }
 
-  int32_t num_threads = 10;
   sherpa_ncnn::ModelConfig config;
 
-  config.encoder_param = argv[1];
-  config.encoder_bin = argv[2];
-  config.decoder_param = argv[3];
-  config.decoder_bin = argv[4];
-  config.joiner_param = argv[5];
-  config.joiner_bin = argv[6];
+  config.encoder_param = po.GetArg(1);
+  config.encoder_bin = po.GetArg(2);
+  config.decoder_param = po.GetArg(3);
+  config.decoder_bin = po.GetArg(4);
+  config.joiner_param = po.GetArg(5);
+  config.joiner_bin = po.GetArg(6);
 
-  const char *encoder_scale_table = argv[7];
-  const char *joiner_scale_table = argv[8];
-  std::vector<std::string> wave_filenames = ReadWaveFilenames(argv[9]);
+  std::string encoder_scale_table = po.GetArg(7);
+  std::string joiner_scale_table = po.GetArg(8);
+  std::vector<std::string> wave_filenames =
+      ReadWaveFilenames(po.GetArg(9).c_str());
 
   ncnn::Option opt;
   opt.num_threads = num_threads;
@@ -1026,8 +1467,15 @@ int main(int argc, char **argv) {
   config.joiner_opt = opt;
 
   auto model = sherpa_ncnn::Model::Create(config);
+  if (!model) {
+    fprintf(stderr, "Failed to load the model\n");
+    return 1;
+  }
 
   QuantNet net(model.get());
+  net.num_workers = num_workers;
+  net.checkpoint = checkpoint;
+  net.checkpoint_interval = checkpoint_interval;
 
   net.init();
 
@@ -1036,8 +1484,12 @@ int main(int argc, char **argv) {
 
   net.print_quant_info();
 
-  net.save_table_encoder(encoder_scale_table);
-  net.save_table_joiner(joiner_scale_table);
+  net.save_table_encoder(encoder_scale_table.c_str());
+  net.save_table_joiner(joiner_scale_table.c_str());
+
+  if (!sensitivity_report.empty()) {
+    net.save_sensitivity_report(sensitivity_report.c_str());
+  }
 
   return 0;
 }
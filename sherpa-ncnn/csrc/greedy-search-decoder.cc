@@ -18,8 +18,11 @@
  */
 #include "sherpa-ncnn/csrc/greedy-search-decoder.h"
 
+#include <algorithm>
 #include <vector>
 
+#include "sherpa-ncnn/csrc/stats.h"
+
 namespace sherpa_ncnn {
 
 ncnn::Mat GreedySearchDecoder::BuildDecoderInput(
@@ -56,13 +59,18 @@ void GreedySearchDecoder::Decode(ncnn::Mat encoder_out, DecoderResult *result) {
   ncnn::Mat decoder_out = result->decoder_out;
   if (decoder_out.empty()) {
     ncnn::Mat decoder_input = BuildDecoderInput(*result);
+    ScopedStageTimer timer(StatsStage::kDecoder);
     decoder_out = model_->RunDecoder(decoder_input);
   }
 
   int32_t frame_offset = result->frame_offset;
   for (int32_t t = 0; t != encoder_out.h; ++t) {
     ncnn::Mat encoder_out_t(encoder_out.w, encoder_out.row(t));
-    ncnn::Mat joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
+    ncnn::Mat joiner_out;
+    {
+      ScopedStageTimer timer(StatsStage::kJoiner);
+      joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
+    }
 
     const float *joiner_out_ptr = joiner_out.row(0);
 
@@ -74,7 +82,10 @@ void GreedySearchDecoder::Decode(ncnn::Mat encoder_out, DecoderResult *result) {
     if (new_token != 0 && new_token != 2) {
       result->tokens.push_back(new_token);
       ncnn::Mat decoder_input = BuildDecoderInput(*result);
-      decoder_out = model_->RunDecoder(decoder_input);
+      {
+        ScopedStageTimer timer(StatsStage::kDecoder);
+        decoder_out = model_->RunDecoder(decoder_input);
+      }
       result->num_trailing_blanks = 0;
       result->timestamps.push_back(t + frame_offset);
     } else {
@@ -84,6 +95,9 @@ void GreedySearchDecoder::Decode(ncnn::Mat encoder_out, DecoderResult *result) {
 
   result->frame_offset += encoder_out.h;
   result->decoder_out = decoder_out;
+
+  // greedy search never changes decoded tokens
+  result->num_stable_tokens = result->tokens.size();
 }
 
 }  // namespace sherpa_ncnn
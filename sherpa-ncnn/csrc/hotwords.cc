@@ -0,0 +1,143 @@
+// sherpa-ncnn/csrc/hotwords.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/hotwords.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <utility>
+
+#include "platform.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+// Return false if s is not a finite number
+static bool ParseScore(const std::string &s, float *score) {
+  const char *begin = s.c_str();
+  char *end = nullptr;
+  errno = 0;
+  float f = strtof(begin, &end);
+  if (end == begin || *end != '\0' || errno != 0 || !std::isfinite(f)) {
+    return false;
+  }
+
+  *score = f;
+  return true;
+}
+
+// SymbolTable replaces the leading ▁ of BPE tokens with a space,
+// so we do the same before looking up a token
+static const char kWordStart[] = "\xe2\x96\x81";  // ▁
+
+static std::string ToSymbol(const std::string &token) {
+  if (token.compare(0, 3, kWordStart) == 0) {
+    return " " + token.substr(3);
+  }
+  return token;
+}
+
+// Split a word into tokens by greedy longest match against the symbol
+// table. For models using BPE, the first token of a word starts with ▁,
+// so we try that first.
+//
+// Return false if some part of the word cannot be matched.
+static bool EncodeWord(const std::string &word, const SymbolTable &sym,
+                       std::vector<int32_t> *ids) {
+  std::vector<int32_t> ans;
+  size_t start = 0;
+  while (start < word.size()) {
+    size_t len = 0;
+    int32_t id = -1;
+
+    for (int32_t with_prefix = start == 0; with_prefix >= 0 && len == 0;
+         --with_prefix) {
+      for (size_t end = word.size(); end > start; --end) {
+        if (end < word.size() && (word[end] & 0xc0) == 0x80) {
+          // not at the boundary of a UTF-8 character
+          continue;
+        }
+
+        std::string piece = word.substr(start, end - start);
+        if (with_prefix) {
+          piece = " " + piece;
+        }
+
+        if (sym.contains(piece)) {
+          id = sym[piece];
+          len = end - start;
+          break;
+        }
+      }
+    }
+
+    if (len == 0) {
+      return false;
+    }
+
+    ans.push_back(id);
+    start += len;
+  }
+
+  ids->insert(ids->end(), ans.begin(), ans.end());
+  return true;
+}
+
+bool ParseHotwords(std::istream &is, const SymbolTable &sym,
+                   std::vector<std::vector<int32_t>> *hotwords,
+                   std::vector<float> *boost_scores) {
+  std::vector<int32_t> tmp;
+  std::string line;
+  std::string word;
+  while (std::getline(is, line)) {
+    std::istringstream iss(line);
+    float tmp_score = 0.0;  // MUST be 0.0, meaning if no customize score use
+                            // the global one.
+    while (iss >> word) {
+      std::string symbol = ToSymbol(word);
+      if (sym.contains(symbol)) {
+        int32_t number = sym[symbol];
+        tmp.push_back(number);
+      } else {
+        if (word[0] == ':') {
+          if (!ParseScore(word.substr(1), &tmp_score)) {
+            NCNN_LOGE("Invalid score %s for hotword at line: %s",
+                      word.c_str(), line.c_str());
+            return false;
+          }
+        } else if (!EncodeWord(word, sym, &tmp)) {
+          NCNN_LOGE(
+              "Cannot find ID for hotword %s at line: %s. (Hint: words on "
+              "the "
+              "same line are separated by spaces)",
+              word.c_str(), line.c_str());
+          return false;
+        }
+      }
+    }
+
+    if (tmp.empty()) {
+      continue;
+    }
+
+    hotwords->push_back(std::move(tmp));
+    boost_scores->push_back(tmp_score);
+  }
+
+  return true;
+}
+
+bool ParseHotwords(const std::string &hotwords, const SymbolTable &sym,
+                   std::vector<std::vector<int32_t>> *token_ids,
+                   std::vector<float> *boost_scores) {
+  std::string s = hotwords;
+  std::replace(s.begin(), s.end(), '/', '\n');
+  std::istringstream is(s);
+  return ParseHotwords(is, sym, token_ids, boost_scores);
+}
+
+}  // namespace sherpa_ncnn
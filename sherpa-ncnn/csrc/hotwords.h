@@ -0,0 +1,44 @@
+// sherpa-ncnn/csrc/hotwords.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_HOTWORDS_H_
+#define SHERPA_NCNN_CSRC_HOTWORDS_H_
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/symbol-table.h"
+
+namespace sherpa_ncnn {
+
+/** Parse hotwords, one per line. The format of each line looks like:
+ *
+ *   ▁HE LL O ▁WORLD :1.5
+ *
+ * The first several items are tokens of the hotword. The item starting
+ * with ":" is the boosting score for this hotword. If it is absent, the
+ * score is 0, meaning the one from the configuration is used.
+ *
+ * Items that are not tokens are treated as text and are split into
+ * tokens by greedy longest match, so a line can also look like:
+ *
+ *   HELLO WORLD :1.5
+ *
+ * @return Return false if there are unknown tokens or a score is not
+ *         a finite number.
+ */
+bool ParseHotwords(std::istream &is, const SymbolTable &sym,
+                   std::vector<std::vector<int32_t>> *hotwords,
+                   std::vector<float> *boost_scores);
+
+// Same as above, but hotwords are separated by / or by new lines
+bool ParseHotwords(const std::string &hotwords, const SymbolTable &sym,
+                   std::vector<std::vector<int32_t>> *token_ids,
+                   std::vector<float> *boost_scores);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_HOTWORDS_H_
@@ -39,9 +39,19 @@ struct Hypothesis {
 
   // The total score of ys in log space.
   double log_prob = 0;
-  const ContextState *context_state;
+  const ContextState *context_state = nullptr;
+
+  // State in the per-stream context graph, if any.
+  // See Stream::GetOverlayContextGraph()
+  const ContextState *overlay_context_state = nullptr;
+
   int32_t num_trailing_blanks = 0;
 
+  // Number of tokens that have been removed from the beginning of ys
+  // and timestamps since they are shared by all hypotheses.
+  // See DecoderResult::num_committed_tokens
+  int32_t num_committed_tokens = 0;
+
   Hypothesis() = default;
   Hypothesis(const std::vector<int32_t> &ys, double log_prob,
              const ContextState *context_state = nullptr)
@@ -60,6 +70,9 @@ struct Hypothesis {
     return os.str();
   }
 
+  // Number of tokens, including the committed ones
+  int32_t NumTokens() const { return num_committed_tokens + ys.size(); }
+
   // For debugging
   std::string ToString() const {
     std::ostringstream os;
@@ -0,0 +1,222 @@
+// sherpa-ncnn/csrc/layer-profiler.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/layer-profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/macros.h"
+
+namespace sherpa_ncnn {
+
+struct LayerTime {
+  std::string net;
+  std::string name;
+  std::string type;
+
+  std::atomic<int64_t> count{0};
+  std::atomic<int64_t> total_ns{0};
+};
+
+namespace {
+
+class ScopedLayerTimer {
+ public:
+  explicit ScopedLayerTimer(std::atomic<int64_t> *count,
+                            std::atomic<int64_t> *total_ns)
+      : count_(count),
+        total_ns_(total_ns),
+        start_(std::chrono::steady_clock::now()) {}
+
+  ~ScopedLayerTimer() {
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start_)
+                     .count();
+    count_->fetch_add(1, std::memory_order_relaxed);
+    total_ns_->fetch_add(ns, std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64_t> *count_;
+  std::atomic<int64_t> *total_ns_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// It takes over the given layer, including its flags, name and blob
+// indexes, so that ncnn treats it exactly like the wrapped layer.
+class ProfilingLayer : public ncnn::Layer {
+ public:
+  ProfilingLayer(ncnn::Layer *layer, std::shared_ptr<LayerTime> time)
+      : layer_(layer), time_(std::move(time)) {
+    ncnn::Layer::operator=(*layer);
+  }
+
+  ~ProfilingLayer() override { delete layer_; }
+
+  using ncnn::Layer::forward;
+  using ncnn::Layer::forward_inplace;
+
+  int create_pipeline(const ncnn::Option &opt) override {
+    return layer_->create_pipeline(opt);
+  }
+
+  int destroy_pipeline(const ncnn::Option &opt) override {
+    return layer_->destroy_pipeline(opt);
+  }
+
+  int forward(const std::vector<ncnn::Mat> &bottom_blobs,
+              std::vector<ncnn::Mat> &top_blobs,
+              const ncnn::Option &opt) const override {
+    ScopedLayerTimer timer(&time_->count, &time_->total_ns);
+    return layer_->forward(bottom_blobs, top_blobs, opt);
+  }
+
+  int forward(const ncnn::Mat &bottom_blob, ncnn::Mat &top_blob,
+              const ncnn::Option &opt) const override {
+    ScopedLayerTimer timer(&time_->count, &time_->total_ns);
+    return layer_->forward(bottom_blob, top_blob, opt);
+  }
+
+  int forward_inplace(std::vector<ncnn::Mat> &bottom_top_blobs,
+                      const ncnn::Option &opt) const override {
+    ScopedLayerTimer timer(&time_->count, &time_->total_ns);
+    return layer_->forward_inplace(bottom_top_blobs, opt);
+  }
+
+  int forward_inplace(ncnn::Mat &bottom_top_blob,
+                      const ncnn::Option &opt) const override {
+    ScopedLayerTimer timer(&time_->count, &time_->total_ns);
+    return layer_->forward_inplace(bottom_top_blob, opt);
+  }
+
+ private:
+  ncnn::Layer *layer_;  // owned
+  std::shared_ptr<LayerTime> time_;
+};
+
+struct Row {
+  std::string net;
+  std::string name;
+  std::string type;
+  int64_t count = 0;
+  int64_t total_ns = 0;
+};
+
+void PrintRows(const std::vector<Row> &rows, int64_t total_ns,
+               bool with_name, std::ostringstream &os) {
+  if (with_name) {
+    os << std::left << std::setw(10) << "net" << std::setw(40) << "name";
+  }
+  os << std::left << std::setw(24) << "type" << std::right << std::setw(10)
+     << "calls" << std::setw(14) << "total(ms)" << std::setw(12) << "mean(ms)"
+     << std::setw(10) << "percent"
+     << "\n";
+
+  for (const auto &r : rows) {
+    double total_ms = r.total_ns / 1e6;
+    double mean_ms = r.count ? total_ms / r.count : 0;
+    double percent = total_ns ? 100.0 * r.total_ns / total_ns : 0;
+
+    if (with_name) {
+      os << std::left << std::setw(10) << r.net << std::setw(40) << r.name;
+    }
+    os << std::left << std::setw(24) << r.type << std::right << std::setw(10)
+       << r.count << std::setw(14) << total_ms << std::setw(12) << mean_ms
+       << std::setw(9) << percent << "%\n";
+  }
+}
+
+}  // namespace
+
+LayerProfiler::LayerProfiler() = default;
+
+LayerProfiler::~LayerProfiler() = default;
+
+void LayerProfiler::Attach(const std::string &net_name, ncnn::Net *net) {
+  if (net->opt.use_vulkan_compute) {
+    SHERPA_NCNN_LOGE(
+        "Profiling is not supported for networks running on GPU. Skip %s",
+        net_name.c_str());
+    return;
+  }
+
+  for (auto &layer : net->mutable_layers()) {
+    auto time = std::make_shared<LayerTime>();
+    time->net = net_name;
+    time->name = layer->name;
+    time->type = layer->type;
+
+    layers_.push_back(time);
+    layer = new ProfilingLayer(layer, std::move(time));
+  }
+}
+
+std::string LayerProfiler::Report(int32_t max_layers /*= 50*/) const {
+  std::vector<Row> layers;
+  std::map<std::string, Row> types;
+  int64_t total_ns = 0;
+
+  for (const auto &t : layers_) {
+    Row r;
+    r.net = t->net;
+    r.name = t->name;
+    r.type = t->type;
+    r.count = t->count.load(std::memory_order_relaxed);
+    r.total_ns = t->total_ns.load(std::memory_order_relaxed);
+
+    auto &type = types[r.type];
+    type.type = r.type;
+    type.count += r.count;
+    type.total_ns += r.total_ns;
+
+    total_ns += r.total_ns;
+    layers.push_back(std::move(r));
+  }
+
+  auto by_time = [](const Row &a, const Row &b) {
+    return a.total_ns > b.total_ns;
+  };
+
+  std::vector<Row> sorted_types;
+  sorted_types.reserve(types.size());
+  for (auto &p : types) {
+    sorted_types.push_back(std::move(p.second));
+  }
+  std::stable_sort(sorted_types.begin(), sorted_types.end(), by_time);
+  std::stable_sort(layers.begin(), layers.end(), by_time);
+
+  int32_t num_layers = static_cast<int32_t>(layers.size());
+  if (max_layers > 0 && max_layers < num_layers) {
+    layers.resize(max_layers);
+  }
+
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(3);
+  os << "Total time in layers: " << total_ns / 1e6 << " ms\n\n";
+
+  os << "By layer type:\n";
+  PrintRows(sorted_types, total_ns, false, os);
+
+  os << "\nBy layer (" << layers.size() << " of " << num_layers << "):\n";
+  PrintRows(layers, total_ns, true, os);
+
+  return os.str();
+}
+
+void LayerProfiler::Reset() {
+  for (auto &t : layers_) {
+    t->count = 0;
+    t->total_ns = 0;
+  }
+}
+
+}  // namespace sherpa_ncnn
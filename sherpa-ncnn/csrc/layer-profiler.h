@@ -0,0 +1,61 @@
+// sherpa-ncnn/csrc/layer-profiler.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_LAYER_PROFILER_H_
+#define SHERPA_NCNN_CSRC_LAYER_PROFILER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "net.h"  // NOLINT
+
+namespace sherpa_ncnn {
+
+struct LayerTime;
+
+/** Measure the time spent in each layer of ncnn networks.
+ *
+ * It wraps every layer of a network, including custom layers such as
+ * PoolingModuleNoProj and TensorAsStrided, in a layer that forwards to the
+ * original one and accumulates the elapsed time. Layers can be run from
+ * several threads at the same time.
+ *
+ * Only layers running on the CPU are measured.
+ */
+class LayerProfiler {
+ public:
+  LayerProfiler();
+  ~LayerProfiler();
+
+  /** Wrap all layers of the given network.
+   *
+   * It must be called after the network is loaded and before it is run.
+   * The network must not be loaded again afterwards.
+   *
+   * @param net_name Name of the network in the report, e.g., encoder
+   * @param net The network to profile. It does nothing if the network uses
+   *            Vulkan.
+   */
+  void Attach(const std::string &net_name, ncnn::Net *net);
+
+  /** Return a report of the time spent so far. It contains two tables
+   * sorted by the total time in descending order: one aggregated by
+   * layer type and one for each layer.
+   *
+   * @param max_layers Maximum number of rows in the per-layer table.
+   *                   0 means no limit.
+   */
+  std::string Report(int32_t max_layers = 50) const;
+
+  // Clear the accumulated time
+  void Reset();
+
+ private:
+  std::vector<std::shared_ptr<LayerTime>> layers_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_LAYER_PROFILER_H_
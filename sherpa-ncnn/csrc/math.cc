@@ -8,13 +8,31 @@
 
 namespace sherpa_ncnn {
 
+static std::mt19937 &GetGenerator() {
+  thread_local std::mt19937 gen{std::random_device{}()};
+  return gen;
+}
+
+void SetRandomSeed(int64_t seed) {
+  if (seed < 0) {
+    GetGenerator().seed(std::random_device{}());
+  } else {
+    GetGenerator().seed(static_cast<std::mt19937::result_type>(seed));
+  }
+}
+
 void RandomVectorFill(float *p, int32_t n, float a /*= 0*/, float b /*= 1*/) {
-  std::random_device rd;
-  std::mt19937 gen(rd());
-  std::uniform_real_distribution<float> dist(a, b);
+  std::mt19937 &gen = GetGenerator();
+
+  // We don't use std::uniform_real_distribution since its output
+  // differs across standard library implementations.
+  //
+  // The upper 24 bits are converted to a float in [0, 1) exactly.
+  constexpr float kScale = 1.0f / (1 << 24);
+  const float scale = (b - a) * kScale;
 
   for (int32_t i = 0; i < n; ++i) {
-    p[i] = dist(gen);
+    p[i] = a + static_cast<float>(gen() >> 8) * scale;
   }
 }
 
@@ -23,6 +23,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <numeric>
 #include <vector>
 
@@ -116,8 +117,19 @@ std::vector<int32_t> TopkIndex(const T *vec, int32_t size, int32_t topk) {
   return index;
 }
 
+// Seed the random number generator of the calling thread.
+//
+// Each thread has its own generator, which is seeded from
+// std::random_device the first time it is used. If seed is negative,
+// the generator is re-seeded from std::random_device.
+//
+// For a given seed, the generated numbers are the same on all platforms.
+void SetRandomSeed(int64_t seed);
+
 // fill a vector of length n, pointed by p, with uniformly distributed
-// numbers from the range (a, b)
+// numbers from the range [a, b)
+//
+// It uses the generator of the calling thread. See SetRandomSeed().
 void RandomVectorFill(float *p, int32_t n, float a = 0, float b = 1);
 
 }  // namespace sherpa_ncnn
@@ -0,0 +1,59 @@
+// sherpa-ncnn/csrc/metrics-allocator.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/metrics-allocator.h"
+
+namespace sherpa_ncnn {
+
+// The size of an allocation is saved in front of it. Using 64 bytes keeps
+// the alignment guaranteed by ncnn.
+static constexpr size_t kHeaderSize = 64;
+
+void *MetricsAllocator::fastMalloc(size_t size) {
+  auto p = static_cast<unsigned char *>(
+      allocator_->fastMalloc(size + kHeaderSize));
+  if (!p) {
+    return nullptr;
+  }
+
+  *reinterpret_cast<size_t *>(p) = size;
+  bytes_in_use_->Add(static_cast<double>(size));
+
+  return p + kHeaderSize;
+}
+
+void MetricsAllocator::fastFree(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+
+  auto p = static_cast<unsigned char *>(ptr) - kHeaderSize;
+  bytes_in_use_->Add(-static_cast<double>(*reinterpret_cast<size_t *>(p)));
+
+  allocator_->fastFree(p);
+}
+
+#if SHERPA_NCNN_ENABLE_ALLOCATOR_METRICS
+void UseMetricsAllocator(ncnn::Net *net) {
+  static const char *kHelp = "Bytes allocated by ncnn networks and not freed";
+
+  // They are never destroyed since networks may be destroyed after them
+  static auto *blob_allocator = new MetricsAllocator(
+      new ncnn::PoolAllocator,
+      MetricsRegistry::Global().GetGauge("sherpa_ncnn_allocator_bytes_in_use",
+                                         kHelp, "type=\"blob\""));
+
+  static auto *workspace_allocator = new MetricsAllocator(
+      new ncnn::PoolAllocator,
+      MetricsRegistry::Global().GetGauge("sherpa_ncnn_allocator_bytes_in_use",
+                                         kHelp, "type=\"workspace\""));
+
+  net->opt.blob_allocator = blob_allocator;
+  net->opt.workspace_allocator = workspace_allocator;
+}
+#else
+void UseMetricsAllocator(ncnn::Net * /*net*/) {}
+#endif
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,47 @@
+// sherpa-ncnn/csrc/metrics-allocator.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_METRICS_ALLOCATOR_H_
+#define SHERPA_NCNN_CSRC_METRICS_ALLOCATOR_H_
+
+#include "net.h"  // NOLINT
+#include "sherpa-ncnn/csrc/metrics.h"
+
+namespace sherpa_ncnn {
+
+/** An allocator that forwards to another allocator and tracks the number
+ * of bytes that are currently handed out in a gauge.
+ *
+ * It is thread-safe if the underlying allocator is thread-safe.
+ */
+class MetricsAllocator : public ncnn::Allocator {
+ public:
+  // Neither allocator nor bytes_in_use is owned by this object
+  MetricsAllocator(ncnn::Allocator *allocator, Gauge *bytes_in_use)
+      : allocator_(allocator), bytes_in_use_(bytes_in_use) {}
+
+  void *fastMalloc(size_t size) override;
+  void fastFree(void *ptr) override;
+
+ private:
+  ncnn::Allocator *allocator_;
+  Gauge *bytes_in_use_;
+};
+
+/** Let the given network allocate blobs and workspace memory from
+ * an allocator shared by all networks, which reports the bytes in use in
+ * the gauge sherpa_ncnn_allocator_bytes_in_use{type="blob"} and
+ * sherpa_ncnn_allocator_bytes_in_use{type="workspace"}.
+ *
+ * It does nothing unless sherpa-ncnn is built with
+ * -DSHERPA_NCNN_ENABLE_ALLOCATOR_METRICS=ON, since the shared pool
+ * replaces the per-network pools of ncnn.
+ *
+ * It must be called before creating any extractor of the network.
+ */
+void UseMetricsAllocator(ncnn::Net *net);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_METRICS_ALLOCATOR_H_
@@ -0,0 +1,337 @@
+// sherpa-ncnn/csrc/metrics.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/macros.h"
+
+namespace sherpa_ncnn {
+
+static void AtomicAdd(std::atomic<double> *a, double v) {
+  double old = a->load(std::memory_order_relaxed);
+  while (!a->compare_exchange_weak(old, old + v, std::memory_order_relaxed)) {
+  }
+}
+
+void Counter::Inc(double v /*= 1*/) { AtomicAdd(&value_, v); }
+
+void Gauge::Add(double v) { AtomicAdd(&value_, v); }
+
+Histogram::Histogram(const std::vector<double> &buckets)
+    : buckets_(buckets),
+      counts_(std::make_unique<std::atomic<int64_t>[]>(buckets.size() + 1)) {
+  std::sort(buckets_.begin(), buckets_.end());
+  for (size_t i = 0; i != buckets_.size() + 1; ++i) {
+    counts_[i] = 0;
+  }
+}
+
+void Histogram::Observe(double v) {
+  // buckets are upper bounds, i.e., v <= bucket
+  auto i = std::lower_bound(buckets_.begin(), buckets_.end(), v) -
+           buckets_.begin();
+  counts_[i].fetch_add(1, std::memory_order_relaxed);
+  AtomicAdd(&sum_, v);
+}
+
+std::vector<int64_t> Histogram::Counts() const {
+  std::vector<int64_t> ans(buckets_.size() + 1);
+  for (size_t i = 0; i != ans.size(); ++i) {
+    ans[i] = counts_[i].load(std::memory_order_relaxed);
+  }
+  return ans;
+}
+
+std::vector<double> ExponentialBuckets(double start, double factor,
+                                       int32_t count) {
+  std::vector<double> ans(count);
+  for (int32_t i = 0; i != count; ++i) {
+    ans[i] = start;
+    start *= factor;
+  }
+  return ans;
+}
+
+MetricsRegistry &MetricsRegistry::Global() {
+  // It is never destroyed, so that metrics can be updated in destructors
+  // of static objects
+  static auto *registry = new MetricsRegistry;
+  return *registry;
+}
+
+MetricsRegistry::Family *MetricsRegistry::GetFamily(const std::string &name,
+                                                    const std::string &help,
+                                                    Type type) {
+  auto it = families_.find(name);
+  if (it == families_.end()) {
+    Family f;
+    f.type = type;
+    f.help = help;
+    it = families_.emplace(name, std::move(f)).first;
+  }
+
+  if (it->second.type != type) {
+    SHERPA_NCNN_LOGE("Metric %s is registered with a different type",
+                     name.c_str());
+    return nullptr;
+  }
+
+  return &it->second;
+}
+
+Counter *MetricsRegistry::GetCounter(const std::string &name,
+                                     const std::string &help,
+                                     const std::string &labels /*= ""*/) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Family *f = GetFamily(name, help, Type::kCounter);
+  if (!f) {
+    return nullptr;
+  }
+
+  auto &p = f->counters[labels];
+  if (!p) {
+    p = std::make_unique<Counter>();
+  }
+  return p.get();
+}
+
+Gauge *MetricsRegistry::GetGauge(const std::string &name,
+                                 const std::string &help,
+                                 const std::string &labels /*= ""*/) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Family *f = GetFamily(name, help, Type::kGauge);
+  if (!f) {
+    return nullptr;
+  }
+
+  auto &p = f->gauges[labels];
+  if (!p) {
+    p = std::make_unique<Gauge>();
+  }
+  return p.get();
+}
+
+Histogram *MetricsRegistry::GetHistogram(const std::string &name,
+                                         const std::string &help,
+                                         const std::vector<double> &buckets,
+                                         const std::string &labels /*= ""*/) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Family *f = GetFamily(name, help, Type::kHistogram);
+  if (!f) {
+    return nullptr;
+  }
+
+  auto &p = f->histograms[labels];
+  if (!p) {
+    p = std::make_unique<Histogram>(buckets);
+  }
+  return p.get();
+}
+
+// Return {labels} or {labels,extra}. Return an empty string if both
+// are empty.
+static std::string Braces(const std::string &labels,
+                          const std::string &extra = "") {
+  if (labels.empty() && extra.empty()) {
+    return "";
+  }
+
+  if (labels.empty()) {
+    return "{" + extra + "}";
+  }
+
+  if (extra.empty()) {
+    return "{" + labels + "}";
+  }
+
+  return "{" + labels + "," + extra + "}";
+}
+
+static std::string ToText(double v) {
+  if (std::isinf(v)) {
+    return v > 0 ? "+Inf" : "-Inf";
+  }
+
+  if (std::isnan(v)) {
+    return "NaN";
+  }
+
+  std::ostringstream os;
+  os << std::setprecision(10) << v;
+  return os.str();
+}
+
+std::string MetricsRegistry::ToString() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::ostringstream os;
+  for (const auto &p : families_) {
+    const std::string &name = p.first;
+    const Family &f = p.second;
+
+    os << "# HELP " << name << " " << f.help << "\n";
+    switch (f.type) {
+      case Type::kCounter:
+        os << "# TYPE " << name << " counter\n";
+        for (const auto &c : f.counters) {
+          os << name << Braces(c.first) << " " << ToText(c.second->Value())
+             << "\n";
+        }
+        break;
+      case Type::kGauge:
+        os << "# TYPE " << name << " gauge\n";
+        for (const auto &g : f.gauges) {
+          os << name << Braces(g.first) << " " << ToText(g.second->Value())
+             << "\n";
+        }
+        break;
+      case Type::kHistogram:
+        os << "# TYPE " << name << " histogram\n";
+        for (const auto &h : f.histograms) {
+          const auto &buckets = h.second->Buckets();
+          std::vector<int64_t> counts = h.second->Counts();
+
+          int64_t n = 0;
+          for (size_t i = 0; i != counts.size(); ++i) {
+            n += counts[i];
+            std::string le =
+                i < buckets.size() ? ToText(buckets[i]) : std::string("+Inf");
+            os << name << "_bucket" << Braces(h.first, "le=\"" + le + "\"")
+               << " " << n << "\n";
+          }
+          os << name << "_sum" << Braces(h.first) << " "
+             << ToText(h.second->Sum()) << "\n";
+          os << name << "_count" << Braces(h.first) << " " << n << "\n";
+        }
+        break;
+    }
+  }
+
+  return os.str();
+}
+
+bool MetricsRegistry::SaveToFile(const std::string &filename) const {
+  // A unique name in the same directory, so that threads saving to the
+  // same file at the same time don't write to the same temporary file
+  std::ostringstream tmp;
+  tmp << filename << ".tmp." << std::this_thread::get_id();
+  {
+    std::ofstream os(tmp.str());
+    if (!os) {
+      SHERPA_NCNN_LOGE("Failed to open %s", tmp.str().c_str());
+      return false;
+    }
+
+    os << ToString();
+    if (!os) {
+      SHERPA_NCNN_LOGE("Failed to write %s", tmp.str().c_str());
+      os.close();
+      std::remove(tmp.str().c_str());
+      return false;
+    }
+  }
+
+#ifdef _WIN32
+  // rename() on Windows fails if the target exists
+  std::remove(filename.c_str());
+#endif
+
+  if (std::rename(tmp.str().c_str(), filename.c_str()) != 0) {
+    SHERPA_NCNN_LOGE("Failed to rename %s to %s", tmp.str().c_str(),
+                     filename.c_str());
+    std::remove(tmp.str().c_str());
+    return false;
+  }
+
+  return true;
+}
+
+static AsrMetrics CreateAsrMetrics(const std::string &type) {
+  auto &r = MetricsRegistry::Global();
+  std::string labels = "type=\"" + type + "\"";
+
+  // from 1 ms to about 16 s
+  std::vector<double> latency_buckets = ExponentialBuckets(0.001, 2, 15);
+  std::vector<double> rtf_buckets = {0.01, 0.02, 0.05, 0.1, 0.2, 0.3,
+                                     0.5,  0.7,  1,    1.5, 2,   5};
+
+  AsrMetrics m;
+  m.active_streams = r.GetGauge("sherpa_ncnn_active_streams",
+                                "Number of existing streams", labels);
+  m.queued_chunks =
+      type == "online"
+          ? r.GetGauge("sherpa_ncnn_queued_chunks",
+                       "Number of chunks that are ready but not decoded yet",
+                       labels)
+          : nullptr;
+  m.audio_seconds = r.GetCounter("sherpa_ncnn_audio_seconds_total",
+                                 "Duration of decoded audio", labels);
+  m.decode_seconds = r.GetCounter("sherpa_ncnn_decode_seconds_total",
+                                  "Time spent in decoding", labels);
+  m.decode_latency = r.GetHistogram(
+      "sherpa_ncnn_decode_latency_seconds",
+      "Time to decode a chunk (online) or an utterance (offline)",
+      latency_buckets, labels);
+  m.rtf = r.GetHistogram(
+      "sherpa_ncnn_rtf",
+      "Real-time factor of decoding a chunk (online) or an utterance "
+      "(offline)",
+      rtf_buckets, labels);
+  return m;
+}
+
+const AsrMetrics &GetOnlineAsrMetrics() {
+  static const AsrMetrics m = CreateAsrMetrics("online");
+  return m;
+}
+
+const AsrMetrics &GetOfflineAsrMetrics() {
+  static const AsrMetrics m = CreateAsrMetrics("offline");
+  return m;
+}
+
+const VadMetrics &GetVadMetrics() {
+  static const VadMetrics m = [] {
+    auto &r = MetricsRegistry::Global();
+    VadMetrics m;
+    m.segments = r.GetCounter("sherpa_ncnn_vad_segments_total",
+                              "Number of speech segments detected by VAD");
+    m.speech_seconds =
+        r.GetCounter("sherpa_ncnn_vad_speech_seconds_total",
+                     "Duration of speech segments detected by VAD");
+    return m;
+  }();
+  return m;
+}
+
+const TtsMetrics &GetTtsMetrics() {
+  static const TtsMetrics m = [] {
+    auto &r = MetricsRegistry::Global();
+    TtsMetrics m;
+    m.samples = r.GetCounter("sherpa_ncnn_tts_samples_total",
+                             "Number of audio samples generated by TTS");
+    m.audio_seconds = r.GetCounter("sherpa_ncnn_tts_audio_seconds_total",
+                                   "Duration of audio generated by TTS");
+    // from 10 ms to about 80 s
+    m.generate_latency = r.GetHistogram(
+        "sherpa_ncnn_tts_generate_latency_seconds",
+        "Time to generate audio for a piece of text",
+        ExponentialBuckets(0.01, 2, 14));
+    return m;
+  }();
+  return m;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,168 @@
+// sherpa-ncnn/csrc/metrics.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_METRICS_H_
+#define SHERPA_NCNN_CSRC_METRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+namespace sherpa_ncnn {
+
+// A value that only goes up, e.g., number of decoded chunks
+class Counter {
+ public:
+  void Inc(double v = 1);
+
+  double Value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<double> value_{0};
+};
+
+// A value that can go up and down, e.g., number of active streams
+class Gauge {
+ public:
+  void Set(double v) { value_.store(v, std::memory_order_relaxed); }
+
+  void Add(double v);
+
+  void Inc() { Add(1); }
+  void Dec() { Add(-1); }
+
+  double Value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<double> value_{0};
+};
+
+// Counts observations in buckets, e.g., decoding latency
+class Histogram {
+ public:
+  // @param buckets Upper bounds of the buckets in increasing order.
+  //                A bucket for +Inf is added automatically.
+  explicit Histogram(const std::vector<double> &buckets);
+
+  void Observe(double v);
+
+  const std::vector<double> &Buckets() const { return buckets_; }
+
+  // Number of observations in each bucket (not cumulative).
+  // The last entry is for +Inf.
+  std::vector<int64_t> Counts() const;
+
+  double Sum() const { return sum_.load(std::memory_order_relaxed); }
+
+ private:
+  std::vector<double> buckets_;
+  std::unique_ptr<std::atomic<int64_t>[]> counts_;
+  std::atomic<double> sum_{0};
+};
+
+// Return buckets start, start * factor, start * factor^2, ...
+std::vector<double> ExponentialBuckets(double start, double factor,
+                                       int32_t count);
+
+/** A set of named metrics that can be rendered in the Prometheus text
+ * exposition format.
+ *
+ * Registering a metric takes a lock, so callers should keep the returned
+ * pointer, which is valid as long as the registry is alive. Updating a
+ * metric only uses atomic operations and never blocks.
+ *
+ * Metrics with the same name but different labels belong to the same
+ * family, e.g., sherpa_ncnn_active_streams{type="online"} and
+ * sherpa_ncnn_active_streams{type="offline"}.
+ */
+class MetricsRegistry {
+ public:
+  // The registry used by all components of sherpa-ncnn
+  static MetricsRegistry &Global();
+
+  /**
+   * @param name  Name of the metric, e.g., sherpa_ncnn_vad_segments_total
+   * @param help  A description of the metric
+   * @param labels  Labels of the metric without braces,
+   *                e.g., type="online". Can be empty.
+   * @return Return the existing metric if it has been registered before.
+   *         Return nullptr if name is used by a metric of another type.
+   */
+  Counter *GetCounter(const std::string &name, const std::string &help,
+                      const std::string &labels = "");
+
+  Gauge *GetGauge(const std::string &name, const std::string &help,
+                  const std::string &labels = "");
+
+  // buckets is ignored if the histogram has been registered before
+  Histogram *GetHistogram(const std::string &name, const std::string &help,
+                          const std::vector<double> &buckets,
+                          const std::string &labels = "");
+
+  // Render all metrics in the Prometheus text exposition format
+  std::string ToString() const;
+
+  /** Write ToString() to a file. It writes to a temporary file first and
+   * then renames it, so readers, e.g., the textfile collector of
+   * node_exporter, never see a partially written file.
+   *
+   * @return Return true on success.
+   */
+  bool SaveToFile(const std::string &filename) const;
+
+ private:
+  enum class Type { kCounter, kGauge, kHistogram };
+
+  struct Family {
+    Type type;
+    std::string help;
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+  };
+
+  Family *GetFamily(const std::string &name, const std::string &help,
+                    Type type);
+
+  mutable std::mutex mutex_;
+  std::map<std::string, Family> families_;
+};
+
+// Metrics of speech recognition, registered in MetricsRegistry::Global().
+// Streaming and non-streaming recognizers use the label type="online"
+// and type="offline", respectively.
+struct AsrMetrics {
+  Gauge *active_streams;
+  Gauge *queued_chunks;  // only for streaming recognizers; null otherwise
+  Counter *audio_seconds;   // audio decoded so far
+  Counter *decode_seconds;  // time spent in decoding
+  Histogram *decode_latency;  // in seconds, per chunk or per utterance
+  Histogram *rtf;             // real-time factor, per chunk or per utterance
+};
+
+const AsrMetrics &GetOnlineAsrMetrics();
+const AsrMetrics &GetOfflineAsrMetrics();
+
+struct VadMetrics {
+  Counter *segments;  // number of speech segments emitted
+  Counter *speech_seconds;
+};
+
+const VadMetrics &GetVadMetrics();
+
+struct TtsMetrics {
+  Counter *samples;  // number of generated samples
+  Counter *audio_seconds;
+  Histogram *generate_latency;  // in seconds, per call of Generate()
+};
+
+const TtsMetrics &GetTtsMetrics();
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_METRICS_H_
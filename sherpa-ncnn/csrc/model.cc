@@ -20,8 +20,10 @@
 #include <sstream>
 
 #include "sherpa-ncnn/csrc/conv-emformer-model.h"
+#include "sherpa-ncnn/csrc/execution-profile.h"
 #include "sherpa-ncnn/csrc/lstm-model.h"
 #include "sherpa-ncnn/csrc/meta-data.h"
+#include "sherpa-ncnn/csrc/metrics-allocator.h"
 #include "sherpa-ncnn/csrc/poolingmodulenoproj.h"
 #include "sherpa-ncnn/csrc/simpleupsample.h"
 #include "sherpa-ncnn/csrc/stack.h"
@@ -30,6 +32,18 @@
 
 namespace sherpa_ncnn {
 
+bool ModelConfig::Validate() const {
+  if (!IsValidExecutionProfile(execution_profile)) {
+    NCNN_LOGE(
+        "Unknown execution profile '%s'. Valid values are: accurate, "
+        "balanced, fast, or an empty string",
+        execution_profile.c_str());
+    return false;
+  }
+
+  return true;
+}
+
 std::string ModelConfig::ToString() const {
   std::ostringstream os;
   os << "ModelConfig(";
@@ -42,7 +56,9 @@ std::string ModelConfig::ToString() const {
   os << "tokens=\"" << tokens << "\", ";
   os << "encoder num_threads=" << encoder_opt.num_threads << ", ";
   os << "decoder num_threads=" << decoder_opt.num_threads << ", ";
-  os << "joiner num_threads=" << joiner_opt.num_threads << ")";
+  os << "joiner num_threads=" << joiner_opt.num_threads << ", ";
+  os << "execution_profile=\"" << execution_profile << "\", ";
+  os << "enable_profiling=" << (enable_profiling ? "True" : "False") << ")";
 
   return os.str();
 }
@@ -125,6 +141,8 @@ static bool IsZipformerModel(const ncnn::Net &net) {
 
 void Model::InitNet(ncnn::Net &net, const std::string &param,
                     const std::string &bin) {
+  UseMetricsAllocator(&net);
+
   if (net.load_param(param.c_str())) {
     NCNN_LOGE("failed to load %s", param.c_str());
     exit(-1);
@@ -139,6 +157,8 @@ void Model::InitNet(ncnn::Net &net, const std::string &param,
 #if __ANDROID_API__ >= 9
 void Model::InitNet(AAssetManager *mgr, ncnn::Net &net,
                     const std::string &param, const std::string &bin) {
+  UseMetricsAllocator(&net);
+
   if (net.load_param(mgr, param.c_str())) {
     NCNN_LOGE("failed to load %s", param.c_str());
     exit(-1);
@@ -160,13 +180,32 @@ void Model::RegisterCustomLayers(ncnn::Net &net) {
   RegisterStackLayer(net);                 // for zipformer only
 }
 
-std::unique_ptr<Model> Model::Create(const ModelConfig &config) {
+std::unique_ptr<Model> Model::EnableProfiling(std::unique_ptr<Model> model,
+                                              const ModelConfig &config) {
+  if (!config.enable_profiling) {
+    return model;
+  }
+
+  model->profiler_ = std::make_unique<LayerProfiler>();
+  model->profiler_->Attach("encoder", &model->GetEncoder());
+  model->profiler_->Attach("decoder", &model->GetDecoder());
+  model->profiler_->Attach("joiner", &model->GetJoiner());
+
+  return model;
+}
+
+std::unique_ptr<Model> Model::Create(const ModelConfig &model_config) {
   // 1. Load the encoder network
   // 2. If the encoder network has LSTM layers, we assume it is a LstmModel
   // 3. Otherwise, we assume it is a ConvEmformer
   // 4. TODO(fangjun): We need to change this function to support more models
   // in the future
 
+  ModelConfig config = model_config;
+  if (!ApplyExecutionProfile(&config)) {
+    return nullptr;
+  }
+
   ncnn::Net net;
   RegisterCustomLayers(net);
 
@@ -177,15 +216,16 @@ std::unique_ptr<Model> Model::Create(const ModelConfig &config) {
   }
 
   if (IsLstmModel(net)) {
-    return std::make_unique<LstmModel>(config);
+    return EnableProfiling(std::make_unique<LstmModel>(config), config);
   }
 
   if (IsConvEmformerModel(net)) {
-    return std::make_unique<ConvEmformerModel>(config);
+    return EnableProfiling(std::make_unique<ConvEmformerModel>(config),
+                           config);
   }
 
   if (IsZipformerModel(net)) {
-    return std::make_unique<ZipformerModel>(config);
+    return EnableProfiling(std::make_unique<ZipformerModel>(config), config);
   }
 
   NCNN_LOGE(
@@ -204,7 +244,12 @@ std::unique_ptr<Model> Model::Create(const ModelConfig &config) {
 
 #if __ANDROID_API__ >= 9
 std::unique_ptr<Model> Model::Create(AAssetManager *mgr,
-                                     const ModelConfig &config) {
+                                     const ModelConfig &model_config) {
+  ModelConfig config = model_config;
+  if (!ApplyExecutionProfile(mgr, &config)) {
+    return nullptr;
+  }
+
   ncnn::Net net;
   RegisterCustomLayers(net);
 
@@ -215,15 +260,18 @@ std::unique_ptr<Model> Model::Create(AAssetManager *mgr,
   }
 
   if (IsLstmModel(net)) {
-    return std::make_unique<LstmModel>(mgr, config);
+    return EnableProfiling(std::make_unique<LstmModel>(mgr, config),
+                           config);
   }
 
   if (IsConvEmformerModel(net)) {
-    return std::make_unique<ConvEmformerModel>(mgr, config);
+    return EnableProfiling(std::make_unique<ConvEmformerModel>(mgr, config),
+                           config);
   }
 
   if (IsZipformerModel(net)) {
-    return std::make_unique<ZipformerModel>(mgr, config);
+    return EnableProfiling(std::make_unique<ZipformerModel>(mgr, config),
+                           config);
   }
 
   NCNN_LOGE(
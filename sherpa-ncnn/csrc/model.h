@@ -25,6 +25,7 @@
 #include <vector>
 
 #include "net.h"  // NOLINT
+#include "sherpa-ncnn/csrc/layer-profiler.h"
 
 namespace sherpa_ncnn {
 
@@ -38,10 +39,21 @@ struct ModelConfig {
   std::string tokens;         // path to tokens.txt
   bool use_vulkan_compute = true;
 
+  // true to measure the time spent in each layer of the encoder, decoder
+  // and joiner. See Recognizer::GetProfilingReport()
+  bool enable_profiling = false;
+
+  // accurate, balanced, fast, or empty to use encoder_opt, decoder_opt
+  // and joiner_opt as they are. See ApplyExecutionProfile()
+  std::string execution_profile;
+
   ncnn::Option encoder_opt;
   ncnn::Option decoder_opt;
   ncnn::Option joiner_opt;
 
+  // Return false if the config cannot be used to create a model
+  bool Validate() const;
+
   std::string ToString() const;
 };
 
@@ -139,6 +151,15 @@ class Model {
   static void InitNet(AAssetManager *mgr, ncnn::Net &net,
                       const std::string &param, const std::string &bin);
 #endif
+
+  // Return null unless ModelConfig::enable_profiling is true
+  LayerProfiler *GetProfiler() const { return profiler_.get(); }
+
+ private:
+  static std::unique_ptr<Model> EnableProfiling(std::unique_ptr<Model> model,
+                                                const ModelConfig &config);
+
+  std::unique_ptr<LayerProfiler> profiler_;
 };
 
 }  // namespace sherpa_ncnn
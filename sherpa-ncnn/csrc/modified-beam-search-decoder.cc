@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "sherpa-ncnn/csrc/math.h"
+#include "sherpa-ncnn/csrc/stats.h"
 
 namespace sherpa_ncnn {
 
@@ -44,12 +45,12 @@ DecoderResult ModifiedBeamSearchDecoder::GetEmptyResult() const {
 void ModifiedBeamSearchDecoder::StripLeadingBlanks(DecoderResult *r) const {
   int32_t context_size = model_->ContextSize();
   auto hyp = r->hyps.GetMostProbable(true);
+  r->SetBestPath(hyp);
 
-  auto start = hyp.ys.begin() + context_size;
-  auto end = hyp.ys.end();
+  auto start = r->tokens.begin() + context_size;
+  auto end = r->tokens.end();
 
   r->tokens = std::vector<int32_t>(start, end);
-  r->timestamps = std::move(hyp.timestamps);
   r->num_trailing_blanks = hyp.num_trailing_blanks;
 }
 
@@ -77,6 +78,8 @@ static void LogSoftmax(ncnn::Mat *in_out) {
 //
 // TODO(fangjun): Change Embed in ncnn to output 2-d tensors
 static ncnn::Mat RunDecoder2D(Model *model_, ncnn::Mat decoder_input) {
+  ScopedStageTimer timer(StatsStage::kDecoder);
+
   ncnn::Mat decoder_out;
   int32_t h = decoder_input.h;
 
@@ -143,7 +146,11 @@ void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
     // decoder_out.h == num_active_paths
     ncnn::Mat encoder_out_t(encoder_out.w, 1, encoder_out.row(t));
 
-    ncnn::Mat joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
+    ncnn::Mat joiner_out;
+    {
+      ScopedStageTimer timer(StatsStage::kJoiner);
+      joiner_out = model_->RunJoiner(encoder_out_t, decoder_out);
+    }
     // joiner_out.w == vocab_size
     // joiner_out.h == num_active_paths
     LogSoftmax(&joiner_out);
@@ -182,6 +189,13 @@ void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
           context_score = std::get<0>(context_res);
           new_hyp.context_state = std::get<1>(context_res);
         }
+
+        if (s && s->GetOverlayContextGraph()) {
+          auto context_res = s->GetOverlayContextGraph()->ForwardOneStep(
+              new_hyp.overlay_context_state, new_token, false /*strict_mode*/);
+          context_score += std::get<0>(context_res);
+          new_hyp.overlay_context_state = std::get<1>(context_res);
+        }
       } else {
         ++new_hyp.num_trailing_blanks;
       }
@@ -198,10 +212,71 @@ void ModifiedBeamSearchDecoder::Decode(ncnn::Mat encoder_out, Stream *s,
 
   // set decoder_out in case of endpointing
   ncnn::Mat decoder_input = BuildDecoderInput({hyp});
-  result->decoder_out = model_->RunDecoder(decoder_input);
+  {
+    ScopedStageTimer timer(StatsStage::kDecoder);
+    result->decoder_out = model_->RunDecoder(decoder_input);
+  }
 
-  result->tokens = std::move(hyp.ys);
+  result->SetBestPath(hyp);
   result->num_trailing_blanks = hyp.num_trailing_blanks;
+
+  UpdateNumStableTokens(result);
+  CommitStableTokens(result);
+}
+
+void ModifiedBeamSearchDecoder::UpdateNumStableTokens(
+    DecoderResult *result) const {
+  // Hypotheses are only extended, so tokens shared by all of them
+  // won't change. Tokens before num_stable_tokens are known to be shared.
+  int32_t n = result->num_stable_tokens;
+  int32_t offset = result->num_committed_tokens;
+  const auto &tokens = result->tokens;
+
+  for (; n < static_cast<int32_t>(tokens.size()); ++n) {
+    bool shared = true;
+    for (const auto &p : result->hyps) {
+      const auto &ys = p.second.ys;
+      int32_t i = n - offset;
+      if (i >= static_cast<int32_t>(ys.size()) || ys[i] != tokens[n]) {
+        shared = false;
+        break;
+      }
+    }
+
+    if (!shared) {
+      break;
+    }
+  }
+
+  result->num_stable_tokens = n;
+}
+
+void ModifiedBeamSearchDecoder::CommitStableTokens(
+    DecoderResult *result) const {
+  // Each hypothesis keeps at least context_size tokens for the decoder input
+  int32_t context_size = model_->ContextSize();
+  int32_t n = result->num_stable_tokens - context_size -
+              result->num_committed_tokens;
+
+  // Rebuilding the hypotheses is not free, so we do it only when
+  // there are enough tokens to remove
+  if (n < kMinTokensToCommit) {
+    return;
+  }
+
+  std::vector<Hypothesis> hyps;
+  hyps.reserve(result->hyps.Size());
+  for (auto &p : result->hyps) {
+    Hypothesis &hyp = p.second;
+    hyp.ys.erase(hyp.ys.begin(), hyp.ys.begin() + n);
+    hyp.timestamps.erase(hyp.timestamps.begin(), hyp.timestamps.begin() + n);
+    hyp.num_committed_tokens += n;
+    hyps.push_back(std::move(hyp));
+  }
+
+  // Keys of the hypotheses have changed
+  result->hyps = Hypotheses(std::move(hyps));
+  result->num_committed_tokens += n;
 }
 
 }  // namespace sherpa_ncnn
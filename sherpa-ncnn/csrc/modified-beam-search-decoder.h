@@ -45,6 +45,15 @@ class ModifiedBeamSearchDecoder : public Decoder {
  private:
   ncnn::Mat BuildDecoderInput(const std::vector<Hypothesis> &hyps) const;
 
+  // Update result->num_stable_tokens from result->hyps
+  void UpdateNumStableTokens(DecoderResult *result) const;
+
+  // Remove stable tokens from result->hyps. They are kept in
+  // result->tokens.
+  void CommitStableTokens(DecoderResult *result) const;
+
+  static constexpr int32_t kMinTokensToCommit = 32;
+
  private:
   Model *model_;  // not owned
   int32_t num_active_paths_;
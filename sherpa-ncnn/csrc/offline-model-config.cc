@@ -21,6 +21,10 @@ void OfflineModelConfig::Register(ParseOptions *po) {
 
   po->Register("debug", &debug,
                "true to print model information while loading it.");
+
+  po->Register("enable-profiling", &enable_profiling,
+               "true to measure the time spent in each layer of the model. "
+               "The report is printed after decoding.");
 }
 
 bool OfflineModelConfig::Validate() const {
@@ -52,7 +56,8 @@ std::string OfflineModelConfig::ToString() const {
   os << "sense_voice=" << sense_voice.ToString() << ", ";
   os << "tokens=\"" << tokens << "\", ";
   os << "num_threads=" << num_threads << ", ";
-  os << "debug=" << (debug ? "True" : "False") << ")";
+  os << "debug=" << (debug ? "True" : "False") << ", ";
+  os << "enable_profiling=" << (enable_profiling ? "True" : "False") << ")";
 
   return os.str();
 }
@@ -17,13 +17,19 @@ struct OfflineModelConfig {
   int32_t num_threads = 2;
   bool debug = false;
 
+  // true to measure the time spent in each layer of the model.
+  // See OfflineRecognizer::GetProfilingReport()
+  bool enable_profiling = false;
+
   OfflineModelConfig() = default;
   OfflineModelConfig(const OfflineSenseVoiceModelConfig &sense_voice,
-                     const std::string &tokens, int32_t num_threads, bool debug)
+                     const std::string &tokens, int32_t num_threads, bool debug,
+                     bool enable_profiling = false)
       : sense_voice(sense_voice),
         tokens(tokens),
         num_threads(num_threads),
-        debug(debug) {}
+        debug(debug),
+        enable_profiling(enable_profiling) {}
 
   void Register(ParseOptions *po);
   bool Validate() const;
@@ -9,9 +9,11 @@
 #include <string>
 #include <vector>
 
+#include "sherpa-ncnn/csrc/layer-profiler.h"
 #include "sherpa-ncnn/csrc/macros.h"
 #include "sherpa-ncnn/csrc/offline-recognizer.h"
 #include "sherpa-ncnn/csrc/offline-stream.h"
+#include "sherpa-ncnn/csrc/stats.h"
 
 namespace sherpa_ncnn {
 
@@ -32,6 +34,18 @@ class OfflineRecognizerImpl {
 
   virtual void SetConfig(const OfflineRecognizerConfig &config) = 0;
   virtual OfflineRecognizerConfig GetConfig() const = 0;
+
+  StatsReport GetStats() const { return stats_->Get(); }
+
+  void ResetStats() { stats_->Reset(); }
+
+  // Return null if profiling is not enabled
+  virtual LayerProfiler *GetProfiler() const { return nullptr; }
+
+ protected:
+  // Time spent in each stage, summed over all streams. Streams share
+  // it, so it lives as long as the last of them.
+  std::shared_ptr<Stats> stats_ = std::make_shared<Stats>();
 };
 
 }  // namespace sherpa_ncnn
@@ -6,12 +6,14 @@
 #define SHERPA_NCNN_CSRC_OFFLINE_RECOGNIZER_SENSE_VOICE_IMPL_H_
 
 #include <algorithm>
+#include <chrono>  // NOLINT
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/metrics.h"
 #include "sherpa-ncnn/csrc/offline-ctc-greedy-search-decoder.h"
 #include "sherpa-ncnn/csrc/offline-model-config.h"
 #include "sherpa-ncnn/csrc/offline-recognizer-impl.h"
@@ -77,7 +79,9 @@ class OfflineRecognizerSenseVoiceImpl : public OfflineRecognizerImpl {
   }
 
   std::unique_ptr<OfflineStream> CreateStream() const override {
-    return std::make_unique<OfflineStream>(config_.feat_config);
+    auto stream = std::make_unique<OfflineStream>(config_.feat_config);
+    stream->SetSharedStats(stats_);
+    return stream;
   }
 
   void DecodeStreams(OfflineStream **ss, int32_t n) const override {
@@ -92,6 +96,10 @@ class OfflineRecognizerSenseVoiceImpl : public OfflineRecognizerImpl {
 
   OfflineRecognizerConfig GetConfig() const override { return config_; }
 
+  LayerProfiler *GetProfiler() const override {
+    return model_->GetProfiler();
+  }
+
  private:
   void Init() {
     const auto &meta_data = model_->GetModelMetadata();
@@ -118,9 +126,17 @@ class OfflineRecognizerSenseVoiceImpl : public OfflineRecognizerImpl {
 
   void DecodeOneStream(OfflineStream *s) const {
     const auto &meta_data = model_->GetModelMetadata();
-
-    ncnn::Mat f = s->GetFrames();
-    f = ApplyLFR(f);
+    auto start = std::chrono::steady_clock::now();
+
+    ncnn::Mat f;
+    int32_t num_frames;
+    {
+      ScopedStageTimer timer(StatsStage::kFeature, &s->GetStats(),
+                             stats_.get());
+      f = s->GetFrames();
+      num_frames = f.h;
+      f = ApplyLFR(f);
+    }
 
     int32_t language = 0;
     if (config_.model_config.sense_voice.language.empty()) {
@@ -138,8 +154,15 @@ class OfflineRecognizerSenseVoiceImpl : public OfflineRecognizerImpl {
                             ? meta_data.with_itn_id
                             : meta_data.without_itn_id;
 
-    ncnn::Mat logits = model_->Forward(f, language, text_norm);
+    ncnn::Mat logits;
+    {
+      ScopedStageTimer timer(StatsStage::kEncoder, &s->GetStats(),
+                             stats_.get());
+      logits = model_->Forward(f, language, text_norm);
+    }
 
+    ScopedStageTimer timer(StatsStage::kSearch, &s->GetStats(),
+                           stats_.get());
     auto result = decoder_->Decode(logits);
 
     int32_t frame_shift_ms = 10;
@@ -147,6 +170,21 @@ class OfflineRecognizerSenseVoiceImpl : public OfflineRecognizerImpl {
     auto r = ConvertSenseVoiceResult(result, symbol_table_, frame_shift_ms,
                                      subsampling_factor);
     s->SetResult(r);
+
+    float elapsed_seconds =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count() /
+        1e6f;
+    float audio_seconds = num_frames * frame_shift_ms / 1000.0f;
+
+    const auto &metrics = GetOfflineAsrMetrics();
+    metrics.audio_seconds->Inc(audio_seconds);
+    metrics.decode_seconds->Inc(elapsed_seconds);
+    metrics.decode_latency->Observe(elapsed_seconds);
+    if (audio_seconds > 0) {
+      metrics.rtf->Observe(elapsed_seconds / audio_seconds);
+    }
   }
 
   ncnn::Mat ApplyLFR(const ncnn::Mat &in) const {
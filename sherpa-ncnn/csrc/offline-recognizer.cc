@@ -80,6 +80,22 @@ OfflineRecognizerConfig OfflineRecognizer::GetConfig() const {
   return impl_->GetConfig();
 }
 
+StatsReport OfflineRecognizer::GetStats() const { return impl_->GetStats(); }
+
+void OfflineRecognizer::ResetStats() { impl_->ResetStats(); }
+
+std::string OfflineRecognizer::GetProfilingReport() const {
+  auto profiler = impl_->GetProfiler();
+  return profiler ? profiler->Report() : "";
+}
+
+void OfflineRecognizer::ResetProfiling() {
+  auto profiler = impl_->GetProfiler();
+  if (profiler) {
+    profiler->Reset();
+  }
+}
+
 #if __ANDROID_API__ >= 9
 template OfflineRecognizer::OfflineRecognizer(
     AAssetManager *mgr, const OfflineRecognizerConfig &config);
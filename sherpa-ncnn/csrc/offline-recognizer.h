@@ -13,6 +13,7 @@
 #include "sherpa-ncnn/csrc/offline-model-config.h"
 #include "sherpa-ncnn/csrc/offline-stream.h"
 #include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/stats.h"
 
 namespace sherpa_ncnn {
 
@@ -77,6 +78,25 @@ class OfflineRecognizer {
 
   OfflineRecognizerConfig GetConfig() const;
 
+  /** Return the time spent in each stage, summed over all streams
+   * created by this recognizer. For SenseVoice, the encoder stage is the
+   * whole model and the decoder and joiner stages are not used.
+   *
+   * Times are measured only if sherpa-ncnn is built with
+   * -DSHERPA_NCNN_ENABLE_STATS=ON.
+   */
+  StatsReport GetStats() const;
+
+  void ResetStats();
+
+  /** Return the time spent in each layer of the model, sorted by time.
+   * It returns an empty string unless
+   * OfflineModelConfig::enable_profiling is true.
+   */
+  std::string GetProfilingReport() const;
+
+  void ResetProfiling();
+
  private:
   std::unique_ptr<OfflineRecognizerImpl> impl_;
 };
@@ -24,6 +24,7 @@
 #include "net.h"  // NOLINT
 #include "sherpa-ncnn/csrc/file-utils.h"
 #include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/metrics-allocator.h"
 #include "sherpa-ncnn/csrc/text-utils.h"
 
 namespace sherpa_ncnn {
@@ -87,6 +88,7 @@ class OfflineSenseVoiceModel::Impl {
       : config_(config), pos_encoder_(560) {
     InitNet();
     PostInit();
+    InitProfiler();
   }
 
   template <typename Manager>
@@ -94,6 +96,7 @@ class OfflineSenseVoiceModel::Impl {
       : config_(config), pos_encoder_(560) {
     InitNet(mgr);
     PostInit();
+    InitProfiler();
   }
 
   ncnn::Mat Forward(const ncnn::Mat &features, int32_t language,
@@ -124,7 +127,16 @@ class OfflineSenseVoiceModel::Impl {
     return meta_data_;
   }
 
+  LayerProfiler *GetProfiler() const { return profiler_.get(); }
+
  private:
+  void InitProfiler() {
+    if (config_.enable_profiling) {
+      profiler_ = std::make_unique<LayerProfiler>();
+      profiler_->Attach("model", &net_);
+    }
+  }
+
   void PostInit() {
     meta_data_.vocab_size = 25055;
     meta_data_.window_size = 7;
@@ -148,6 +160,7 @@ class OfflineSenseVoiceModel::Impl {
 
   void InitNet() {
     net_.opt.num_threads = config_.num_threads;
+    UseMetricsAllocator(&net_);
 
     std::string param = config_.sense_voice.model_dir + "/model.ncnn.param";
     std::string bin = config_.sense_voice.model_dir + "/model.ncnn.bin";
@@ -173,6 +186,7 @@ class OfflineSenseVoiceModel::Impl {
     }
 
     net_.opt.num_threads = config_.num_threads;
+    UseMetricsAllocator(&net_);
 
     std::string param = config_.sense_voice.model_dir + "/model.ncnn.param";
     std::string bin = config_.sense_voice.model_dir + "/model.ncnn.bin";
@@ -193,6 +207,7 @@ class OfflineSenseVoiceModel::Impl {
   SinusoidalPositionEncoder pos_encoder_;
 
   ncnn::Net net_;
+  std::unique_ptr<LayerProfiler> profiler_;
 
   OfflineSenseVoiceModelMetaData meta_data_;
 };
@@ -213,6 +228,10 @@ ncnn::Mat OfflineSenseVoiceModel::Forward(const ncnn::Mat &features,
   return impl_->Forward(features, language, text_norm);
 }
 
+LayerProfiler *OfflineSenseVoiceModel::GetProfiler() const {
+  return impl_->GetProfiler();
+}
+
 const OfflineSenseVoiceModelMetaData &OfflineSenseVoiceModel::GetModelMetadata()
     const {
   return impl_->GetModelMetadata();
@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/layer-profiler.h"
 #include "sherpa-ncnn/csrc/offline-model-config.h"
 #include "sherpa-ncnn/csrc/offline-sense-voice-model-meta-data.h"
 
@@ -41,6 +42,9 @@ class OfflineSenseVoiceModel {
 
   const OfflineSenseVoiceModelMetaData &GetModelMetadata() const;
 
+  // Return null unless OfflineModelConfig::enable_profiling is true
+  LayerProfiler *GetProfiler() const;
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
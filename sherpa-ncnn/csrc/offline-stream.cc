@@ -10,18 +10,26 @@
 #include <cstdint>
 #include <iomanip>
 #include <limits>
+#include <memory>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 #include "kaldi-native-fbank/csrc/online-feature.h"
 #include "mat.h"  // NOLINT
+#include "sherpa-ncnn/csrc/batch-fbank.h"
 #include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/metrics.h"
 #include "sherpa-ncnn/csrc/offline-recognizer.h"
 #include "sherpa-ncnn/csrc/resample.h"
+#include "sherpa-ncnn/csrc/stats.h"
 
 namespace sherpa_ncnn {
 
 class OfflineStream::Impl {
+  // Number of input samples to scale and resample at a time
+  static constexpr int32_t kChunkSize = 16000;
+
  public:
   explicit Impl(const FeatureExtractorConfig &config) : config_(config) {
     knf::FbankOptions opts;
@@ -40,23 +48,18 @@ class OfflineStream::Impl {
 
     opts.mel_opts.is_librosa = config.is_librosa;
 
-    fbank_ = std::make_unique<knf::OnlineFbank>(opts);
+    fbank_ = std::make_unique<OnlineBatchFbank>(opts);
+
+    GetOfflineAsrMetrics().active_streams->Inc();
   }
 
+  ~Impl() { GetOfflineAsrMetrics().active_streams->Dec(); }
+
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n) {
-    if (config_.normalize_samples) {
-      AcceptWaveformImpl(sampling_rate, waveform, n);
-    } else {
-      std::vector<float> buf(n);
-      for (int32_t i = 0; i != n; ++i) {
-        buf[i] = waveform[i] * 32768;
-      }
-      AcceptWaveformImpl(sampling_rate, buf.data(), n);
-    }
-  }
+    ScopedStageTimer timer(StatsStage::kFeature, &stats_,
+                           shared_stats_.get());
 
-  void AcceptWaveformImpl(int32_t sampling_rate, const float *waveform,
-                          int32_t n) {
+    std::unique_ptr<LinearResample> resampler;
     if (sampling_rate != config_.sampling_rate) {
       SHERPA_NCNN_LOGE(
           "Creating a resampler:\n"
@@ -68,19 +71,43 @@ class OfflineStream::Impl {
       float lowpass_cutoff = 0.99 * 0.5 * min_freq;
 
       int32_t lowpass_filter_width = 6;
-      auto resampler = std::make_unique<LinearResample>(
+      resampler = std::make_unique<LinearResample>(
           sampling_rate, config_.sampling_rate, lowpass_cutoff,
           lowpass_filter_width);
-      std::vector<float> samples;
-      resampler->Resample(waveform, n, true, &samples);
+    }
 
-      fbank_->AcceptWaveform(config_.sampling_rate, samples.data(),
-                             samples.size());
+    if (config_.normalize_samples && !resampler) {
+      fbank_->AcceptWaveform(sampling_rate, waveform, n);
       fbank_->InputFinished();
       return;
-    }  // if (sampling_rate != config_.sampling_rate)
+    }
+
+    // Scale and resample the input chunk by chunk so that the memory used
+    // here does not depend on the length of the input
+    std::vector<float> buf;
+    std::vector<float> samples;
+    for (int32_t start = 0; start < n; start += kChunkSize) {
+      int32_t this_chunk = std::min(kChunkSize, n - start);
+      const float *p = waveform + start;
+
+      if (!config_.normalize_samples) {
+        buf.resize(this_chunk);
+        for (int32_t i = 0; i != this_chunk; ++i) {
+          buf[i] = p[i] * 32768;
+        }
+        p = buf.data();
+      }
+
+      if (resampler) {
+        bool flush = start + this_chunk == n;
+        resampler->Resample(p, this_chunk, flush, &samples);
+        fbank_->AcceptWaveform(config_.sampling_rate, samples.data(),
+                               samples.size());
+      } else {
+        fbank_->AcceptWaveform(sampling_rate, p, this_chunk);
+      }
+    }
 
-    fbank_->AcceptWaveform(sampling_rate, waveform, n);
     fbank_->InputFinished();
   }
 
@@ -107,10 +134,18 @@ class OfflineStream::Impl {
 
   const OfflineRecognizerResult &GetResult() const { return r_; }
 
+  Stats &GetStats() { return stats_; }
+
+  void SetSharedStats(std::shared_ptr<Stats> stats) {
+    shared_stats_ = std::move(stats);
+  }
+
  private:
   FeatureExtractorConfig config_;
-  std::unique_ptr<knf::OnlineFbank> fbank_;
+  std::unique_ptr<OnlineBatchFbank> fbank_;
   OfflineRecognizerResult r_;
+  Stats stats_;
+  std::shared_ptr<Stats> shared_stats_;
 };
 
 OfflineStream::OfflineStream(const FeatureExtractorConfig &config /*= {}*/)
@@ -134,6 +169,16 @@ void OfflineStream::SetResult(const OfflineRecognizerResult &r) {
 const OfflineRecognizerResult &OfflineStream::GetResult() const {
   return impl_->GetResult();
 }
+
+Stats &OfflineStream::GetStats() { return impl_->GetStats(); }
+
+StatsReport OfflineStream::GetStatsReport() const {
+  return impl_->GetStats().Get();
+}
+
+void OfflineStream::SetSharedStats(std::shared_ptr<Stats> stats) {
+  impl_->SetSharedStats(std::move(stats));
+}
 std::string OfflineRecognizerResult::AsJsonString() const {
   std::ostringstream os;
   os << "{";
@@ -13,6 +13,7 @@
 #include "math.h"  // NOLINT
 #include "sherpa-ncnn/csrc/features.h"
 #include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/stats.h"
 
 namespace sherpa_ncnn {
 
@@ -78,6 +79,17 @@ class OfflineStream {
   /** Get the recognition result of this stream */
   const OfflineRecognizerResult &GetResult() const;
 
+  /** Time spent on this stream in each stage. See also
+   * Stream::GetStats().
+   */
+  Stats &GetStats();
+  StatsReport GetStatsReport() const;
+
+  /** Time spent in each stage is also added to the given object. The
+   * stream keeps it alive, so the recognizer may be destroyed first.
+   */
+  void SetSharedStats(std::shared_ptr<Stats> stats);
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
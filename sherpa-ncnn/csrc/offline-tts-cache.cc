@@ -0,0 +1,223 @@
+// sherpa-ncnn/csrc/offline-tts-cache.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/offline-tts-cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/macros.h"
+
+namespace sherpa_ncnn {
+
+// Used to detect files that are not written by us
+static constexpr char kMagic[4] = {'S', 'N', 'T', 'C'};
+
+template <typename T>
+static void AppendBytes(const T &v, std::string *s) {
+  s->append(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+// 64-bit FNV-1a
+static uint64_t Hash(const std::string &s) {
+  uint64_t h = 14695981039346656037ull;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+OfflineTtsCache::OfflineTtsCache(int32_t max_num_entries,
+                                 const std::string &cache_dir)
+    : max_num_entries_(max_num_entries), cache_dir_(cache_dir) {}
+
+std::string OfflineTtsCache::MakeKey(const std::string &model_id,
+                                     const std::vector<int32_t> &tokens,
+                                     int32_t sid, float speed,
+                                     float noise_scale, float noise_scale_w,
+                                     int64_t seed) {
+  // The key is a binary string. We include the model ID verbatim so that
+  // different models never share an entry.
+  std::string key;
+  key.reserve(model_id.size() + 1 + (tokens.size() + 7) * 4);
+
+  key.append(model_id);
+  key.push_back('\0');
+
+  AppendBytes(sid, &key);
+  AppendBytes(speed, &key);
+  AppendBytes(noise_scale, &key);
+  AppendBytes(noise_scale_w, &key);
+  AppendBytes(seed, &key);
+
+  int32_t num_tokens = static_cast<int32_t>(tokens.size());
+  AppendBytes(num_tokens, &key);
+  for (int32_t t : tokens) {
+    AppendBytes(t, &key);
+  }
+
+  return key;
+}
+
+bool OfflineTtsCache::Get(const std::string &key,
+                          std::vector<float> *samples) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      // move it to the front
+      entries_.splice(entries_.begin(), entries_, it->second);
+      *samples = it->second->second;
+      return true;
+    }
+  }
+
+  if (cache_dir_.empty() || !LoadFromDisk(key, samples)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  PutInMemory(key, *samples);
+
+  return true;
+}
+
+void OfflineTtsCache::Put(const std::string &key,
+                          const std::vector<float> &samples) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PutInMemory(key, samples);
+  }
+
+  if (!cache_dir_.empty()) {
+    SaveToDisk(key, samples);
+  }
+}
+
+int32_t OfflineTtsCache::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return static_cast<int32_t>(entries_.size());
+}
+
+void OfflineTtsCache::PutInMemory(const std::string &key,
+                                  std::vector<float> samples) {
+  if (max_num_entries_ <= 0) {
+    return;
+  }
+
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    it->second->second = std::move(samples);
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return;
+  }
+
+  entries_.emplace_front(key, std::move(samples));
+  index_[key] = entries_.begin();
+
+  while (static_cast<int32_t>(entries_.size()) > max_num_entries_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+}
+
+std::string OfflineTtsCache::GetFilename(const std::string &key) const {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%016llx.bin",
+           static_cast<unsigned long long>(Hash(key)));  // NOLINT
+
+  return cache_dir_ + "/" + buf;
+}
+
+bool OfflineTtsCache::LoadFromDisk(const std::string &key,
+                                   std::vector<float> *samples) const {
+  std::ifstream is(GetFilename(key), std::ios::binary);
+  if (!is) {
+    return false;
+  }
+
+  char magic[4];
+  uint32_t key_size = 0;
+  is.read(magic, sizeof(magic));
+  is.read(reinterpret_cast<char *>(&key_size), sizeof(key_size));
+  if (!is || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+      key_size != key.size()) {
+    return false;
+  }
+
+  // Two different keys may have the same hash, so we compare the full key
+  std::string saved_key(key_size, '\0');
+  is.read(&saved_key[0], key_size);
+  if (!is || saved_key != key) {
+    return false;
+  }
+
+  uint32_t num_samples = 0;
+  is.read(reinterpret_cast<char *>(&num_samples), sizeof(num_samples));
+  if (!is) {
+    return false;
+  }
+
+  std::vector<float> ans(num_samples);
+  is.read(reinterpret_cast<char *>(ans.data()), num_samples * sizeof(float));
+  if (!is) {
+    SHERPA_NCNN_LOGE("Truncated tts cache file '%s'", GetFilename(key).c_str());
+    return false;
+  }
+
+  *samples = std::move(ans);
+
+  return true;
+}
+
+void OfflineTtsCache::SaveToDisk(const std::string &key,
+                                 const std::vector<float> &samples) const {
+  std::string filename = GetFilename(key);
+
+  // Write to a temporary file first and then rename it, so that concurrent
+  // readers never see a partially written file.
+  std::ostringstream tmp;
+  tmp << filename << ".tmp." << std::this_thread::get_id();
+
+  {
+    std::ofstream os(tmp.str(), std::ios::binary);
+    if (!os) {
+      SHERPA_NCNN_LOGE("Failed to create '%s'", tmp.str().c_str());
+      return;
+    }
+
+    uint32_t key_size = static_cast<uint32_t>(key.size());
+    uint32_t num_samples = static_cast<uint32_t>(samples.size());
+
+    os.write(kMagic, sizeof(kMagic));
+    os.write(reinterpret_cast<const char *>(&key_size), sizeof(key_size));
+    os.write(key.data(), key.size());
+    os.write(reinterpret_cast<const char *>(&num_samples),
+             sizeof(num_samples));
+    os.write(reinterpret_cast<const char *>(samples.data()),
+             samples.size() * sizeof(float));
+
+    if (!os) {
+      SHERPA_NCNN_LOGE("Failed to write '%s'", tmp.str().c_str());
+      os.close();
+      std::remove(tmp.str().c_str());
+      return;
+    }
+  }
+
+  if (std::rename(tmp.str().c_str(), filename.c_str()) != 0) {
+    SHERPA_NCNN_LOGE("Failed to rename '%s' to '%s'", tmp.str().c_str(),
+                     filename.c_str());
+    std::remove(tmp.str().c_str());
+  }
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,74 @@
+// sherpa-ncnn/csrc/offline-tts-cache.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_OFFLINE_TTS_CACHE_H_
+#define SHERPA_NCNN_CSRC_OFFLINE_TTS_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sherpa_ncnn {
+
+/** A content-addressed cache for synthesized audio.
+ *
+ * Entries are keyed by everything that affects the output of the model
+ * for a single sentence, i.e., the model, the token IDs, the speaker ID,
+ * the speed, the noise scales, and the seed. See MakeKey().
+ *
+ * It has two tiers:
+ *
+ *  - An in-memory LRU tier holding at most `max_num_entries` entries.
+ *  - An optional on-disk tier. If `cache_dir` is not empty, each entry
+ *    is also saved to `cache_dir/<hash>.bin` and is looked up there on
+ *    a miss in memory, so that the cache survives process restarts.
+ *
+ * All methods are thread-safe.
+ */
+class OfflineTtsCache {
+ public:
+  OfflineTtsCache(int32_t max_num_entries, const std::string &cache_dir);
+
+  static std::string MakeKey(const std::string &model_id,
+                             const std::vector<int32_t> &tokens, int32_t sid,
+                             float speed, float noise_scale,
+                             float noise_scale_w, int64_t seed);
+
+  // Return true and fill `samples` if the key is found.
+  // Return false otherwise.
+  bool Get(const std::string &key, std::vector<float> *samples);
+
+  void Put(const std::string &key, const std::vector<float> &samples);
+
+  // Number of entries in the in-memory tier
+  int32_t Size() const;
+
+ private:
+  using Entry = std::pair<std::string, std::vector<float>>;
+
+  void PutInMemory(const std::string &key, std::vector<float> samples);
+
+  std::string GetFilename(const std::string &key) const;
+  bool LoadFromDisk(const std::string &key, std::vector<float> *samples) const;
+  void SaveToDisk(const std::string &key,
+                  const std::vector<float> &samples) const;
+
+ private:
+  int32_t max_num_entries_;
+  std::string cache_dir_;
+
+  // Most recently used entries are at the front
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+
+  mutable std::mutex mutex_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_OFFLINE_TTS_CACHE_H_
@@ -0,0 +1,213 @@
+// sherpa-ncnn/csrc/offline-tts-post-processor.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/offline-tts-post-processor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace sherpa_ncnn {
+
+struct SilenceInterval {
+  int32_t start;
+  int32_t end;
+};
+
+// Samples whose absolute value is not larger than this are silent
+static constexpr float kSilenceThreshold = 0.01f;
+
+// Number of samples checked together when looking for pauses
+static constexpr int32_t kBlockSize = 64;
+
+// Return the number of silent samples in p[0..n)
+//
+// The loop has no branches so that it can be vectorized
+static int32_t CountSilentSamples(const float *p, int32_t n) {
+  int32_t count = 0;
+  for (int32_t i = 0; i != n; ++i) {
+    count += std::abs(p[i]) <= kSilenceThreshold;
+  }
+  return count;
+}
+
+// Move [begin, end) to dst. The two ranges may overlap.
+static void Move(const float *begin, const float *end, float *dst) {
+  if (end > begin) {
+    std::memmove(dst, begin, (end - begin) * sizeof(float));
+  }
+}
+
+static std::vector<SilenceInterval> FindPauses(const float *samples,
+                                               int32_t num_samples,
+                                               int32_t threshold) {
+  std::vector<SilenceInterval> intervals;
+
+  int32_t last = -1;
+  for (int32_t b = 0; b < num_samples; b += kBlockSize) {
+    int32_t n = std::min(kBlockSize, num_samples - b);
+    int32_t num_silent = CountSilentSamples(samples + b, n);
+
+    if (num_silent == n) {
+      // the whole block is silent
+      if (last == -1) {
+        last = b;
+      }
+      continue;
+    }
+
+    // Only the first sample of a block without silent samples
+    // can end a silence interval
+    int32_t end = num_silent == 0 ? b + 1 : b + n;
+
+    for (int32_t i = b; i != end; ++i) {
+      if (std::abs(samples[i]) <= kSilenceThreshold) {
+        if (last == -1) {
+          last = i;
+        }
+        continue;
+      }
+
+      if (last != -1 && i - last >= threshold) {
+        intervals.push_back({last, i});
+      }
+
+      last = -1;
+    }
+  }
+
+  if (last != -1 && num_samples - last > threshold) {
+    intervals.push_back({last, num_samples});
+  }
+
+  return intervals;
+}
+
+void ScaleSilence(int32_t sample_rate, float scale,
+                  std::vector<float> *samples) {
+  if (scale == 1 || samples->empty()) {
+    return;
+  }
+
+  // if the interval is larger than 0.2 second, then we assume it is a pause
+  int32_t threshold = static_cast<int32_t>(sample_rate * 0.2);
+
+  int32_t num_samples = static_cast<int32_t>(samples->size());
+
+  std::vector<SilenceInterval> intervals =
+      FindPauses(samples->data(), num_samples, threshold);
+
+  if (intervals.empty()) {
+    return;
+  }
+
+  float *p = samples->data();
+
+  if (scale < 1) {
+    // The output is never longer than the input, so we move samples
+    // towards the beginning
+    int32_t dst = 0;
+    int32_t src = 0;
+    for (const auto &interval : intervals) {
+      int32_t n = static_cast<int32_t>((interval.end - interval.start) * scale);
+
+      Move(p + src, p + interval.start + n, p + dst);
+      dst += interval.start + n - src;
+      src = interval.end;
+    }
+
+    Move(p + src, p + num_samples, p + dst);
+    dst += num_samples - src;
+
+    samples->resize(dst);
+    return;
+  }
+
+  // scale > 1. Compute where each interval starts in the output and
+  // then move samples towards the end, starting from the last interval.
+  std::vector<int32_t> new_start(intervals.size());
+  int32_t offset = 0;
+  for (int32_t i = 0; i != static_cast<int32_t>(intervals.size()); ++i) {
+    const auto &interval = intervals[i];
+    int32_t len = interval.end - interval.start;
+    new_start[i] = interval.start + offset;
+    offset += static_cast<int32_t>(len * scale) - len;
+  }
+
+  samples->resize(num_samples + offset);
+  p = samples->data();
+
+  int32_t src_end = num_samples;
+  int32_t dst_end = num_samples + offset;
+  for (int32_t i = static_cast<int32_t>(intervals.size()) - 1; i >= 0; --i) {
+    const auto &interval = intervals[i];
+    int32_t len = interval.end - interval.start;
+    int32_t n = static_cast<int32_t>(len * scale);
+
+    // samples after this interval
+    int32_t tail = src_end - interval.end;
+    Move(p + interval.end, p + src_end, p + dst_end - tail);
+
+    // the interval itself, followed by repeated silent samples
+    int32_t dst = new_start[i];
+    Move(p + interval.start, p + interval.end, p + dst);
+    for (int32_t k = len; k < n; ++k) {
+      p[dst + k] = p[dst + k % len];
+    }
+
+    src_end = interval.start;
+    dst_end = dst;
+  }
+}
+
+OfflineTtsPostProcessor::OfflineTtsPostProcessor(int32_t sample_rate,
+                                                 int32_t output_sample_rate,
+                                                 float silence_scale,
+                                                 float gain)
+    : sample_rate_(sample_rate),
+      output_sample_rate_(output_sample_rate > 0 ? output_sample_rate
+                                                 : sample_rate),
+      silence_scale_(silence_scale),
+      gain_(gain) {
+  if (output_sample_rate_ != sample_rate_) {
+    float min_freq = std::min<int32_t>(sample_rate_, output_sample_rate_);
+    float lowpass_cutoff = 0.99 * 0.5 * min_freq;
+
+    int32_t lowpass_filter_width = 6;
+    resampler_ = std::make_unique<LinearResample>(
+        sample_rate_, output_sample_rate_, lowpass_cutoff,
+        lowpass_filter_width);
+  }
+}
+
+bool OfflineTtsPostProcessor::IsIdentity() const {
+  return silence_scale_ == 1 && gain_ == 1 && !resampler_;
+}
+
+void OfflineTtsPostProcessor::Process(const float *samples, int32_t n,
+                                      bool flush, std::vector<float> *out) {
+  buffer_.assign(samples, samples + n);
+
+  ScaleSilence(sample_rate_, silence_scale_, &buffer_);
+
+  if (gain_ != 1) {
+    for (auto &f : buffer_) {
+      f = std::min(1.0f, std::max(-1.0f, f * gain_));
+    }
+  }
+
+  if (!resampler_) {
+    *out = std::move(buffer_);
+    buffer_.clear();
+    return;
+  }
+
+  resampler_->Resample(buffer_.data(), static_cast<int32_t>(buffer_.size()),
+                       flush, out);
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,80 @@
+// sherpa-ncnn/csrc/offline-tts-post-processor.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_OFFLINE_TTS_POST_PROCESSOR_H_
+#define SHERPA_NCNN_CSRC_OFFLINE_TTS_POST_PROCESSOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/resample.h"
+
+namespace sherpa_ncnn {
+
+/** Scale the duration of pauses in place.
+ *
+ * A pause is an interval longer than 0.2 seconds whose samples
+ * are all close to 0. The duration of each pause is multiplied by scale.
+ *
+ * @param sample_rate Sample rate of the audio
+ * @param scale If it is larger than 1, pauses are made longer by repeating
+ *              the silent samples. If it is less than 1, pauses are made
+ *              shorter.
+ * @param samples The audio. It is changed in place.
+ */
+void ScaleSilence(int32_t sample_rate, float scale,
+                  std::vector<float> *samples);
+
+/** Post-processing applied to the output of a TTS model.
+ *
+ * It applies the following stages in order:
+ *  - Scale the duration of pauses. See ScaleSilence() above.
+ *  - Multiply by a gain and clip to [-1, 1]
+ *  - Resample to the output sample rate with LinearResample
+ *
+ * Audio can be given a piece at a time, e.g., inside the callback of
+ * OfflineTts::Generate(), so that it can be played back before the whole
+ * text is processed. Pauses are detected inside each piece independently.
+ */
+class OfflineTtsPostProcessor {
+ public:
+  /**
+   * @param sample_rate Sample rate of the input audio
+   * @param output_sample_rate If positive and different from sample_rate,
+   *                           the audio is resampled to it.
+   * @param silence_scale Scale for the duration of pauses.
+   * @param gain The audio is multiplied by it.
+   */
+  OfflineTtsPostProcessor(int32_t sample_rate, int32_t output_sample_rate,
+                          float silence_scale, float gain);
+
+  // Return true if Process() does not change the input
+  bool IsIdentity() const;
+
+  int32_t OutputSampleRate() const { return output_sample_rate_; }
+
+  /**
+   * @param samples Pointer to a piece of audio
+   * @param n Number of samples in this piece
+   * @param flush true if this is the last piece.
+   * @param out On return, it contains the processed audio. Note that
+   *            resampling may delay a few samples to the next call.
+   */
+  void Process(const float *samples, int32_t n, bool flush,
+               std::vector<float> *out);
+
+ private:
+  int32_t sample_rate_;
+  int32_t output_sample_rate_;
+  float silence_scale_;
+  float gain_;
+
+  std::unique_ptr<LinearResample> resampler_;
+  std::vector<float> buffer_;
+};
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_OFFLINE_TTS_POST_PROCESSOR_H_
@@ -17,6 +17,7 @@
 #include "sherpa-ncnn/csrc/lexicon.h"
 #include "sherpa-ncnn/csrc/macros.h"
 #include "sherpa-ncnn/csrc/math.h"
+#include "sherpa-ncnn/csrc/offline-tts-cache.h"
 #include "sherpa-ncnn/csrc/offline-tts-vits-model.h"
 #include "sherpa-ncnn/csrc/text-utils.h"
 
@@ -30,6 +31,11 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
     lexicon_ =
         std::make_unique<Lexicon>(config_.model.vits.model_dir + "/lexicon.txt",
                                   model_->GetMetaData().token2id);
+
+    if (config_.cache_size > 0) {
+      cache_ = std::make_unique<OfflineTtsCache>(config_.cache_size,
+                                                 config_.cache_dir);
+    }
   }
 
   int32_t SampleRate() const override {
@@ -78,18 +84,53 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
     }
 
     std::vector<float> samples;
+    std::vector<int32_t> all_tokens;
+    std::vector<int32_t> all_durations;
+    std::vector<int32_t> durations;
     bool should_continue = true;
     int32_t processed = 0;
     int32_t total = args.tokens.size();
     for (const auto &tokens : args.tokens) {
       ++processed;
 
-      ncnn::Mat o = Process(tokens, args.sid, args.noise_scale_w,
-                            args.noise_scale, args.speed);
+      std::string key;
+      std::vector<float> cached;
+      ncnn::Mat o;
+      bool use_cache = cache_ && !args.return_durations;
+      if (use_cache) {
+        key = OfflineTtsCache::MakeKey(config_.model.vits.model_dir, tokens,
+                                       args.sid, args.speed, args.noise_scale,
+                                       args.noise_scale_w, args.seed);
+      }
+
+      if (use_cache && cache_->Get(key, &cached)) {
+        // Note: o does not own the memory
+        o = ncnn::Mat(static_cast<int32_t>(cached.size()), cached.data());
+      } else {
+        // Each sentence is seeded on its own so that the output of a
+        // sentence does not depend on its position in the text
+        SetRandomSeed(args.seed);
+
+        o = Process(tokens, args.sid, args.noise_scale_w, args.noise_scale,
+                    args.speed, args.return_durations ? &durations : nullptr);
+
+        if (use_cache) {
+          cache_->Put(key, {static_cast<const float *>(o),
+                            static_cast<const float *>(o) + o.w});
+        }
+      }
 
       samples.insert(samples.end(), static_cast<const float *>(o),
                      static_cast<const float *>(o) + o.w);
 
+      if (args.return_durations) {
+        auto padded = AddBlanks(tokens);
+        all_tokens.insert(all_tokens.end(), padded.begin(), padded.end());
+        FramesToSamples(o.w, &durations);
+        all_durations.insert(all_durations.end(), durations.begin(),
+                             durations.end());
+      }
+
       if (callback) {
         should_continue = callback(static_cast<const float *>(o), o.w,
                                    processed, total, callback_arg);
@@ -106,14 +147,15 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
     GeneratedAudio ans;
     ans.sample_rate = meta_data.sample_rate;
     ans.samples = std::move(samples);
+    ans.tokens = std::move(all_tokens);
+    ans.durations = std::move(all_durations);
 
     return ans;
   }
 
  private:
-  ncnn::Mat Process(const std::vector<int32_t> &_tokens, int32_t sid,
-                    float noise_scale_w, float noise_scale, float speed) const {
-    // add bos, eos, and pad
+  // add bos, eos, and pad
+  std::vector<int32_t> AddBlanks(const std::vector<int32_t> &_tokens) const {
     const auto &meta = model_->GetMetaData();
     int32_t bos = meta.bos;
     int32_t eos = meta.eos;
@@ -127,6 +169,42 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
       tokens[2 * i + 2] = _tokens[i];
     }
 
+    return tokens;
+  }
+
+  // Convert durations from frames to samples. Each frame of the decoder
+  // produces the same number of samples. If num_samples is not a multiple
+  // of the number of frames, the remaining samples are assigned to the
+  // last token so that the durations sum to num_samples.
+  static void FramesToSamples(int32_t num_samples,
+                              std::vector<int32_t> *durations) {
+    if (durations->empty()) {
+      return;
+    }
+
+    int32_t num_frames = 0;
+    for (int32_t d : *durations) {
+      num_frames += d;
+    }
+
+    int32_t samples_per_frame = num_frames ? num_samples / num_frames : 0;
+
+    int32_t total = 0;
+    for (auto &d : *durations) {
+      d *= samples_per_frame;
+      total += d;
+    }
+
+    durations->back() += num_samples - total;
+  }
+
+  // @param durations If not NULL, on return it contains the number of frames
+  //                  of each token returned by AddBlanks(_tokens).
+  ncnn::Mat Process(const std::vector<int32_t> &_tokens, int32_t sid,
+                    float noise_scale_w, float noise_scale, float speed,
+                    std::vector<int32_t> *durations = nullptr) const {
+    std::vector<int32_t> tokens = AddBlanks(_tokens);
+
     ncnn::Mat sequence(tokens.size(), 1);
     std::copy(tokens.begin(), tokens.end(), static_cast<int32_t *>(sequence));
 
@@ -144,8 +222,9 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
     noise.release();
     encoder_out[0].release();
 
-    ncnn::Mat z_p = model_->PathAttention(logw, encoder_out[1], encoder_out[2],
-                                          noise_scale, speed);
+    ncnn::Mat z_p =
+        model_->PathAttention(logw, encoder_out[1], encoder_out[2], noise_scale,
+                              speed, config_.model.num_threads, durations);
     encoder_out.clear();
     logw.release();
 
@@ -306,6 +385,9 @@ class OfflineTtsVitsImpl : public OfflineTtsImpl {
   OfflineTtsConfig config_;
   std::unique_ptr<OfflineTtsVitsModel> model_;
   std::unique_ptr<Lexicon> lexicon_;
+
+  // It is not null only if config_.cache_size > 0
+  std::unique_ptr<OfflineTtsCache> cache_;
 };
 
 }  // namespace sherpa_ncnn
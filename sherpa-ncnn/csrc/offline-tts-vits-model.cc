@@ -14,13 +14,16 @@
 
 #include "net.h"  // NOLINT
 #include "sherpa-ncnn/csrc/math.h"
+#include "sherpa-ncnn/csrc/metrics-allocator.h"
+#include "sherpa-ncnn/csrc/piecewise-rational-quadratic.h"
 
 namespace sherpa_ncnn {
 
 // this function is is modified from nihui's implementation
 static ncnn::Mat PathAttentionImpl(const ncnn::Mat &logw, const ncnn::Mat &m_p,
                                    ncnn::Mat &logs_p, float noise_scale,
-                                   float speed) {
+                                   float speed, int32_t num_threads,
+                                   std::vector<int32_t> *durations) {
   float length_scale = 1 / speed;
 
   const int x_lengths = logw.w;
@@ -34,26 +37,50 @@ static ncnn::Mat PathAttentionImpl(const ncnn::Mat &logw, const ncnn::Mat &m_p,
     y_lengths += w_ceil[i];
   }
 
+  // nl[i * x_lengths + j] is the noise scale of the j-th token in the i-th
+  // channel. It is computed once per token instead of once per output
+  // frame. It is depth * x_lengths calls of expf, which is small compared
+  // with the fill below, so it stays scalar.
+  std::vector<float> nl(depth * x_lengths);
+  for (int i = 0; i < depth; i++) {
+    const float *logs_p_ptr = logs_p.row(i);
+    float *p = nl.data() + i * x_lengths;
+    for (int j = 0; j < x_lengths; j++) {
+      p[j] = expf(logs_p_ptr[j]) * noise_scale;
+    }
+  }
+
   ncnn::Mat z_p;
 
   z_p.create(y_lengths, depth);
 
+  // The noise is generated in the calling thread so that the output
+  // depends only on the seed and not on the number of threads.
+  RandomVectorFill(z_p, y_lengths * depth);
+
+#pragma omp parallel for num_threads(num_threads)
   for (int i = 0; i < depth; i++) {
     const float *m_p_ptr = m_p.row(i);
-    const float *logs_p_ptr = logs_p.row(i);
+    const float *nl_ptr = nl.data() + i * x_lengths;
     float *ptr = z_p.row(i);
 
     for (int j = 0; j < x_lengths; j++) {
       const float m = m_p_ptr[j];
-      const float nl = expf(logs_p_ptr[j]) * noise_scale;
+      const float s = nl_ptr[j];
       const int duration = w_ceil[j];
 
-      RandomVectorFill(ptr, duration, m, m + nl);
+      for (int k = 0; k < duration; k++) {
+        ptr[k] = m + ptr[k] * s;
+      }
 
       ptr += duration;
     }
   }
 
+  if (durations) {
+    durations->assign(w_ceil.begin(), w_ceil.end());
+  }
+
   return z_p;
 }
 
@@ -151,154 +178,19 @@ class piecewise_rational_quadratic_transform_module : public ncnn::Layer {
     const int filter_channels = 192;
     const bool reverse = true;
     const float tail_bound = 5.0f;
-    const float DEFAULT_MIN_BIN_WIDTH = 1e-3f;
-    const float DEFAULT_MIN_BIN_HEIGHT = 1e-3f;
-    const float DEFAULT_MIN_DERIVATIVE = 1e-3f;
 
-    // x1 shape: (w=N, h=1, c=1), h shape (w=29*N, h=1, c=1) due to Fortran
-    // layout
+    // x1 shape: (w=N, h=1, c=1), h shape (w=29, h=N, c=1)
     const int batch_size = x1.w;
-    const int h_params_per_item = 2 * num_bins + (num_bins - 1);  // 29
-
-    outputs = x1.clone();
-
-    float *out_ptr = outputs;
-
-    for (int i = 0; i < batch_size; ++i) {
-      const float current_x = ((const float *)x1)[i];
-
-      const float *h_data = h.row(i);
 
-      if (current_x < -tail_bound || current_x > tail_bound) {
-        continue;
-      }
-
-      std::vector<float> unnormalized_widths(num_bins);
-      std::vector<float> unnormalized_heights(num_bins);
-      std::vector<float> unnormalized_derivatives(num_bins + 1);
-
-      const float inv_sqrt_filter_channels = 1.0f / sqrtf(filter_channels);
-      for (int j = 0; j < num_bins; ++j) {
-        unnormalized_widths[j] = h_data[j] * inv_sqrt_filter_channels;
-      }
-      for (int j = 0; j < num_bins; ++j) {
-        unnormalized_heights[j] =
-            h_data[num_bins + j] * inv_sqrt_filter_channels;
-      }
-      for (int j = 0; j < num_bins - 1; ++j) {
-        unnormalized_derivatives[j + 1] = h_data[2 * num_bins + j];
-      }
-
-      const float constant = logf(expf(1.f - DEFAULT_MIN_DERIVATIVE) - 1.f);
-      unnormalized_derivatives[0] = constant;
-      unnormalized_derivatives[num_bins] = constant;
-
-      const float left = -tail_bound, right = tail_bound;
-      const float bottom = -tail_bound, top = tail_bound;
-
-      std::vector<float> widths(num_bins);
-      float w_max = -INFINITY;
-      for (float val : unnormalized_widths) w_max = std::max(w_max, val);
-      float w_sum = 0.f;
-      for (int j = 0; j < num_bins; ++j) {
-        widths[j] = expf(unnormalized_widths[j] - w_max);
-        w_sum += widths[j];
-      }
-      for (int j = 0; j < num_bins; ++j) {
-        widths[j] =
-            DEFAULT_MIN_BIN_WIDTH +
-            (1.f - DEFAULT_MIN_BIN_WIDTH * num_bins) * (widths[j] / w_sum);
-      }
-
-      std::vector<float> cumwidths(num_bins + 1);
-      cumwidths[0] = left;
-      float current_w_sum = 0.f;
-      for (int j = 0; j < num_bins - 1; ++j) {
-        current_w_sum += widths[j];
-        cumwidths[j + 1] = left + (right - left) * current_w_sum;
-      }
-      cumwidths[num_bins] = right;
-
-      std::vector<float> heights(num_bins);
-      float h_max = -INFINITY;
-      for (float val : unnormalized_heights) h_max = std::max(h_max, val);
-      float h_sum = 0.f;
-      for (int j = 0; j < num_bins; ++j) {
-        heights[j] = expf(unnormalized_heights[j] - h_max);
-        h_sum += heights[j];
-      }
-      for (int j = 0; j < num_bins; ++j) {
-        heights[j] =
-            DEFAULT_MIN_BIN_HEIGHT +
-            (1.f - DEFAULT_MIN_BIN_HEIGHT * num_bins) * (heights[j] / h_sum);
-      }
-
-      std::vector<float> cumheights(num_bins + 1);
-      cumheights[0] = bottom;
-      float current_h_sum = 0.f;
-      for (int j = 0; j < num_bins - 1; ++j) {
-        current_h_sum += heights[j];
-        cumheights[j + 1] = bottom + (top - bottom) * current_h_sum;
-      }
-      cumheights[num_bins] = top;
-
-      std::vector<float> derivatives(num_bins + 1);
-      for (int j = 0; j < num_bins + 1; ++j) {
-        float x = unnormalized_derivatives[j];
-        derivatives[j] =
-            DEFAULT_MIN_DERIVATIVE +
-            (x > 0 ? x + logf(1.f + expf(-x)) : logf(1.f + expf(x)));
-      }
-
-      int bin_idx = 0;
-      if (reverse) {
-        auto it =
-            std::upper_bound(cumheights.begin(), cumheights.end(), current_x);
-        bin_idx = std::distance(cumheights.begin(), it) - 1;
-      } else {
-        auto it =
-            std::upper_bound(cumwidths.begin(), cumwidths.end(), current_x);
-        bin_idx = std::distance(cumwidths.begin(), it) - 1;
-      }
-      bin_idx = std::max(0, std::min(bin_idx, num_bins - 1));
-
-      const float input_cumwidths = cumwidths[bin_idx];
-      const float input_bin_widths =
-          cumwidths[bin_idx + 1] - cumwidths[bin_idx];
-      const float input_cumheights = cumheights[bin_idx];
-      const float input_heights = cumheights[bin_idx + 1] - cumheights[bin_idx];
-      const float input_derivatives = derivatives[bin_idx];
-      const float input_derivatives_plus_one = derivatives[bin_idx + 1];
-      const float delta = input_heights / input_bin_widths;
-
-      if (reverse) {
-        float a =
-            (current_x - input_cumheights) *
-                (input_derivatives + input_derivatives_plus_one - 2 * delta) +
-            input_heights * (delta - input_derivatives);
-        float b =
-            input_heights * input_derivatives -
-            (current_x - input_cumheights) *
-                (input_derivatives + input_derivatives_plus_one - 2 * delta);
-        float c = -delta * (current_x - input_cumheights);
-        float discriminant = b * b - 4 * a * c;
-        discriminant = std::max(0.f, discriminant);
-        float root = (2 * c) / (-b - sqrtf(discriminant));
-        out_ptr[i] = root * input_bin_widths + input_cumwidths;
-      } else {
-        float theta = (current_x - input_cumwidths) / input_bin_widths;
-        float theta_one_minus_theta = theta * (1 - theta);
-        float numerator =
-            input_heights *
-            (delta * theta * theta + input_derivatives * theta_one_minus_theta);
-        float denominator =
-            delta +
-            ((input_derivatives + input_derivatives_plus_one - 2 * delta) *
-             theta_one_minus_theta);
-        out_ptr[i] = input_cumheights + numerator / denominator;
-      }
+    outputs.create_like(x1, opt.blob_allocator);
+    if (outputs.empty()) {
+      return -100;
     }
 
+    PiecewiseRationalQuadraticTransform(
+        h, h.w, x1, batch_size, num_bins, filter_channels, tail_bound, reverse,
+        outputs);
+
     return 0;
   }
 };
@@ -416,6 +308,7 @@ class OfflineTtsVitsModel::Impl {
 
   void InitEncoderNet() {
     enc_p_.opt.num_threads = config_.num_threads;
+    UseMetricsAllocator(&enc_p_);
 
     // en_enc_p_pnnx is for our first version.
     enc_p_.register_custom_layer("en_enc_p_pnnx.relative_embeddings_k_module",
@@ -438,6 +331,7 @@ class OfflineTtsVitsModel::Impl {
 
   void InitDurationPredictorNet() {
     dp_.opt.num_threads = config_.num_threads;
+    UseMetricsAllocator(&dp_);
 
     dp_.register_custom_layer(
         "piper.train.vits.modules.piecewise_rational_quadratic_transform_"
@@ -453,6 +347,7 @@ class OfflineTtsVitsModel::Impl {
 
   void InitFlowNet() {
     flow_.opt.num_threads = config_.num_threads;
+    UseMetricsAllocator(&flow_);
 
     std::string param = config_.vits.model_dir + "/flow.ncnn.param";
     std::string bin = config_.vits.model_dir + "/flow.ncnn.bin";
@@ -463,6 +358,7 @@ class OfflineTtsVitsModel::Impl {
 
   void InitDecoderNet() {
     decoder_.opt.num_threads = config_.num_threads;
+    UseMetricsAllocator(&decoder_);
 
     std::string param = config_.vits.model_dir + "/decoder.ncnn.param";
     std::string bin = config_.vits.model_dir + "/decoder.ncnn.bin";
@@ -473,6 +369,7 @@ class OfflineTtsVitsModel::Impl {
 
   void InitEmbeddingNet() {
     embedding_.opt.num_threads = config_.num_threads;
+    UseMetricsAllocator(&embedding_);
 
     std::string param = config_.vits.model_dir + "/embedding.ncnn.param";
     std::string bin = config_.vits.model_dir + "/embedding.ncnn.bin";
@@ -515,8 +412,12 @@ ncnn::Mat OfflineTtsVitsModel::RunDurationPredictor(const ncnn::Mat &x,
 ncnn::Mat OfflineTtsVitsModel::PathAttention(const ncnn::Mat &logw,
                                              const ncnn::Mat &m_p,
                                              ncnn::Mat &logs_p,
-                                             float noise_scale, float speed) {
-  return PathAttentionImpl(logw, m_p, logs_p, noise_scale, speed);
+                                             float noise_scale, float speed,
+                                             int32_t num_threads /*= 1*/,
+                                             std::vector<int32_t> *durations
+                                             /*= nullptr*/) {
+  return PathAttentionImpl(logw, m_p, logs_p, noise_scale, speed, num_threads,
+                           durations);
 }
 
 ncnn::Mat OfflineTtsVitsModel::RunFlow(const ncnn::Mat &z_p,
@@ -5,6 +5,7 @@
 #ifndef SHERPA_NCNN_CSRC_OFFLINE_TTS_VITS_MODEL_H_
 #define SHERPA_NCNN_CSRC_OFFLINE_TTS_VITS_MODEL_H_
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -52,12 +53,16 @@ class OfflineTtsVitsModel {
    * @param logs_p It is returned by RunEncoder()
    * @param noise_scale
    * @param speed Note speed = 1 / length_scale, so speed should > 0
+   * @param num_threads Number of threads for expanding m_p and logs_p.
+   * @param durations If not NULL, on return it contains the number of
+   *                  frames of each token. Its size equals to logw.w.
    *
    * @returns Return z_p
    */
   static ncnn::Mat PathAttention(const ncnn::Mat &logw, const ncnn::Mat &m_p,
                                  ncnn::Mat &logs_p, float noise_scale,
-                                 float speed);
+                                 float speed, int32_t num_threads = 1,
+                                 std::vector<int32_t> *durations = nullptr);
 
   /**
    * @param z_p It is returned by PathAttention()
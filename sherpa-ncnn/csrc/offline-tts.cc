@@ -4,83 +4,31 @@
 
 #include "sherpa-ncnn/csrc/offline-tts.h"
 
-#include <cmath>
+#include <chrono>  // NOLINT
+#include <cstdint>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "sherpa-ncnn/csrc/file-utils.h"
 #include "sherpa-ncnn/csrc/macros.h"
+#include "sherpa-ncnn/csrc/metrics.h"
 #include "sherpa-ncnn/csrc/offline-tts-impl.h"
+#include "sherpa-ncnn/csrc/offline-tts-post-processor.h"
 #include "sherpa-ncnn/csrc/text-utils.h"
 
 namespace sherpa_ncnn {
 
-struct SilenceInterval {
-  int32_t start;
-  int32_t end;
-};
-
 GeneratedAudio GeneratedAudio::ScaleSilence(float scale) const {
-  if (scale == 1) {
-    return *this;
-  }
-  // if the interval is larger than 0.2 second, then we assume it is a pause
-  int32_t threshold = static_cast<int32_t>(sample_rate * 0.2);
-
-  std::vector<SilenceInterval> intervals;
-  int32_t num_samples = static_cast<int32_t>(samples.size());
-
-  int32_t last = -1;
-  int32_t i;
-  for (i = 0; i != num_samples; ++i) {
-    if (fabs(samples[i]) <= 0.01) {
-      if (last == -1) {
-        last = i;
-      }
-      continue;
-    }
-
-    if (last != -1 && i - last < threshold) {
-      last = -1;
-      continue;
-    }
-
-    if (last != -1) {
-      intervals.push_back({last, i});
-      last = -1;
-    }
-  }
-
-  if (last != -1 && num_samples - last > threshold) {
-    intervals.push_back({last, num_samples});
-  }
-
-  if (intervals.empty()) {
-    return *this;
-  }
-
-  GeneratedAudio ans;
-  ans.sample_rate = sample_rate;
-  ans.samples.reserve(samples.size());
-
-  i = 0;
-  for (const auto &interval : intervals) {
-    ans.samples.insert(ans.samples.end(), samples.begin() + i,
-                       samples.begin() + interval.start);
-    i = interval.end;
-    int32_t n = static_cast<int32_t>((interval.end - interval.start) * scale);
-
-    ans.samples.insert(ans.samples.end(), samples.begin() + interval.start,
-                       samples.begin() + interval.start + n);
-  }
-
-  if (i < num_samples) {
-    ans.samples.insert(ans.samples.end(), samples.begin() + i, samples.end());
-  }
-
+  GeneratedAudio ans = *this;
+  ans.ScaleSilenceInPlace(scale);
   return ans;
 }
 
+void GeneratedAudio::ScaleSilenceInPlace(float scale) {
+  sherpa_ncnn::ScaleSilence(sample_rate, scale, &samples);
+}
+
 void OfflineTtsConfig::Register(ParseOptions *po) {
   model.Register(po);
 
@@ -110,6 +58,24 @@ void OfflineTtsConfig::Register(ParseOptions *po) {
   po->Register("tts-silence-scale", &silence_scale,
                "Duration of the pause is scaled by this number. So a smaller "
                "value leads to a shorter pause.");
+
+  po->Register("tts-gain", &gain,
+               "The generated audio is multiplied by this number and clipped "
+               "to [-1, 1].");
+
+  po->Register("tts-output-sample-rate", &output_sample_rate,
+               "If positive, resample the generated audio to this sample "
+               "rate. If 0, use the sample rate of the model.");
+
+  po->Register("tts-cache-size", &cache_size,
+               "If positive, cache the generated audio of at most this many "
+               "sentences in memory so that repeated sentences are returned "
+               "without running the model.");
+
+  po->Register("tts-cache-dir", &cache_dir,
+               "If not empty and --tts-cache-size is positive, the cached "
+               "audio is also saved to this directory so that it can be "
+               "reused across runs. The directory must exist.");
 }
 
 bool OfflineTtsConfig::Validate() const {
@@ -140,6 +106,22 @@ bool OfflineTtsConfig::Validate() const {
     return false;
   }
 
+  if (gain <= 0) {
+    SHERPA_NCNN_LOGE("--tts-gain should be positive. Given: %.3f", gain);
+    return false;
+  }
+
+  if (output_sample_rate < 0) {
+    SHERPA_NCNN_LOGE("--tts-output-sample-rate should be >= 0. Given: %d",
+                     output_sample_rate);
+    return false;
+  }
+
+  if (cache_size < 0) {
+    SHERPA_NCNN_LOGE("--tts-cache-size should be >= 0. Given: %d", cache_size);
+    return false;
+  }
+
   return model.Validate();
 }
 
@@ -151,13 +133,57 @@ std::string OfflineTtsConfig::ToString() const {
   os << "rule_fsts=\"" << rule_fsts << "\", ";
   os << "rule_fars=\"" << rule_fars << "\", ";
   os << "max_num_sentences=" << max_num_sentences << ", ";
-  os << "silence_scale=" << silence_scale << ")";
+  os << "silence_scale=" << silence_scale << ", ";
+  os << "gain=" << gain << ", ";
+  os << "output_sample_rate=" << output_sample_rate << ", ";
+  os << "cache_size=" << cache_size << ", ";
+  os << "cache_dir=\"" << cache_dir << "\")";
 
   return os.str();
 }
 
+// Scale durations so that they sum to num_samples
+static void RescaleDurations(int32_t num_samples,
+                             std::vector<int32_t> *durations) {
+  int64_t total = 0;
+  for (int32_t d : *durations) {
+    total += d;
+  }
+
+  if (total == 0 || total == num_samples) {
+    return;
+  }
+
+  // Round the cumulative sums so that no samples are lost
+  int64_t acc = 0;
+  int64_t prev = 0;
+  for (auto &d : *durations) {
+    acc += d;
+    int64_t end = acc * num_samples / total;
+    d = static_cast<int32_t>(end - prev);
+    prev = end;
+  }
+}
+
+static void UpdateTtsMetrics(const GeneratedAudio &audio,
+                             std::chrono::steady_clock::time_point start) {
+  double elapsed_seconds =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count() /
+      1e6;
+
+  const auto &metrics = GetTtsMetrics();
+  metrics.samples->Inc(static_cast<double>(audio.samples.size()));
+  if (audio.sample_rate > 0) {
+    metrics.audio_seconds->Inc(static_cast<double>(audio.samples.size()) /
+                               audio.sample_rate);
+  }
+  metrics.generate_latency->Observe(elapsed_seconds);
+}
+
 OfflineTts::OfflineTts(const OfflineTtsConfig &config)
-    : impl_(OfflineTtsImpl::Create(config)) {}
+    : config_(config), impl_(OfflineTtsImpl::Create(config)) {}
 
 OfflineTts::~OfflineTts() = default;
 
@@ -165,10 +191,10 @@ GeneratedAudio OfflineTts::Generate(
     const TtsArgs &args, GeneratedAudioCallback callback /*= nullptr*/,
     void *callback_arg /*= nullptr*/) const {
 #if !defined(_WIN32)
-  return impl_->Generate(args, std::move(callback), callback_arg);
+  return GenerateAndPostProcess(args, std::move(callback), callback_arg);
 #else
   if (IsUtf8(args.text)) {
-    return impl_->Generate(args, std::move(callback), callback_arg);
+    return GenerateAndPostProcess(args, std::move(callback), callback_arg);
   } else if (IsGB2312(args.text)) {
     auto utf8_text = Gb2312ToUtf8(args.text);
     static bool printed = false;
@@ -179,17 +205,83 @@ GeneratedAudio OfflineTts::Generate(
     }
     TtsArgs utf8_args = args;
     utf8_args.text = utf8_text;
-    return impl_->Generate(utf8_args, std::move(callback), callback_arg);
+    return GenerateAndPostProcess(utf8_args, std::move(callback),
+                                  callback_arg);
   } else {
     SHERPA_NCNN_LOGE(
         "Non UTF8 encoded string is received. You would not get expected "
         "results!");
-    return impl_->Generate(args, std::move(callback), callback_arg);
+    return GenerateAndPostProcess(args, std::move(callback), callback_arg);
   }
 #endif
 }
 
-int32_t OfflineTts::SampleRate() const { return impl_->SampleRate(); }
+GeneratedAudio OfflineTts::GenerateAndPostProcess(
+    const TtsArgs &args, GeneratedAudioCallback callback,
+    void *callback_arg) const {
+  // Durations would be wrong if pauses are scaled
+  float silence_scale = args.return_durations ? 1 : config_.silence_scale;
+
+  auto start = std::chrono::steady_clock::now();
+
+  OfflineTtsPostProcessor processor(impl_->SampleRate(),
+                                    config_.output_sample_rate, silence_scale,
+                                    config_.gain);
+
+  if (processor.IsIdentity()) {
+    GeneratedAudio ans =
+        impl_->Generate(args, std::move(callback), callback_arg);
+    UpdateTtsMetrics(ans, start);
+    return ans;
+  }
+
+  // Audio is always processed piece by piece, so that the output does not
+  // depend on whether a callback is given
+  std::vector<float> samples;
+  std::vector<float> piece;
+  bool flushed = false;
+
+  GeneratedAudioCallback wrapper =
+      [&processor, &samples, &piece, &flushed, &callback](
+          const float *p, int32_t n, int32_t processed, int32_t total,
+          void *arg) -> int32_t {
+    flushed = processed == total;
+    processor.Process(p, n, flushed, &piece);
+    samples.insert(samples.end(), piece.begin(), piece.end());
+
+    if (!callback) {
+      return 1;
+    }
+
+    return callback(piece.data(), static_cast<int32_t>(piece.size()),
+                    processed, total, arg);
+  };
+
+  GeneratedAudio ans = impl_->Generate(args, wrapper, callback_arg);
+
+  if (!flushed) {
+    // The callback stopped the generation. Keep the samples that are
+    // still buffered in the resampler.
+    processor.Process(nullptr, 0, true, &piece);
+    samples.insert(samples.end(), piece.begin(), piece.end());
+  }
+
+  ans.samples = std::move(samples);
+
+  ans.sample_rate = processor.OutputSampleRate();
+  RescaleDurations(static_cast<int32_t>(ans.samples.size()), &ans.durations);
+  UpdateTtsMetrics(ans, start);
+
+  return ans;
+}
+
+int32_t OfflineTts::SampleRate() const {
+  if (config_.output_sample_rate > 0) {
+    return config_.output_sample_rate;
+  }
+
+  return impl_->SampleRate();
+}
 
 int32_t OfflineTts::NumSpeakers() const { return impl_->NumSpeakers(); }
 
@@ -40,6 +40,24 @@ struct OfflineTtsConfig {
   // the duration of the new interval is old_duration * silence_scale.
   float silence_scale = 1.0;
 
+  // The generated audio is multiplied by this number and clipped
+  // to [-1, 1]
+  float gain = 1.0;
+
+  // If positive, the generated audio is resampled to this sample rate.
+  // If 0, the sample rate of the model is used.
+  int32_t output_sample_rate = 0;
+
+  // If positive, synthesized audio of each sentence is cached in memory
+  // and repeated sentences are returned without running the model.
+  // It specifies the maximum number of cached sentences.
+  int32_t cache_size = 0;
+
+  // If not empty, cached audio is also saved to this directory
+  // so that it can be reused across runs. It must already exist.
+  // It is used only when cache_size is positive.
+  std::string cache_dir;
+
   OfflineTtsConfig() = default;
   OfflineTtsConfig(const OfflineTtsModelConfig &model,
                    const std::string &rule_fsts, const std::string &rule_fars,
@@ -60,10 +78,25 @@ struct GeneratedAudio {
   std::vector<float> samples;
   int32_t sample_rate;
 
+  // They are filled only if TtsArgs::return_durations is true.
+  //
+  // tokens[i] is the i-th token ID fed to the model. It includes the
+  // blanks and the begin/end of sentence tokens that are inserted between
+  // and around the input tokens of each sentence.
+  //
+  // durations[i] is the number of samples generated for tokens[i].
+  // The durations sum to samples.size(). Note that pauses are not scaled
+  // by OfflineTtsConfig::silence_scale if durations are requested.
+  std::vector<int32_t> tokens;
+  std::vector<int32_t> durations;
+
   // Silence means pause here.
   // If scale > 1, then it increases the duration of a pause
   // If scale < 1, then it reduces the duration of a pause
   GeneratedAudio ScaleSilence(float scale) const;
+
+  // Same as ScaleSilence() but changes samples in place
+  void ScaleSilenceInPlace(float scale);
 };
 
 struct TtsArgs {
@@ -71,13 +104,14 @@ struct TtsArgs {
   TtsArgs(const std::string &text,
           const std::vector<std::vector<int32_t>> &tokens, int32_t sid = 0,
           float speed = 1.0, float noise_scale = 0.667f,
-          float noise_scale_w = 0.8f)
+          float noise_scale_w = 0.8f, int64_t seed = -1)
       : text(text),
         tokens(tokens),
         sid(sid),
         speed(speed),
         noise_scale(noise_scale),
-        noise_scale_w(noise_scale_w) {}
+        noise_scale_w(noise_scale_w),
+        seed(seed) {}
   // A string containing words separated by spaces
   std::string text;
 
@@ -97,6 +131,16 @@ struct TtsArgs {
 
   float noise_scale = 0.667f;
   float noise_scale_w = 0.8f;
+
+  // If non-negative, the noise of each sentence is generated from this seed
+  // so that the same input always produces the same audio.
+  // If negative, a random seed is used.
+  int64_t seed = -1;
+
+  // If true, return the duration of each token in GeneratedAudio,
+  // e.g., for lip-sync or subtitles. Note that the cache is not used
+  // in this case.
+  bool return_durations = false;
 };
 
 class OfflineTtsImpl;
@@ -132,6 +176,15 @@ class OfflineTts {
   int32_t NumSpeakers() const;
 
  private:
+  // Apply silence scaling, gain, and resampling to the output of impl_.
+  // When a callback is given, each piece is processed before it is
+  // passed to the callback.
+  GeneratedAudio GenerateAndPostProcess(const TtsArgs &args,
+                                        GeneratedAudioCallback callback,
+                                        void *callback_arg) const;
+
+ private:
+  OfflineTtsConfig config_;
   std::unique_ptr<OfflineTtsImpl> impl_;
 };
 
@@ -0,0 +1,325 @@
+// sherpa-ncnn/csrc/piecewise-rational-quadratic.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/piecewise-rational-quadratic.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/macros.h"
+
+namespace sherpa_ncnn {
+
+static constexpr float kMinBinWidth = 1e-3f;
+static constexpr float kMinBinHeight = 1e-3f;
+static constexpr float kMinDerivative = 1e-3f;
+
+// Number of positions processed together
+static constexpr int32_t kBlockSize = 16;
+static constexpr int32_t kMaxNumBins = 16;
+
+static inline float Softplus(float x) {
+  return x > 0 ? x + logf(1.f + expf(-x)) : logf(1.f + expf(x));
+}
+
+// Convert unnormalized widths (or heights) to knots, i.e., cumulative
+// widths (or heights), for a block of positions.
+//
+// u[j][k] is the unnormalized width of the j-th bin of the k-th position.
+// On return, knots[j][k], 0 <= j <= num_bins, contains the knots.
+static void ComputeKnots(float (*u)[kBlockSize], int32_t num_bins,
+                         float min_bin_size, float left, float right,
+                         float (*knots)[kBlockSize]) {
+  float max_value[kBlockSize];
+  float sum[kBlockSize];
+  float acc[kBlockSize];
+
+  for (int32_t k = 0; k != kBlockSize; ++k) {
+    max_value[k] = u[0][k];
+  }
+
+  for (int32_t j = 1; j < num_bins; ++j) {
+    for (int32_t k = 0; k != kBlockSize; ++k) {
+      max_value[k] = std::max(max_value[k], u[j][k]);
+    }
+  }
+
+  for (int32_t k = 0; k != kBlockSize; ++k) {
+    sum[k] = 0;
+  }
+
+  for (int32_t j = 0; j < num_bins; ++j) {
+    for (int32_t k = 0; k != kBlockSize; ++k) {
+      u[j][k] = expf(u[j][k] - max_value[k]);
+      sum[k] += u[j][k];
+    }
+  }
+
+  const float scale = 1.f - min_bin_size * num_bins;
+  for (int32_t k = 0; k != kBlockSize; ++k) {
+    knots[0][k] = left;
+    acc[k] = 0;
+  }
+
+  for (int32_t j = 0; j < num_bins - 1; ++j) {
+    for (int32_t k = 0; k != kBlockSize; ++k) {
+      acc[k] += min_bin_size + scale * (u[j][k] / sum[k]);
+      knots[j + 1][k] = left + (right - left) * acc[k];
+    }
+  }
+
+  for (int32_t k = 0; k != kBlockSize; ++k) {
+    knots[num_bins][k] = right;
+  }
+}
+
+static void TransformBlock(const float *h, int32_t h_stride, const float *x,
+                           int32_t n, int32_t num_bins, float inv_sqrt_channels,
+                           float tail_bound, bool reverse, float *y) {
+  // Layout is [bin][position], so the inner loops run over positions
+  float u[kMaxNumBins + 1][kBlockSize];
+  float cumwidths[kMaxNumBins + 1][kBlockSize];
+  float cumheights[kMaxNumBins + 1][kBlockSize];
+  float derivatives[kMaxNumBins + 1][kBlockSize];
+  float in[kBlockSize];
+
+  // Unused positions of a partial block are filled with 0 so that the
+  // computation below is well-defined. Their results are discarded.
+  for (int32_t k = 0; k != kBlockSize; ++k) {
+    in[k] = k < n ? x[k] : 0;
+  }
+
+  const float left = -tail_bound;
+  const float right = tail_bound;
+
+  for (int32_t k = 0; k != kBlockSize; ++k) {
+    const float *p = h + k * h_stride;
+    for (int32_t j = 0; j < num_bins; ++j) {
+      u[j][k] = k < n ? p[j] * inv_sqrt_channels : 0;
+    }
+  }
+  ComputeKnots(u, num_bins, kMinBinWidth, left, right, cumwidths);
+
+  for (int32_t k = 0; k != kBlockSize; ++k) {
+    const float *p = h + k * h_stride + num_bins;
+    for (int32_t j = 0; j < num_bins; ++j) {
+      u[j][k] = k < n ? p[j] * inv_sqrt_channels : 0;
+    }
+  }
+  ComputeKnots(u, num_bins, kMinBinHeight, left, right, cumheights);
+
+  const float constant = logf(expf(1.f - kMinDerivative) - 1.f);
+  for (int32_t k = 0; k != kBlockSize; ++k) {
+    const float *p = h + k * h_stride + 2 * num_bins;
+    derivatives[0][k] = constant;
+    for (int32_t j = 0; j < num_bins - 1; ++j) {
+      derivatives[j + 1][k] = k < n ? p[j] : 0;
+    }
+    derivatives[num_bins][k] = constant;
+  }
+
+  // Locate the bin of each position. Since knots are sorted, it equals
+  // the number of inner knots that are <= the input.
+  int32_t bin[kBlockSize] = {0};
+  float(*knots)[kBlockSize] = reverse ? cumheights : cumwidths;
+  for (int32_t j = 1; j < num_bins; ++j) {
+    for (int32_t k = 0; k != kBlockSize; ++k) {
+      bin[k] += knots[j][k] <= in[k];
+    }
+  }
+
+  for (int32_t k = 0; k < n; ++k) {
+    const int32_t b = bin[k];
+    const float cw = cumwidths[b][k];
+    const float bin_width = cumwidths[b + 1][k] - cw;
+    const float ch = cumheights[b][k];
+    const float bin_height = cumheights[b + 1][k] - ch;
+    // Only the two derivatives at the ends of the bin are used
+    const float d0 = Softplus(derivatives[b][k]) + kMinDerivative;
+    const float d1 = Softplus(derivatives[b + 1][k]) + kMinDerivative;
+    const float delta = bin_height / bin_width;
+
+    float out;
+    if (reverse) {
+      float t = (in[k] - ch) * (d0 + d1 - 2 * delta);
+      float qa = t + bin_height * (delta - d0);
+      float qb = bin_height * d0 - t;
+      float qc = -delta * (in[k] - ch);
+      float discriminant = std::max(0.f, qb * qb - 4 * qa * qc);
+      float root = (2 * qc) / (-qb - sqrtf(discriminant));
+      out = root * bin_width + cw;
+    } else {
+      float theta = (in[k] - cw) / bin_width;
+      float theta_one_minus_theta = theta * (1 - theta);
+      float numerator =
+          bin_height * (delta * theta * theta + d0 * theta_one_minus_theta);
+      float denominator = delta + (d0 + d1 - 2 * delta) * theta_one_minus_theta;
+      out = ch + numerator / denominator;
+    }
+
+    bool inside = in[k] >= -tail_bound && in[k] <= tail_bound;
+    y[k] = inside ? out : in[k];
+  }
+}
+
+void PiecewiseRationalQuadraticTransform(const float *h, int32_t h_stride,
+                                         const float *x, int32_t n,
+                                         int32_t num_bins,
+                                         int32_t filter_channels,
+                                         float tail_bound, bool reverse,
+                                         float *y) {
+  if (num_bins < 1 || num_bins > kMaxNumBins) {
+    SHERPA_NCNN_LOGE("num_bins should be in the range [1, %d]. Given: %d",
+                     kMaxNumBins, num_bins);
+    SHERPA_NCNN_EXIT(-1);
+  }
+
+  const float inv_sqrt_channels = 1.0f / sqrtf(filter_channels);
+
+  for (int32_t i = 0; i < n; i += kBlockSize) {
+    TransformBlock(h + i * h_stride, h_stride, x + i,
+                   std::min(kBlockSize, n - i), num_bins, inv_sqrt_channels,
+                   tail_bound, reverse, y + i);
+  }
+}
+
+// this function is from by nihui
+void PiecewiseRationalQuadraticTransformReference(
+    const float *h, int32_t h_stride, const float *x, int32_t n,
+    int32_t num_bins, int32_t filter_channels, float tail_bound, bool reverse,
+    float *y) {
+  for (int i = 0; i < n; ++i) {
+    const float current_x = x[i];
+
+    const float *h_data = h + i * h_stride;
+
+    if (current_x < -tail_bound || current_x > tail_bound) {
+      y[i] = current_x;
+      continue;
+    }
+
+    std::vector<float> unnormalized_widths(num_bins);
+    std::vector<float> unnormalized_heights(num_bins);
+    std::vector<float> unnormalized_derivatives(num_bins + 1);
+
+    const float inv_sqrt_filter_channels = 1.0f / sqrtf(filter_channels);
+    for (int j = 0; j < num_bins; ++j) {
+      unnormalized_widths[j] = h_data[j] * inv_sqrt_filter_channels;
+    }
+    for (int j = 0; j < num_bins; ++j) {
+      unnormalized_heights[j] = h_data[num_bins + j] * inv_sqrt_filter_channels;
+    }
+    for (int j = 0; j < num_bins - 1; ++j) {
+      unnormalized_derivatives[j + 1] = h_data[2 * num_bins + j];
+    }
+
+    const float constant = logf(expf(1.f - kMinDerivative) - 1.f);
+    unnormalized_derivatives[0] = constant;
+    unnormalized_derivatives[num_bins] = constant;
+
+    const float left = -tail_bound, right = tail_bound;
+    const float bottom = -tail_bound, top = tail_bound;
+
+    std::vector<float> widths(num_bins);
+    float w_max = -INFINITY;
+    for (float val : unnormalized_widths) w_max = std::max(w_max, val);
+    float w_sum = 0.f;
+    for (int j = 0; j < num_bins; ++j) {
+      widths[j] = expf(unnormalized_widths[j] - w_max);
+      w_sum += widths[j];
+    }
+    for (int j = 0; j < num_bins; ++j) {
+      widths[j] = kMinBinWidth +
+                  (1.f - kMinBinWidth * num_bins) * (widths[j] / w_sum);
+    }
+
+    std::vector<float> cumwidths(num_bins + 1);
+    cumwidths[0] = left;
+    float current_w_sum = 0.f;
+    for (int j = 0; j < num_bins - 1; ++j) {
+      current_w_sum += widths[j];
+      cumwidths[j + 1] = left + (right - left) * current_w_sum;
+    }
+    cumwidths[num_bins] = right;
+
+    std::vector<float> heights(num_bins);
+    float h_max = -INFINITY;
+    for (float val : unnormalized_heights) h_max = std::max(h_max, val);
+    float h_sum = 0.f;
+    for (int j = 0; j < num_bins; ++j) {
+      heights[j] = expf(unnormalized_heights[j] - h_max);
+      h_sum += heights[j];
+    }
+    for (int j = 0; j < num_bins; ++j) {
+      heights[j] = kMinBinHeight +
+                   (1.f - kMinBinHeight * num_bins) * (heights[j] / h_sum);
+    }
+
+    std::vector<float> cumheights(num_bins + 1);
+    cumheights[0] = bottom;
+    float current_h_sum = 0.f;
+    for (int j = 0; j < num_bins - 1; ++j) {
+      current_h_sum += heights[j];
+      cumheights[j + 1] = bottom + (top - bottom) * current_h_sum;
+    }
+    cumheights[num_bins] = top;
+
+    std::vector<float> derivatives(num_bins + 1);
+    for (int j = 0; j < num_bins + 1; ++j) {
+      float x = unnormalized_derivatives[j];
+      derivatives[j] = kMinDerivative + (x > 0 ? x + logf(1.f + expf(-x))
+                                               : logf(1.f + expf(x)));
+    }
+
+    int bin_idx = 0;
+    if (reverse) {
+      auto it =
+          std::upper_bound(cumheights.begin(), cumheights.end(), current_x);
+      bin_idx = std::distance(cumheights.begin(), it) - 1;
+    } else {
+      auto it = std::upper_bound(cumwidths.begin(), cumwidths.end(), current_x);
+      bin_idx = std::distance(cumwidths.begin(), it) - 1;
+    }
+    bin_idx = std::max(0, std::min(bin_idx, num_bins - 1));
+
+    const float input_cumwidths = cumwidths[bin_idx];
+    const float input_bin_widths = cumwidths[bin_idx + 1] - cumwidths[bin_idx];
+    const float input_cumheights = cumheights[bin_idx];
+    const float input_heights = cumheights[bin_idx + 1] - cumheights[bin_idx];
+    const float input_derivatives = derivatives[bin_idx];
+    const float input_derivatives_plus_one = derivatives[bin_idx + 1];
+    const float delta = input_heights / input_bin_widths;
+
+    if (reverse) {
+      float a = (current_x - input_cumheights) *
+                    (input_derivatives + input_derivatives_plus_one -
+                     2 * delta) +
+                input_heights * (delta - input_derivatives);
+      float b = input_heights * input_derivatives -
+                (current_x - input_cumheights) *
+                    (input_derivatives + input_derivatives_plus_one -
+                     2 * delta);
+      float c = -delta * (current_x - input_cumheights);
+      float discriminant = b * b - 4 * a * c;
+      discriminant = std::max(0.f, discriminant);
+      float root = (2 * c) / (-b - sqrtf(discriminant));
+      y[i] = root * input_bin_widths + input_cumwidths;
+    } else {
+      float theta = (current_x - input_cumwidths) / input_bin_widths;
+      float theta_one_minus_theta = theta * (1 - theta);
+      float numerator =
+          input_heights *
+          (delta * theta * theta + input_derivatives * theta_one_minus_theta);
+      float denominator =
+          delta +
+          ((input_derivatives + input_derivatives_plus_one - 2 * delta) *
+           theta_one_minus_theta);
+      y[i] = input_cumheights + numerator / denominator;
+    }
+  }
+}
+
+}  // namespace sherpa_ncnn
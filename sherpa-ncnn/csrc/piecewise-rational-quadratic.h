@@ -0,0 +1,51 @@
+// sherpa-ncnn/csrc/piecewise-rational-quadratic.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_PIECEWISE_RATIONAL_QUADRATIC_H_
+#define SHERPA_NCNN_CSRC_PIECEWISE_RATIONAL_QUADRATIC_H_
+
+#include <cstdint>
+
+namespace sherpa_ncnn {
+
+/** Apply the piecewise rational quadratic spline transform used in
+ * the stochastic duration predictor of VITS.
+ *
+ * @param h Spline parameters. The parameters for x[i] start at
+ *          h + i * h_stride and contain num_bins unnormalized widths,
+ *          num_bins unnormalized heights, and (num_bins - 1)
+ *          unnormalized derivatives.
+ * @param h_stride Distance between the parameters of two positions.
+ * @param x Pointer to the input, of n elements.
+ * @param n Number of positions.
+ * @param num_bins Number of bins. Must not be larger than 16.
+ * @param filter_channels Widths and heights are scaled by
+ *                        1/sqrt(filter_channels).
+ * @param tail_bound Inputs outside [-tail_bound, tail_bound] are copied
+ *                   to the output as-is.
+ * @param reverse true to compute the inverse transform.
+ * @param y Pointer to the output, of n elements. It must not overlap
+ *          with h.
+ *
+ * The positions are processed in small blocks laid out so that the inner
+ * loops run across positions and can be vectorized by the compiler.
+ * No memory is allocated.
+ */
+void PiecewiseRationalQuadraticTransform(const float *h, int32_t h_stride,
+                                         const float *x, int32_t n,
+                                         int32_t num_bins,
+                                         int32_t filter_channels,
+                                         float tail_bound, bool reverse,
+                                         float *y);
+
+// Same as PiecewiseRationalQuadraticTransform() but processes one position
+// at a time. It is slow and is kept only as a reference for testing.
+void PiecewiseRationalQuadraticTransformReference(
+    const float *h, int32_t h_stride, const float *x, int32_t n,
+    int32_t num_bins, int32_t filter_channels, float tail_bound, bool reverse,
+    float *y);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_PIECEWISE_RATIONAL_QUADRATIC_H_
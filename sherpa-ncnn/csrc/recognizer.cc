@@ -19,15 +19,23 @@
 
 #include "sherpa-ncnn/csrc/recognizer.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <fstream>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "sherpa-ncnn/csrc/context-graph.h"
 #include "sherpa-ncnn/csrc/decoder.h"
+#include "sherpa-ncnn/csrc/feature-pipeline.h"
 #include "sherpa-ncnn/csrc/greedy-search-decoder.h"
+#include "sherpa-ncnn/csrc/hotwords.h"
+#include "sherpa-ncnn/csrc/metrics.h"
 #include "sherpa-ncnn/csrc/modified-beam-search-decoder.h"
 
 #if __ANDROID_API__ >= 9
@@ -40,6 +48,10 @@
 
 namespace sherpa_ncnn {
 
+// log(FLT_EPSILON), i.e., the fbank feature of digital silence, since
+// knf clamps the energy of each mel bin to FLT_EPSILON before the log
+static constexpr float kSilenceFeature = -15.9423847f;
+
 static RecognitionResult Convert(const DecoderResult &src,
                                  const SymbolTable &sym_table,
                                  int32_t frame_shift_ms,
@@ -78,6 +90,23 @@ std::string RecognitionResult::ToString() const {
   return os.str();
 }
 
+std::string RecognitionResultDelta::ToString() const {
+  std::ostringstream os;
+
+  os << "start: " << start << "\n";
+  os << "num_stable_tokens: " << num_stable_tokens << "\n";
+  os << "text: " << text << "\n";
+  os << "timestamps: ";
+  for (const auto &t : timestamps) {
+    os << t << " ";
+  }
+  os << "\n";
+
+  return os.str();
+}
+
+bool RecognizerConfig::Validate() const { return model_config.Validate(); }
+
 std::string RecognizerConfig::ToString() const {
   std::ostringstream os;
 
@@ -88,7 +117,8 @@ std::string RecognizerConfig::ToString() const {
   os << "endpoint_config=" << endpoint_config.ToString() << ", ";
   os << "enable_endpoint=" << (enable_endpoint ? "True" : "False") << ", ";
   os << "hotwords_file=\"" << hotwords_file << "\", ";
-  os << "hotwrods_score=" << hotwords_score << ")";
+  os << "hotwrods_score=" << hotwords_score << ", ";
+  os << "feature_threads=" << feature_threads << ")";
 
   return os.str();
 }
@@ -100,6 +130,12 @@ class Recognizer::Impl {
         model_(Model::Create(config.model_config)),
         endpoint_(config.endpoint_config),
         sym_(config.model_config.tokens) {
+    if (!model_) {
+      // Recognizer::GetModel() returns nullptr in this case
+      NCNN_LOGE("Failed to create the model");
+      return;
+    }
+
     if (config.decoder_config.method == "greedy_search") {
       decoder_ = std::make_unique<GreedySearchDecoder>(model_.get());
     } else if (config.decoder_config.method == "modified_beam_search") {
@@ -113,6 +149,11 @@ class Recognizer::Impl {
       NCNN_LOGE("Unsupported method: %s", config.decoder_config.method.c_str());
       exit(-1);
     }
+
+    if (config.feature_threads > 0) {
+      feature_pipeline_ =
+          std::make_shared<FeaturePipeline>(config.feature_threads);
+    }
   }
 
 #if __ANDROID_API__ >= 9
@@ -121,6 +162,11 @@ class Recognizer::Impl {
         model_(Model::Create(mgr, config.model_config)),
         endpoint_(config.endpoint_config),
         sym_(mgr, config.model_config.tokens) {
+    if (!model_) {
+      NCNN_LOGE("Failed to create the model");
+      return;
+    }
+
     if (config.decoder_config.method == "greedy_search") {
       decoder_ = std::make_unique<GreedySearchDecoder>(model_.get());
     } else if (config.decoder_config.method == "modified_beam_search") {
@@ -134,36 +180,55 @@ class Recognizer::Impl {
       NCNN_LOGE("Unsupported method: %s", config.decoder_config.method.c_str());
       exit(-1);
     }
+
+    if (config.feature_threads > 0) {
+      feature_pipeline_ =
+          std::make_shared<FeaturePipeline>(config.feature_threads);
+    }
   }
 #endif
 
   std::unique_ptr<Stream> CreateStream() const {
-    if (hotwords_.empty()) {
-      auto stream = std::make_unique<Stream>(config_.feat_config);
-      stream->SetResult(decoder_->GetEmptyResult());
-      stream->SetStates(model_->GetEncoderInitStates());
-      return stream;
-    } else {
-      auto r = decoder_->GetEmptyResult();
+    return CreateStreamWithContextGraph(nullptr);
+  }
 
-      auto context_graph =
-          std::make_shared<ContextGraph>(hotwords_, config_.hotwords_score);
+  std::unique_ptr<Stream> CreateStream(const std::string &hotwords) const {
+    // It is usually small, so it is cheap to build it for each stream
+    ContextGraphPtr graph;
+    if (!BuildContextGraph(hotwords, &graph)) {
+      NCNN_LOGE("Ignore hotwords for this stream.");
+      return CreateStream();
+    }
 
-      auto stream =
-          std::make_unique<Stream>(config_.feat_config, context_graph);
+    return CreateStreamWithContextGraph(graph);
+  }
 
-      if (stream->GetContextGraph()) {
-        // r.hyps has only one element.
-        for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
-          it->second.context_state = stream->GetContextGraph()->Root();
-        }
-      }
+  bool SetHotwords(const std::string &hotwords, bool update_existing_streams) {
+    // Build the graph before taking the lock so that CreateStream() and
+    // DecodeStream() from other threads are not blocked by it
+    ContextGraphPtr graph;
+    if (!BuildContextGraph(hotwords, &graph)) {
+      return false;
+    }
 
-      stream->SetResult(r);
-      stream->SetStates(model_->GetEncoderInitStates());
+    std::lock_guard<std::mutex> lock(mutex_);
+    context_graph_ = std::move(graph);
+    context_graph_version_ += 1;
+    if (update_existing_streams) {
+      min_context_graph_version_ = context_graph_version_;
+    }
 
-      return stream;
+    return true;
+  }
+
+  bool SetHotwords(Stream *s, const std::string &hotwords) const {
+    ContextGraphPtr graph;
+    if (!BuildContextGraph(hotwords, &graph)) {
+      return false;
     }
+
+    s->SetOverlayContextGraph(std::move(graph));
+    return true;
   }
 
   bool IsReady(Stream *s) const {
@@ -171,22 +236,51 @@ class Recognizer::Impl {
   }
 
   void DecodeStream(Stream *s) const {
+    ncnn::Mat features =
+        s->GetFrames(s->GetNumProcessedFrames(), model_->Segment());
+    DecodeChunk(s, features, model_->Offset());
+  }
+
+  void FinalizeStream(Stream *s) const {
+    s->WaitForFeatures();
+
+    while (IsReady(s)) {
+      DecodeStream(s);
+    }
+
     int32_t segment = model_->Segment();
     int32_t offset = model_->Offset();
+    int32_t feature_dim = config_.feat_config.feature_dim;
+
+    // The remaining frames are fewer than or equal to segment. Each of
+    // the last chunks is padded with frames of silence. Only encoder
+    // output frames that cover real input frames are decoded.
+    while (true) {
+      int32_t num_processed = s->GetNumProcessedFrames();
+      int32_t num_frames = s->NumFramesReady() - num_processed;
+      if (num_frames <= 0) {
+        break;
+      }
 
-    ncnn::Mat features = s->GetFrames(s->GetNumProcessedFrames(), segment);
-    s->GetNumProcessedFrames() += offset;
-    std::vector<ncnn::Mat> states = s->GetStates();
+      int32_t n = std::min(num_frames, segment);
+      ncnn::Mat frames = s->GetFrames(num_processed, n);
 
-    ncnn::Mat encoder_out;
-    std::tie(encoder_out, states) = model_->RunEncoder(features, states);
+      ncnn::Mat features(feature_dim, segment);
+      features.fill(kSilenceFeature);
+      for (int32_t i = 0; i != n; ++i) {
+        std::copy(frames.row(i), frames.row(i) + feature_dim,
+                  features.row(i));
+      }
 
-    if (s->GetContextGraph()) {
-      decoder_->Decode(encoder_out, s, &s->GetResult());
-    } else {
-      decoder_->Decode(encoder_out, &s->GetResult());
+      DecodeChunk(s, features, std::min(num_frames, offset));
     }
-    s->SetStates(states);
+
+    // The last chunk may advance past the last frame
+    s->GetNumProcessedFrames() =
+        std::min<int32_t>(s->GetNumProcessedFrames(), s->NumFramesReady());
+    s->UpdateQueuedChunks();
+
+    s->Finalize();
   }
 
   bool IsEndpoint(Stream *s) const {
@@ -206,11 +300,7 @@ class Recognizer::Impl {
   void Reset(Stream *s) const {
     auto r = decoder_->GetEmptyResult();
 
-    if (s->GetContextGraph()) {
-      for (auto it = r.hyps.begin(); it != r.hyps.end(); ++it) {
-        it->second.context_state = s->GetContextGraph()->Root();
-      }
-    }
+    InitContextStates(s, &r);
     // Caution: We need to keep the decoder output state
     ncnn::Mat decoder_out = s->GetResult().decoder_out;
     s->SetResult(r);
@@ -239,9 +329,186 @@ class Recognizer::Impl {
     return Convert(decoder_result, sym_, frame_shift_ms, subsampling_factor);
   }
 
+  RecognitionResultDelta GetResultDelta(Stream *s) const {
+    if (IsEndpoint(s)) {
+      s->Finalize();
+    }
+    DecoderResult &r = s->GetResult();
+
+    // Skip blanks added by decoder_->GetEmptyResult()
+    int32_t context_size = model_->ContextSize();
+    int32_t begin = std::max(r.num_returned_stable_tokens, context_size);
+    int32_t end = r.tokens.size();
+
+    // Those 2 parameters are figured out from sherpa source code
+    int32_t frame_shift_ms = 10;
+    int32_t subsampling_factor = 4;
+    float frame_shift_s = frame_shift_ms / 1000. * subsampling_factor;
+
+    RecognitionResultDelta ans;
+    ans.start = begin - context_size;
+    ans.num_stable_tokens =
+        std::max(r.num_stable_tokens, begin) - context_size;
+
+    ans.tokens.reserve(end - begin);
+    ans.stokens.reserve(end - begin);
+    ans.timestamps.reserve(end - begin);
+    for (int32_t i = begin; i < end; ++i) {
+      const auto &sym = sym_[r.tokens[i]];
+      ans.text.append(sym);
+      ans.tokens.push_back(r.tokens[i]);
+      ans.stokens.push_back(sym);
+
+      int32_t k = i - context_size;
+      if (k < static_cast<int32_t>(r.timestamps.size())) {
+        ans.timestamps.push_back(frame_shift_s * r.timestamps[k]);
+      }
+    }
+
+    r.num_returned_stable_tokens = r.num_stable_tokens;
+
+    return ans;
+  }
+
   const Model *GetModel() const { return model_.get(); }
 
+  StatsReport GetStats() const { return stats_->Get(); }
+
+  void ResetStats() { stats_->Reset(); }
+
  private:
+  // Run the encoder on a chunk of segment frames and decode its output.
+  // Only encoder output frames for the first num_valid_frames input
+  // frames are decoded. It is less than offset for the last chunk of
+  // FinalizeStream().
+  void DecodeChunk(Stream *s, ncnn::Mat &features,
+                   int32_t num_valid_frames) const {
+    auto start = std::chrono::steady_clock::now();
+
+    if (s->GetContextGraphVersion() < min_context_graph_version_) {
+      ContextGraphPtr context_graph;
+      int32_t version;
+      std::tie(context_graph, version) = GetContextGraph();
+      s->SetContextGraph(std::move(context_graph), version);
+    }
+
+    int32_t offset = model_->Offset();
+
+    s->GetNumProcessedFrames() += offset;
+    std::vector<ncnn::Mat> states = s->GetStates();
+
+    ncnn::Mat encoder_out;
+    {
+      ScopedStageTimer timer(StatsStage::kEncoder, &s->GetStats(),
+                             stats_.get());
+      std::tie(encoder_out, states) = model_->RunEncoder(features, states);
+    }
+
+    if (num_valid_frames < offset) {
+      int32_t num_valid_rows =
+          (num_valid_frames * encoder_out.h + offset - 1) / offset;
+      encoder_out = encoder_out.row_range(0, num_valid_rows);
+    }
+
+    {
+      // Time spent in the decoder and joiner networks is excluded
+      ScopedStageTimer timer(StatsStage::kSearch, &s->GetStats(),
+                             stats_.get());
+      if (s->GetContextGraph() || s->GetOverlayContextGraph()) {
+        decoder_->Decode(encoder_out, s, &s->GetResult());
+      } else {
+        decoder_->Decode(encoder_out, &s->GetResult());
+      }
+    }
+    s->SetStates(states);
+    s->UpdateQueuedChunks();
+
+    float elapsed_seconds =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count() /
+        1e6f;
+
+    // frame shift is 10 milliseconds
+    float audio_seconds = num_valid_frames * 0.01f;
+
+    const auto &metrics = GetOnlineAsrMetrics();
+    metrics.audio_seconds->Inc(audio_seconds);
+    metrics.decode_seconds->Inc(elapsed_seconds);
+    metrics.decode_latency->Observe(elapsed_seconds);
+    metrics.rtf->Observe(elapsed_seconds / audio_seconds);
+  }
+
+  // @param overlay If not null, it contains hotwords for the returned
+  //                stream only.
+  std::unique_ptr<Stream> CreateStreamWithContextGraph(
+      ContextGraphPtr overlay) const {
+    ContextGraphPtr context_graph;
+    int32_t version;
+    std::tie(context_graph, version) = GetContextGraph();
+
+    auto stream = std::make_unique<Stream>(config_.feat_config);
+    stream->SetSharedStats(stats_);
+    stream->SetChunkSize(model_->Segment(), model_->Offset());
+    if (feature_pipeline_) {
+      stream->SetFeaturePipeline(feature_pipeline_);
+    }
+
+    stream->SetResult(decoder_->GetEmptyResult());
+    stream->SetStates(model_->GetEncoderInitStates());
+
+    // They also move the hypotheses to the roots of the graphs
+    stream->SetContextGraph(std::move(context_graph), version);
+    stream->SetOverlayContextGraph(std::move(overlay));
+
+    return stream;
+  }
+
+  static void InitContextStates(Stream *s, DecoderResult *r) {
+    for (auto it = r->hyps.begin(); it != r->hyps.end(); ++it) {
+      if (s->GetContextGraph()) {
+        it->second.context_state = s->GetContextGraph()->Root();
+      }
+
+      if (s->GetOverlayContextGraph()) {
+        it->second.overlay_context_state = s->GetOverlayContextGraph()->Root();
+      }
+    }
+  }
+
+  // Return the graph for new streams and its version
+  std::pair<ContextGraphPtr, int32_t> GetContextGraph() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {context_graph_, context_graph_version_};
+  }
+
+  // @param hotwords See Recognizer::SetHotwords()
+  // @param graph On return, it is null if hotwords is empty
+  // @return Return false if hotwords are invalid or they are not supported
+  //         by the decoding method.
+  bool BuildContextGraph(const std::string &hotwords,
+                         ContextGraphPtr *graph) const {
+    if (config_.decoder_config.method != "modified_beam_search") {
+      NCNN_LOGE("Hotwords are supported only by modified_beam_search.");
+      return false;
+    }
+
+    std::vector<std::vector<int32_t>> token_ids;
+    std::vector<float> scores;
+    if (!ParseHotwords(hotwords, sym_, &token_ids, &scores)) {
+      NCNN_LOGE("Invalid hotwords '%s'", hotwords.c_str());
+      return false;
+    }
+
+    graph->reset();
+    if (!token_ids.empty()) {
+      *graph = std::make_shared<ContextGraph>(
+          token_ids, config_.hotwords_score, scores);
+    }
+
+    return true;
+  }
+
 #if __ANDROID_API__ >= 9
   void InitHotwords(AAssetManager *mgr) {
     AAsset *asset = AAssetManager_open(mgr, config_.hotwords_file.c_str(),
@@ -274,39 +541,20 @@ class Recognizer::Impl {
   }
 
   void InitHotwords(std::istream &is) {
-    std::vector<int32_t> tmp;
-    std::string line;
-    std::string word;
-    // The format of each line in hotwords_file looks like:
-    // ▁HE LL O ▁WORLD :1.5
-    // the first several items are tokens of the hotword, the item starts with
-    // ":" is the customize boosting score for this hotword, if there is no
-    // customize score it will use the score from configuration (i.e.
-    // config_.hotwords_score).
-    while (std::getline(is, line)) {
-      std::istringstream iss(line);
-      float tmp_score = 0.0;  // MUST be 0.0, meaning if no customize score use
-                              // the global one.
-      while (iss >> word) {
-        if (sym_.contains(word)) {
-          int32_t number = sym_[word];
-          tmp.push_back(number);
-        } else {
-          if (word[0] == ':') {
-            tmp_score = std::stof(word.substr(1));
-          } else {
-            NCNN_LOGE(
-                "Cannot find ID for hotword %s at line: %s. (Hint: words on "
-                "the "
-                "same line are separated by spaces)",
-                word.c_str(), line.c_str());
-            exit(-1);
-          }
-        }
-      }
-      hotwords_.push_back(std::move(tmp));
-      boost_scores_.push_back(tmp_score);
+    std::vector<std::vector<int32_t>> hotwords;
+    std::vector<float> boost_scores;
+
+    if (!ParseHotwords(is, sym_, &hotwords, &boost_scores)) {
+      exit(-1);
     }
+
+    if (hotwords.empty()) {
+      return;
+    }
+
+    // The graph is built only once and is shared by all streams
+    context_graph_ = std::make_shared<ContextGraph>(
+        hotwords, config_.hotwords_score, boost_scores);
   }
 
  private:
@@ -315,8 +563,27 @@ class Recognizer::Impl {
   std::unique_ptr<Decoder> decoder_;
   Endpoint endpoint_;
   SymbolTable sym_;
-  std::vector<std::vector<int32_t>> hotwords_;
-  std::vector<float> boost_scores_;
+
+  // Time spent in each stage, summed over all streams. Streams share
+  // it, so it lives as long as the last of them.
+  std::shared_ptr<Stats> stats_ = std::make_shared<Stats>();
+
+  // Shared by all streams. It is null if config_.feature_threads is 0.
+  std::shared_ptr<FeaturePipeline> feature_pipeline_;
+
+  mutable std::mutex mutex_;
+
+  // Context graph for new streams. It is null if there are no hotwords.
+  // It is protected by mutex_.
+  ContextGraphPtr context_graph_;
+
+  // Incremented each time context_graph_ is replaced.
+  // It is protected by mutex_.
+  int32_t context_graph_version_ = 0;
+
+  // Streams whose graph is older than this version switch to
+  // context_graph_ in DecodeStream()
+  std::atomic<int32_t> min_context_graph_version_{0};
 };
 
 Recognizer::Recognizer(const RecognizerConfig &config)
@@ -333,10 +600,36 @@ std::unique_ptr<Stream> Recognizer::CreateStream() const {
   return impl_->CreateStream();
 }
 
+std::unique_ptr<Stream> Recognizer::CreateStream(
+    const std::string &hotwords) const {
+  return impl_->CreateStream(hotwords);
+}
+
+bool Recognizer::SetHotwords(const std::string &hotwords,
+                             bool update_existing_streams /*= false*/) {
+  return impl_->SetHotwords(hotwords, update_existing_streams);
+}
+
+bool Recognizer::SetHotwords(Stream *s, const std::string &hotwords) const {
+  return impl_->SetHotwords(s, hotwords);
+}
+
 bool Recognizer::IsReady(Stream *s) const { return impl_->IsReady(s); }
 
 void Recognizer::DecodeStream(Stream *s) const { impl_->DecodeStream(s); }
 
+void Recognizer::FinalizeStream(Stream *s) const {
+  impl_->FinalizeStream(s);
+}
+
+void Recognizer::DecodeStreams(Stream **ss, int32_t n) const {
+  for (int32_t i = 0; i != n; ++i) {
+    if (impl_->IsReady(ss[i])) {
+      impl_->DecodeStream(ss[i]);
+    }
+  }
+}
+
 bool Recognizer::IsEndpoint(Stream *s) const { return impl_->IsEndpoint(s); }
 
 void Recognizer::Reset(Stream *s) const { impl_->Reset(s); }
@@ -345,6 +638,26 @@ RecognitionResult Recognizer::GetResult(Stream *s) const {
   return impl_->GetResult(s);
 }
 
+RecognitionResultDelta Recognizer::GetResultDelta(Stream *s) const {
+  return impl_->GetResultDelta(s);
+}
+
 const Model *Recognizer::GetModel() const { return impl_->GetModel(); }
 
+StatsReport Recognizer::GetStats() const { return impl_->GetStats(); }
+
+void Recognizer::ResetStats() { impl_->ResetStats(); }
+
+std::string Recognizer::GetProfilingReport() const {
+  auto profiler = GetModel()->GetProfiler();
+  return profiler ? profiler->Report() : "";
+}
+
+void Recognizer::ResetProfiling() {
+  auto profiler = GetModel()->GetProfiler();
+  if (profiler) {
+    profiler->Reset();
+  }
+}
+
 }  // namespace sherpa_ncnn
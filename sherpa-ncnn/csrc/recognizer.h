@@ -28,6 +28,7 @@
 #include "sherpa-ncnn/csrc/features.h"
 #include "sherpa-ncnn/csrc/hypothesis.h"
 #include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/stats.h"
 #include "sherpa-ncnn/csrc/stream.h"
 #include "sherpa-ncnn/csrc/symbol-table.h"
 
@@ -49,6 +50,29 @@ struct RecognitionResult {
   std::string ToString() const;
 };
 
+// Part of a RecognitionResult that is new or may have changed since
+// the last call of Recognizer::GetResultDelta()
+struct RecognitionResultDelta {
+  // Index of the first token in this delta. Tokens with index >= start
+  // that are returned by previous calls should be replaced by tokens
+  // of this delta.
+  int32_t start = 0;
+
+  // Tokens with index < num_stable_tokens won't change any more.
+  // It is always >= start. Note: Greedy search never changes decoded
+  // tokens, while modified_beam_search may change the tokens that are not
+  // shared by all active paths.
+  int32_t num_stable_tokens = 0;
+
+  // Concatenation of stokens
+  std::string text;
+  std::vector<float> timestamps;
+  std::vector<int32_t> tokens;
+  std::vector<std::string> stokens;
+
+  std::string ToString() const;
+};
+
 struct RecognizerConfig {
   FeatureExtractorConfig feat_config;
   ModelConfig model_config;
@@ -61,6 +85,11 @@ struct RecognizerConfig {
   /// used only for modified_beam_search
   float hotwords_score = 1.5;
 
+  /// If positive, features of all streams are computed by this many
+  /// threads shared by the streams, so that Stream::AcceptWaveform()
+  /// does not block the caller. See Stream::SetFeaturePipeline().
+  int32_t feature_threads = 0;
+
   RecognizerConfig() = default;
 
   RecognizerConfig(const FeatureExtractorConfig &feat_config,
@@ -76,6 +105,8 @@ struct RecognizerConfig {
         hotwords_file(hotwords_file),
         hotwords_score(hotwords_score) {}
 
+  bool Validate() const;
+
   std::string ToString() const;
 };
 
@@ -92,6 +123,49 @@ class Recognizer {
   /// Create a stream for decoding.
   std::unique_ptr<Stream> CreateStream() const;
 
+  /** Create a stream with extra hotwords for this stream only.
+   *
+   * The hotwords are used on top of those from config.hotwords_file,
+   * which are shared by all streams. Used only for modified_beam_search.
+   *
+   * @param hotwords Hotwords separated by /. Each hotword has the same
+   *                 format as a line in config.hotwords_file, e.g.,
+   *                 "▁HE LL O ▁WORLD :2.0/▁HI".
+   */
+  std::unique_ptr<Stream> CreateStream(const std::string &hotwords) const;
+
+  /** Replace the hotwords shared by all streams without reloading models.
+   *
+   * The new hotwords are compiled on the calling thread, so it can be
+   * called from a thread other than the one decoding streams. Streams
+   * created afterwards use the new hotwords.
+   *
+   * @param hotwords Hotwords separated by / or new lines. Each hotword is
+   *                 either tokens separated by spaces, e.g., "▁HE LL O",
+   *                 or text, e.g., "HELLO", which is split into tokens by
+   *                 greedy longest match against the tokens of the model.
+   *                 A boosting score can be appended, e.g., "HELLO :2.0".
+   *                 An empty string removes all hotwords.
+   * @param update_existing_streams If true, existing streams switch to the
+   *                                new hotwords the next time they are
+   *                                decoded.
+   * @return Return false if hotwords are invalid or the decoding method is
+   *         not modified_beam_search. The current hotwords are kept then.
+   */
+  bool SetHotwords(const std::string &hotwords,
+                   bool update_existing_streams = false);
+
+  /** Replace the hotwords specific to a stream. See
+   * CreateStream(const std::string &).
+   *
+   * It must not be called while the stream is being decoded.
+   *
+   * @param s The stream.
+   * @param hotwords Same format as in SetHotwords() above.
+   * @return Return false if hotwords are invalid.
+   */
+  bool SetHotwords(Stream *s, const std::string &hotwords) const;
+
   /**
    * Return true if the given stream has enough frames for decoding.
    * Return false otherwise
@@ -100,6 +174,31 @@ class Recognizer {
 
   void DecodeStream(Stream *s) const;
 
+  /** Decode all remaining frames of a stream after InputFinished() and
+   * finalize its result.
+   *
+   * Without it, the caller has to append silence to the input, e.g.,
+   * 0.3 seconds, so that the last frames become ready for DecodeStream().
+   * Instead, the frames that are left are padded with frames of silence
+   * to a full chunk, and only the encoder output that covers real frames
+   * is decoded. The final result is available as soon as the input ends.
+   *
+   * The stream should not accept more audio afterwards.
+   */
+  void FinalizeStream(Stream *s) const;
+
+  /** Decode one chunk of each stream that is ready. Streams that are not
+   * ready are skipped.
+   *
+   * It is equivalent to calling IsReady() and DecodeStream() on each
+   * stream, but bindings for other languages need to cross the language
+   * boundary only once.
+   *
+   * @param ss Pointer to an array of streams.
+   * @param n  Number of streams in ss.
+   */
+  void DecodeStreams(Stream **ss, int32_t n) const;
+
   // Return true if we detect an endpoint for this stream.
   // Note: If this function returns true, you usually want to
   // invoke Reset(s).
@@ -111,11 +210,40 @@ class Recognizer {
 
   RecognitionResult GetResult(Stream *s) const;
 
+  /** Return tokens of the result that are new or may have changed since
+   * the last call of this function for the stream, or since the stream
+   * was created or Reset().
+   *
+   * Unlike GetResult(), its cost depends on the number of returned
+   * tokens instead of the length of the utterance, so it is suitable
+   * for polling after each chunk.
+   */
+  RecognitionResultDelta GetResultDelta(Stream *s) const;
+
   // Return the contained model
   //
   // The user should not free it.
   const Model *GetModel() const;
 
+  /** Return the time spent in each stage, summed over all streams
+   * created by this recognizer. Use Stream::GetStatsReport() for a
+   * single stream.
+   *
+   * Times are measured only if sherpa-ncnn is built with
+   * -DSHERPA_NCNN_ENABLE_STATS=ON.
+   */
+  StatsReport GetStats() const;
+
+  void ResetStats();
+
+  /** Return the time spent in each layer of the encoder, decoder and
+   * joiner, sorted by time. It returns an empty string unless
+   * ModelConfig::enable_profiling is true.
+   */
+  std::string GetProfilingReport() const;
+
+  void ResetProfiling();
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
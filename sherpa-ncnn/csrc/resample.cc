@@ -28,8 +28,22 @@
 #include <math.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <tuple>
 #include <type_traits>
+#include <vector>
+
+#if __ARM_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SHERPA_NCNN_RESAMPLE_SSE2 1
+#include <immintrin.h>
+#endif
 
 #ifndef M_2PI
 #define M_2PI 6.283185307179586476925286766559005
@@ -73,9 +87,111 @@ I Lcm(I m, I n) {
   return gcd * (m / gcd) * (n / gcd);
 }
 
+// Rows of a filter bank start at a multiple of this number of floats,
+// i.e., they are 32-byte aligned
+static constexpr int32_t kFilterBankAlignment = 8;
+
+struct LinearResample::FilterBank {
+  FilterBank(int32_t num_phases, int32_t stride)
+      : first_index(num_phases),
+        num_taps(num_phases),
+        stride(stride),
+        storage(num_phases * stride + kFilterBankAlignment - 1) {
+    constexpr size_t kBytes = kFilterBankAlignment * sizeof(float);
+    size_t addr = reinterpret_cast<size_t>(storage.data());
+    size_t offset = (kBytes - addr % kBytes) % kBytes / sizeof(float);
+    weights = storage.data() + offset;
+  }
+
+  FilterBank(const FilterBank &) = delete;
+  FilterBank &operator=(const FilterBank &) = delete;
+
+  const float *Weights(int32_t phase) const { return weights + phase * stride; }
+
+  // The first input-sample index that we sum over, for each output-sample
+  // index in a unit. May be negative.
+  std::vector<int32_t> first_index;
+
+  // Number of weights for each output-sample index in a unit
+  std::vector<int32_t> num_taps;
+
+  // Number of floats between two rows of weights. Unused entries are 0.
+  int32_t stride;
+
+  std::vector<float> storage;
+  float *weights;  // points into storage
+};
+
+#if SHERPA_NCNN_RESAMPLE_SSE2
+static float HorizontalSum(__m128 v) {
+  __m128 t = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  t = _mm_add_ss(t, _mm_shuffle_ps(t, t, 0x55));
+  return _mm_cvtss_f32(t);
+}
+#endif
+
+// b is 32-byte aligned, but a may be not.
 static float DotProduct(const float *a, const float *b, int32_t n) {
+  int32_t i = 0;
   float sum = 0;
-  for (int32_t i = 0; i != n; ++i) {
+
+#if __ARM_NEON
+  float32x4_t s0 = vdupq_n_f32(0);
+  float32x4_t s1 = vdupq_n_f32(0);
+  for (; i + 8 <= n; i += 8) {
+    s0 = vmlaq_f32(s0, vld1q_f32(a + i), vld1q_f32(b + i));
+    s1 = vmlaq_f32(s1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+  }
+
+  if (i + 4 <= n) {
+    s0 = vmlaq_f32(s0, vld1q_f32(a + i), vld1q_f32(b + i));
+    i += 4;
+  }
+
+  s0 = vaddq_f32(s0, s1);
+#if __aarch64__
+  sum = vaddvq_f32(s0);
+#else
+  float32x2_t t = vadd_f32(vget_low_f32(s0), vget_high_f32(s0));
+  sum = vget_lane_f32(vpadd_f32(t, t), 0);
+#endif
+#elif __AVX__
+  __m256 s0 = _mm256_setzero_ps();
+  __m256 s1 = _mm256_setzero_ps();
+  for (; i + 16 <= n; i += 16) {
+    s0 = _mm256_add_ps(
+        s0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_load_ps(b + i)));
+    s1 = _mm256_add_ps(s1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8),
+                                         _mm256_load_ps(b + i + 8)));
+  }
+
+  if (i + 8 <= n) {
+    s0 = _mm256_add_ps(
+        s0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_load_ps(b + i)));
+    i += 8;
+  }
+
+  s0 = _mm256_add_ps(s0, s1);
+  sum = HorizontalSum(
+      _mm_add_ps(_mm256_castps256_ps128(s0), _mm256_extractf128_ps(s0, 1)));
+#elif SHERPA_NCNN_RESAMPLE_SSE2
+  __m128 s0 = _mm_setzero_ps();
+  __m128 s1 = _mm_setzero_ps();
+  for (; i + 8 <= n; i += 8) {
+    s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_load_ps(b + i)));
+    s1 = _mm_add_ps(
+        s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_load_ps(b + i + 4)));
+  }
+
+  if (i + 4 <= n) {
+    s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_load_ps(b + i)));
+    i += 4;
+  }
+
+  sum = HorizontalSum(_mm_add_ps(s0, s1));
+#endif
+
+  for (; i != n; ++i) {
     sum += a[i] * b[i];
   }
   return sum;
@@ -98,16 +214,38 @@ LinearResample::LinearResample(int32_t samp_rate_in_hz,
   input_samples_in_unit_ = samp_rate_in_ / base_freq;
   output_samples_in_unit_ = samp_rate_out_ / base_freq;
 
-  SetIndexesAndWeights();
+  filter_bank_ = GetFilterBank();
   Reset();
 }
 
-void LinearResample::SetIndexesAndWeights() {
-  first_index_.resize(output_samples_in_unit_);
-  weights_.resize(output_samples_in_unit_);
+std::shared_ptr<const LinearResample::FilterBank>
+LinearResample::GetFilterBank() const {
+  using Key = std::tuple<int32_t, int32_t, float, int32_t>;
+
+  // Filter banks are small and there are only a few combinations of
+  // sample rates in a process, so they are never removed.
+  static std::mutex mutex;
+  static std::map<Key, std::shared_ptr<const FilterBank>> cache;
+
+  Key key{samp_rate_in_, samp_rate_out_, filter_cutoff_, num_zeros_};
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &filter_bank = cache[key];
+  if (!filter_bank) {
+    filter_bank = CreateFilterBank();
+  }
+
+  return filter_bank;
+}
+
+std::shared_ptr<const LinearResample::FilterBank>
+LinearResample::CreateFilterBank() const {
+  std::vector<int32_t> first_index(output_samples_in_unit_);
+  std::vector<int32_t> num_taps(output_samples_in_unit_);
 
   double window_width = num_zeros_ / (2.0 * filter_cutoff_);
 
+  int32_t max_num_taps = 0;
   for (int32_t i = 0; i < output_samples_in_unit_; i++) {
     double output_t = i / static_cast<double>(samp_rate_out_);
     double min_t = output_t - window_width, max_t = output_t + window_width;
@@ -121,16 +259,31 @@ void LinearResample::SetIndexesAndWeights() {
     int32_t min_input_index = ceil(min_t * samp_rate_in_),
             max_input_index = floor(max_t * samp_rate_in_),
             num_indices = max_input_index - min_input_index + 1;
-    first_index_[i] = min_input_index;
-    weights_[i].resize(num_indices);
-    for (int32_t j = 0; j < num_indices; j++) {
-      int32_t input_index = min_input_index + j;
+    first_index[i] = min_input_index;
+    num_taps[i] = num_indices;
+    max_num_taps = std::max(max_num_taps, num_indices);
+  }
+
+  int32_t stride = (max_num_taps + kFilterBankAlignment - 1) /
+                   kFilterBankAlignment * kFilterBankAlignment;
+
+  auto ans = std::make_shared<FilterBank>(output_samples_in_unit_, stride);
+  ans->first_index = std::move(first_index);
+  ans->num_taps = std::move(num_taps);
+
+  for (int32_t i = 0; i < output_samples_in_unit_; i++) {
+    double output_t = i / static_cast<double>(samp_rate_out_);
+    float *weights = ans->weights + i * stride;
+    for (int32_t j = 0; j < ans->num_taps[i]; j++) {
+      int32_t input_index = ans->first_index[i] + j;
       double input_t = input_index / static_cast<double>(samp_rate_in_),
              delta_t = input_t - output_t;
       // sign of delta_t doesn't matter.
-      weights_[i][j] = FilterFunc(delta_t) / samp_rate_in_;
+      weights[j] = FilterFunc(delta_t) / samp_rate_in_;
     }
   }
+
+  return ans;
 }
 
 /** Here, t is a time in seconds representing an offset from
@@ -175,19 +328,18 @@ void LinearResample::Resample(const float *input, int32_t input_dim, bool flush,
     int64_t first_samp_in;
     int32_t samp_out_wrapped;
     GetIndexes(samp_out, &first_samp_in, &samp_out_wrapped);
-    const std::vector<float> &weights = weights_[samp_out_wrapped];
+    const float *weights = filter_bank_->Weights(samp_out_wrapped);
+    int32_t num_taps = filter_bank_->num_taps[samp_out_wrapped];
     // first_input_index is the first index into "input" that we have a weight
     // for.
     int32_t first_input_index =
         static_cast<int32_t>(first_samp_in - input_sample_offset_);
     float this_output;
-    if (first_input_index >= 0 &&
-        first_input_index + static_cast<int32_t>(weights.size()) <= input_dim) {
-      this_output =
-          DotProduct(input + first_input_index, weights.data(), weights.size());
+    if (first_input_index >= 0 && first_input_index + num_taps <= input_dim) {
+      this_output = DotProduct(input + first_input_index, weights, num_taps);
     } else {  // Handle edge cases.
       this_output = 0.0;
-      for (int32_t i = 0; i < static_cast<int32_t>(weights.size()); i++) {
+      for (int32_t i = 0; i < num_taps; i++) {
         float weight = weights[i];
         int32_t input_index = first_input_index + i;
         if (input_index < 0 &&
@@ -275,8 +427,8 @@ void LinearResample::GetIndexes(int64_t samp_out, int64_t *first_samp_in,
   // samp_out_wrapped is equal to samp_out % output_samples_in_unit_
   *samp_out_wrapped =
       static_cast<int32_t>(samp_out - unit_index * output_samples_in_unit_);
-  *first_samp_in =
-      first_index_[*samp_out_wrapped] + unit_index * input_samples_in_unit_;
+  *first_samp_in = filter_bank_->first_index[*samp_out_wrapped] +
+                   unit_index * input_samples_in_unit_;
 }
 
 void LinearResample::SetRemainder(const float *input, int32_t input_dim) {
@@ -25,6 +25,7 @@
 #define SHERPA_NCNN_CSRC_RESAMPLE_H_
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace sherpa_ncnn {
@@ -42,6 +43,9 @@ class LinearResample {
   /// than samp_rate_in_hz/2 and less than samp_rate_out_hz/2.  num_zeros
   /// controls the sharpness of the filter, more == sharper but less efficient.
   /// We suggest around 4 to 10 for normal use.
+  ///
+  /// Filter weights depend only on the arguments, so they are computed
+  /// once per process and shared by all objects with the same arguments.
   LinearResample(int32_t samp_rate_in_hz, int32_t samp_rate_out_hz,
                  float filter_cutoff_hz, int32_t num_zeros);
 
@@ -78,7 +82,11 @@ class LinearResample {
   int32_t GetOutputSamplingRate() const { return samp_rate_out_; }
 
  private:
-  void SetIndexesAndWeights();
+  struct FilterBank;
+
+  std::shared_ptr<const FilterBank> GetFilterBank() const;
+
+  std::shared_ptr<const FilterBank> CreateFilterBank() const;
 
   float FilterFunc(float) const;
 
@@ -118,14 +126,10 @@ class LinearResample {
                                     ///< = samp_rate_out_hz /
                                     ///< Gcd(samp_rate_in_hz, samp_rate_out_hz)
 
-  /// The first input-sample index that we sum over, for this output-sample
-  /// index.  May be negative; any truncation at the beginning is handled
-  /// separately.  This is just for the first few output samples, but we can
-  /// extrapolate the correct input-sample index for arbitrary output samples.
-  std::vector<int32_t> first_index_;
-
-  /// Weights on the input samples, for this output-sample index.
-  std::vector<std::vector<float>> weights_;
+  /// The first input-sample index and weights on the input samples for
+  /// the first output_samples_in_unit_ output samples. We can extrapolate
+  /// them for arbitrary output samples. It is shared and never modified.
+  std::shared_ptr<const FilterBank> filter_bank_;
 
   // the following variables keep track of where we are in a particular signal,
   // if it is being provided over multiple calls to Resample().
@@ -0,0 +1,847 @@
+// sherpa-ncnn/csrc/search-mixed-precision.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+// Search for the layers of the encoder and the joiner that should stay in
+// floating point while all other layers are quantized to int8.
+//
+// It uses the outputs of generate-int8-scale-table: the scale tables and
+// the sensitivity report. Layers are kept in floating point in the order
+// of the report, i.e., the most sensitive ones first. Each candidate is
+// built in memory from the fp32 model and its WER and real time factor
+// are measured on the given wave files.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <filesystem>  // NOLINT
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "layer/convolution.h"
+#include "layer/convolutiondepthwise.h"
+#include "layer/innerproduct.h"
+#include "net.h"
+#include "sherpa-ncnn/csrc/features.h"
+#include "sherpa-ncnn/csrc/greedy-search-decoder.h"
+#include "sherpa-ncnn/csrc/model.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/symbol-table.h"
+#include "sherpa-ncnn/csrc/wave-reader.h"
+#include "sherpa-ncnn/csrc/wer.h"
+
+namespace {
+
+// Bits of ncnn's per-layer featmask (param id 31)
+constexpr int32_t kFeatmaskNoFp16Arithmetic = 1 << 0;
+constexpr int32_t kFeatmaskNoFp16Storage = 1 << 1;
+constexpr int32_t kFeatmaskFp32 =
+    kFeatmaskNoFp16Arithmetic | kFeatmaskNoFp16Storage;
+
+struct Wave {
+  std::string filename;
+  int32_t sample_rate = 0;
+  std::vector<float> samples;
+};
+
+// Entries of a scale table written by generate-int8-scale-table
+struct ScaleTable {
+  // layer name -> per output channel weight scales
+  std::map<std::string, std::vector<float>> weight_scales;
+
+  // layer name -> scale of the input
+  std::map<std::string, float> bottom_scales;
+};
+
+// A layer that can be quantized
+struct QuantLayer {
+  std::string model;  // encoder or joiner
+  std::string name;
+};
+
+struct Candidate {
+  // Number of the most sensitive layers that are kept in floating point
+  int32_t num_float_layers = 0;
+
+  double wer = 0;  // against the transcripts, if given
+  double wer_vs_reference = 0;
+  double rtf = 0;
+  double elapsed_seconds = 0;
+};
+
+// Precision of each layer of a candidate
+struct Plan {
+  std::set<std::string> encoder_int8;
+  std::set<std::string> joiner_int8;
+
+  std::set<std::string> encoder_fp32;
+  std::set<std::string> joiner_fp32;
+};
+
+bool ReadScaleTable(const std::string &filename, ScaleTable *table) {
+  std::ifstream is(filename);
+  if (!is) {
+    fprintf(stderr, "Failed to open %s\n", filename.c_str());
+    return false;
+  }
+
+  const std::string suffix = "_param_0";
+
+  std::string line;
+  while (std::getline(is, line)) {
+    std::istringstream iss(line);
+    std::string name;
+    iss >> name;
+    if (name.empty()) {
+      continue;
+    }
+
+    std::vector<float> scales;
+    float f;
+    while (iss >> f) {
+      scales.push_back(f);
+    }
+
+    if (scales.empty()) {
+      fprintf(stderr, "No scales for %s in %s\n", name.c_str(),
+              filename.c_str());
+      return false;
+    }
+
+    if (name.size() > suffix.size() &&
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) ==
+            0) {
+      name.resize(name.size() - suffix.size());
+      table->weight_scales[name] = std::move(scales);
+    } else {
+      table->bottom_scales[name] = scales[0];
+    }
+  }
+
+  return true;
+}
+
+// Return layers that are in both scale tables, the most sensitive ones
+// first. Layers that are not in the report are put at the end.
+std::vector<QuantLayer> SortLayers(const std::string &report,
+                                   const ScaleTable &encoder_table,
+                                   const ScaleTable &joiner_table) {
+  auto quantizable = [&](const std::string &model, const std::string &name) {
+    const ScaleTable &t = model == "encoder" ? encoder_table : joiner_table;
+    return t.weight_scales.count(name) && t.bottom_scales.count(name);
+  };
+
+  std::vector<QuantLayer> ans;
+  std::set<std::pair<std::string, std::string>> seen;
+
+  std::ifstream is(report);
+  if (!is) {
+    fprintf(stderr, "Failed to open %s\n", report.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  std::string line;
+  while (std::getline(is, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    std::istringstream iss(line);
+    QuantLayer layer;
+    iss >> layer.model >> layer.name;
+    if (quantizable(layer.model, layer.name) &&
+        seen.insert({layer.model, layer.name}).second) {
+      ans.push_back(layer);
+    }
+  }
+
+  for (const auto *p : {&encoder_table, &joiner_table}) {
+    std::string model = p == &encoder_table ? "encoder" : "joiner";
+    for (const auto &kv : p->weight_scales) {
+      if (quantizable(model, kv.first) &&
+          seen.insert({model, kv.first}).second) {
+        ans.push_back({model, kv.first});
+      }
+    }
+  }
+
+  return ans;
+}
+
+Plan MakePlan(const std::vector<QuantLayer> &layers, int32_t num_float_layers,
+              bool fp32) {
+  Plan plan;
+  for (int32_t i = 0; i != static_cast<int32_t>(layers.size()); ++i) {
+    const auto &layer = layers[i];
+    bool is_encoder = layer.model == "encoder";
+    if (i >= num_float_layers) {
+      (is_encoder ? plan.encoder_int8 : plan.joiner_int8).insert(layer.name);
+    } else if (fp32) {
+      (is_encoder ? plan.encoder_fp32 : plan.joiner_fp32).insert(layer.name);
+    }
+  }
+  return plan;
+}
+
+// Mirror how ncnn applies featmask to the options of a layer
+ncnn::Option MaskOption(const ncnn::Option &opt, int32_t featmask) {
+  ncnn::Option ans = opt;
+  if (featmask & kFeatmaskNoFp16Arithmetic) {
+    ans.use_fp16_arithmetic = false;
+  }
+
+  if (featmask & kFeatmaskNoFp16Storage) {
+    ans.use_fp16_storage = false;
+    ans.use_fp16_packed = false;
+  }
+
+  return ans;
+}
+
+// Quantize the weights of a layer to int8 like ncnn2int8 does
+bool QuantizeLayer(ncnn::Layer *layer, const std::vector<float> &weight_scales,
+                   float bottom_scale) {
+  ncnn::Mat *weight_data = nullptr;
+  ncnn::Mat *weight_data_int8_scales = nullptr;
+  ncnn::Mat *bottom_blob_int8_scales = nullptr;
+  int *int8_scale_term = nullptr;
+  int int8_scale_term_value = 0;
+
+  if (layer->type == "Convolution") {
+    auto *convolution = static_cast<ncnn::Convolution *>(layer);
+    weight_data = &convolution->weight_data;
+    weight_data_int8_scales = &convolution->weight_data_int8_scales;
+    bottom_blob_int8_scales = &convolution->bottom_blob_int8_scales;
+    int8_scale_term = &convolution->int8_scale_term;
+    int8_scale_term_value = 2;
+  } else if (layer->type == "ConvolutionDepthWise") {
+    auto *convolutiondepthwise =
+        static_cast<ncnn::ConvolutionDepthWise *>(layer);
+    weight_data = &convolutiondepthwise->weight_data;
+    weight_data_int8_scales = &convolutiondepthwise->weight_data_int8_scales;
+    bottom_blob_int8_scales = &convolutiondepthwise->bottom_blob_int8_scales;
+    int8_scale_term = &convolutiondepthwise->int8_scale_term;
+    int8_scale_term_value = 1;
+  } else if (layer->type == "InnerProduct") {
+    auto *innerproduct = static_cast<ncnn::InnerProduct *>(layer);
+    weight_data = &innerproduct->weight_data;
+    weight_data_int8_scales = &innerproduct->weight_data_int8_scales;
+    bottom_blob_int8_scales = &innerproduct->bottom_blob_int8_scales;
+    int8_scale_term = &innerproduct->int8_scale_term;
+    int8_scale_term_value = 2;
+  } else {
+    return false;
+  }
+
+  int32_t num_channels = static_cast<int32_t>(weight_scales.size());
+  if (weight_data->elemsize != 4u || weight_data->w % num_channels != 0) {
+    fprintf(stderr, "Layer %s: weights do not match the scale table\n",
+            layer->name.c_str());
+    return false;
+  }
+
+  const int32_t size = weight_data->w / num_channels;
+
+  ncnn::Mat weight_data_int8(weight_data->w, (size_t)1u);
+  ncnn::Mat scales(num_channels);
+  for (int32_t n = 0; n != num_channels; ++n) {
+    const float scale = weight_scales[n];
+    const float *w = static_cast<const float *>(*weight_data) + size * n;
+    signed char *q =
+        static_cast<signed char *>(weight_data_int8.data) + size * n;
+    for (int32_t k = 0; k != size; ++k) {
+      float v = std::round(w[k] * scale);
+      q[k] = static_cast<signed char>(std::min(127.f, std::max(-127.f, v)));
+    }
+    scales[n] = scale;
+  }
+
+  ncnn::Mat bottom_scales(1);
+  bottom_scales[0] = bottom_scale;
+
+  *weight_data = weight_data_int8;
+  *weight_data_int8_scales = scales;
+  *bottom_blob_int8_scales = bottom_scales;
+  *int8_scale_term = int8_scale_term_value;
+
+  return true;
+}
+
+// Apply int8 and fp32 overrides to a net that has been loaded with
+// opt.lightmode == false, so that layers still have their fp32 weights
+void ApplyPlan(const std::set<std::string> &int8_layers,
+               const std::set<std::string> &fp32_layers,
+               const ScaleTable &table, ncnn::Net *net) {
+  for (ncnn::Layer *layer : net->mutable_layers()) {
+    bool to_int8 = int8_layers.count(layer->name) > 0;
+    bool to_fp32 = fp32_layers.count(layer->name) > 0;
+    if (!to_int8 && !to_fp32) {
+      continue;
+    }
+
+    layer->destroy_pipeline(MaskOption(net->opt, layer->featmask));
+
+    if (to_int8 &&
+        !QuantizeLayer(layer, table.weight_scales.at(layer->name),
+                       table.bottom_scales.at(layer->name))) {
+      exit(EXIT_FAILURE);
+    }
+
+    if (to_fp32) {
+      layer->featmask |= kFeatmaskFp32;
+    }
+
+    if (layer->create_pipeline(MaskOption(net->opt, layer->featmask)) != 0) {
+      fprintf(stderr, "Failed to create the pipeline of layer %s\n",
+              layer->name.c_str());
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // Weights are not released by create_pipeline() any more, so the
+  // extractors can use the light mode again
+  net->opt.lightmode = true;
+}
+
+// Decode a wave with greedy search and return the text
+std::string DecodeWave(sherpa_ncnn::Model *model,
+                       const sherpa_ncnn::SymbolTable &sym_table,
+                       const Wave &w) {
+  sherpa_ncnn::FeatureExtractorConfig feat_config;
+  sherpa_ncnn::FeatureExtractor feature_extractor(feat_config);
+  feature_extractor.AcceptWaveform(w.sample_rate, w.samples.data(),
+                                   w.samples.size());
+
+  std::vector<float> tail_paddings(static_cast<int32_t>(0.3 * w.sample_rate));
+  feature_extractor.AcceptWaveform(w.sample_rate, tail_paddings.data(),
+                                   tail_paddings.size());
+  feature_extractor.InputFinished();
+
+  sherpa_ncnn::GreedySearchDecoder decoder(model);
+  sherpa_ncnn::DecoderResult result = decoder.GetEmptyResult();
+  std::vector<ncnn::Mat> states = model->GetEncoderInitStates();
+
+  int32_t segment = model->Segment();
+  int32_t offset = model->Offset();
+
+  int32_t num_processed = 0;
+  while (feature_extractor.NumFramesReady() - num_processed >= segment) {
+    ncnn::Mat features = feature_extractor.GetFrames(num_processed, segment);
+    num_processed += offset;
+
+    ncnn::Mat encoder_out;
+    std::tie(encoder_out, states) = model->RunEncoder(features, states);
+    decoder.Decode(encoder_out, &result);
+  }
+
+  decoder.StripLeadingBlanks(&result);
+
+  std::string text;
+  for (auto i : result.tokens) {
+    text.append(sym_table[i]);
+  }
+
+  return text;
+}
+
+// Build a model from config with the given plan and decode all waves.
+// If plan is null, the model is used as it is.
+std::vector<std::string> Evaluate(sherpa_ncnn::ModelConfig config,
+                                  const Plan *plan,
+                                  const ScaleTable &encoder_table,
+                                  const ScaleTable &joiner_table,
+                                  const sherpa_ncnn::SymbolTable &sym_table,
+                                  const std::vector<Wave> &waves,
+                                  double *elapsed_seconds) {
+  if (plan) {
+    config.encoder_opt.lightmode = false;
+    config.joiner_opt.lightmode = false;
+  }
+
+  auto model = sherpa_ncnn::Model::Create(config);
+  if (!model) {
+    fprintf(stderr, "Failed to load the model\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (plan) {
+    ApplyPlan(plan->encoder_int8, plan->encoder_fp32, encoder_table,
+              &model->GetEncoder());
+    ApplyPlan(plan->joiner_int8, plan->joiner_fp32, joiner_table,
+              &model->GetJoiner());
+  }
+
+  // warm up
+  DecodeWave(model.get(), sym_table, waves[0]);
+
+  std::vector<std::string> hyps;
+
+  auto begin = std::chrono::steady_clock::now();
+  for (const auto &w : waves) {
+    hyps.push_back(DecodeWave(model.get(), sym_table, w));
+  }
+  *elapsed_seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - begin)
+                         .count();
+
+  return hyps;
+}
+
+// Write a copy of a param file in which the given layers have
+// featmask bits set
+bool WriteParam(const std::string &in_filename,
+                const std::string &out_filename,
+                const std::set<std::string> &fp32_layers) {
+  std::ifstream is(in_filename);
+  if (!is) {
+    fprintf(stderr, "Failed to open %s\n", in_filename.c_str());
+    return false;
+  }
+
+  std::ofstream os(out_filename);
+  if (!os) {
+    fprintf(stderr, "Failed to create %s\n", out_filename.c_str());
+    return false;
+  }
+
+  std::string line;
+  int32_t line_number = 0;
+  while (std::getline(is, line)) {
+    ++line_number;
+
+    // The first two lines are the magic number and the counts
+    std::istringstream iss(line);
+    std::string type, name;
+    iss >> type >> name;
+    if (line_number <= 2 || !fp32_layers.count(name)) {
+      os << line << "\n";
+      continue;
+    }
+
+    std::ostringstream layer;
+    layer << type << " " << name;
+
+    int32_t featmask = kFeatmaskFp32;
+    std::string field;
+    while (iss >> field) {
+      if (field.compare(0, 3, "31=") == 0) {
+        featmask |= atoi(field.c_str() + 3);
+        continue;
+      }
+      layer << " " << field;
+    }
+    layer << " 31=" << featmask;
+
+    os << layer.str() << "\n";
+  }
+
+  return static_cast<bool>(os);
+}
+
+bool WriteScaleTable(const std::string &filename, const ScaleTable &table,
+                     const std::set<std::string> &layers) {
+  FILE *fp = fopen(filename.c_str(), "wb");
+  if (!fp) {
+    fprintf(stderr, "fopen %s failed\n", filename.c_str());
+    return false;
+  }
+
+  // Same format and order as generate-int8-scale-table
+  for (const auto &kv : table.weight_scales) {
+    if (!layers.count(kv.first)) {
+      continue;
+    }
+
+    fprintf(fp, "%s_param_0 ", kv.first.c_str());
+    for (auto s : kv.second) {
+      fprintf(fp, "%f ", s);
+    }
+    fprintf(fp, "\n");
+  }
+
+  for (const auto &kv : table.bottom_scales) {
+    if (!layers.count(kv.first)) {
+      continue;
+    }
+
+    fprintf(fp, "%s %f \n", kv.first.c_str(), kv.second);
+  }
+
+  fclose(fp);
+
+  return true;
+}
+
+}  // namespace
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Find which layers of the encoder and the joiner to keep in floating point
+so that the int8 model stays within a WER or speed budget.
+
+Candidates keep the 0, 1, 2, 4, 8, ... most sensitive layers of the
+sensitivity report in floating point and quantize all other layers of
+the scale tables to int8. Each candidate is decoded on the given wave
+files, then the boundary of --max-wer-increase is refined by bisection.
+The fastest candidate within the budget is selected.
+
+Usage:
+
+./bin/search-mixed-precision \
+  --tokens=/path/to/tokens.txt \
+  --encoder-param=/path/to/encoder.ncnn.param \
+  --encoder-bin=/path/to/encoder.ncnn.bin \
+  --decoder-param=/path/to/decoder.ncnn.param \
+  --decoder-bin=/path/to/decoder.ncnn.bin \
+  --joiner-param=/path/to/joiner.ncnn.param \
+  --joiner-bin=/path/to/joiner.ncnn.bin \
+  --encoder-scale-table=/path/to/encoder-scale-table.txt \
+  --joiner-scale-table=/path/to/joiner-scale-table.txt \
+  --sensitivity-report=/path/to/sensitivity.txt \
+  --transcripts=/path/to/text \
+  --max-wer-increase=0.5 \
+  --output-dir=./mixed \
+  wave_filenames.txt
+
+The model files must be fp32 models. The scale tables and the
+sensitivity report are generated by generate-int8-scale-table.
+
+The following files are written to --output-dir:
+
+  - candidates.json: WER and real time factor of each candidate
+  - precision.txt: precision of each quantizable layer of the selection
+  - encoder-scale-table.txt, joiner-scale-table.txt: the scale tables
+    with the int8 layers of the selection only
+  - encoder.ncnn.param, joiner.ncnn.param: the given param files with
+    31=3 (no fp16 storage and arithmetic) set on layers kept in fp32
+
+The reference is the float model, i.e., the given model run with
+--float-precision. Candidates are run with the same precision, so the
+WER increase is caused by the int8 layers only.
+
+Note: The written files are not models yet and sherpa-ncnn cannot load
+them. You have to run ncnn2int8 with the written param files and scale
+tables to get the final int8 models, e.g.,
+
+  ncnn2int8 mixed/encoder.ncnn.param encoder.ncnn.bin \
+    mixed/encoder.ncnn.int8.param mixed/encoder.ncnn.int8.bin \
+    mixed/encoder-scale-table.txt
+
+  ncnn2int8 mixed/joiner.ncnn.param joiner.ncnn.bin \
+    mixed/joiner.ncnn.int8.param mixed/joiner.ncnn.int8.bin \
+    mixed/joiner-scale-table.txt
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::ModelConfig config;
+  std::string encoder_scale_table;
+  std::string joiner_scale_table;
+  std::string sensitivity_report;
+  std::string transcripts;
+  std::string output_dir;
+  std::string float_precision = "fp16";
+  float max_wer_increase = 0.5;
+  float max_rtf = 0;
+  int32_t num_threads = 1;
+
+  po.Register("tokens", &config.tokens, "Path to tokens.txt");
+  po.Register("encoder-param", &config.encoder_param,
+              "Path to the fp32 encoder.ncnn.param");
+  po.Register("encoder-bin", &config.encoder_bin,
+              "Path to the fp32 encoder.ncnn.bin");
+  po.Register("decoder-param", &config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &config.decoder_bin, "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &config.joiner_param,
+              "Path to the fp32 joiner.ncnn.param");
+  po.Register("joiner-bin", &config.joiner_bin,
+              "Path to the fp32 joiner.ncnn.bin");
+  po.Register("encoder-scale-table", &encoder_scale_table,
+              "Encoder scale table from generate-int8-scale-table");
+  po.Register("joiner-scale-table", &joiner_scale_table,
+              "Joiner scale table from generate-int8-scale-table");
+  po.Register("sensitivity-report", &sensitivity_report,
+              "Sensitivity report from generate-int8-scale-table");
+  po.Register("transcripts", &transcripts,
+              "Optional. A file in the format of kaldi's text file. If "
+              "empty, WER is computed against the float model");
+  po.Register("max-wer-increase", &max_wer_increase,
+              "Largest allowed increase of WER in percent over the float "
+              "model. Negative to disable");
+  po.Register("max-rtf", &max_rtf,
+              "Largest allowed real time factor. 0 to disable");
+  po.Register("float-precision", &float_precision,
+              "Precision of layers that are not quantized: fp16 or fp32");
+  po.Register("num-threads", &num_threads, "Number of threads for ncnn");
+  po.Register("output-dir", &output_dir, "Directory for the results");
+
+  po.Read(argc, argv);
+
+  if (po.NumArgs() != 1 || output_dir.empty() || encoder_scale_table.empty() ||
+      joiner_scale_table.empty() || sensitivity_report.empty()) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (float_precision != "fp16" && float_precision != "fp32") {
+    fprintf(stderr, "--float-precision must be fp16 or fp32. Given: %s\n",
+            float_precision.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  ScaleTable encoder_table;
+  ScaleTable joiner_table;
+  if (!ReadScaleTable(encoder_scale_table, &encoder_table) ||
+      !ReadScaleTable(joiner_scale_table, &joiner_table)) {
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<QuantLayer> layers =
+      SortLayers(sensitivity_report, encoder_table, joiner_table);
+  const int32_t num_layers = static_cast<int32_t>(layers.size());
+  if (layers.empty()) {
+    fprintf(stderr, "No layers can be quantized\n");
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<Wave> waves;
+  {
+    std::ifstream is(po.GetArg(1));
+    std::string filename;
+    while (std::getline(is, filename)) {
+      if (filename.empty()) {
+        continue;
+      }
+
+      Wave w;
+      w.filename = filename;
+
+      bool is_ok = false;
+      w.samples = sherpa_ncnn::ReadWave(filename, &w.sample_rate, &is_ok);
+      if (!is_ok) {
+        fprintf(stderr, "Failed to read %s\n", filename.c_str());
+        exit(EXIT_FAILURE);
+      }
+      waves.push_back(std::move(w));
+    }
+  }
+
+  if (waves.empty()) {
+    fprintf(stderr, "No wave files are given in %s\n", po.GetArg(1).c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  double total_audio_seconds = 0;
+  for (const auto &w : waves) {
+    total_audio_seconds +=
+        w.samples.size() / static_cast<double>(w.sample_rate);
+  }
+
+  std::vector<std::string> truths;
+  if (!transcripts.empty()) {
+    std::map<std::string, std::string> texts;
+    if (!sherpa_ncnn::ReadTranscripts(transcripts, &texts)) {
+      fprintf(stderr, "Failed to open %s\n", transcripts.c_str());
+      exit(EXIT_FAILURE);
+    }
+
+    for (const auto &w : waves) {
+      std::string utt = std::filesystem::path(w.filename).stem().string();
+      auto it = texts.find(utt);
+      if (it == texts.end()) {
+        fprintf(stderr, "No transcript for %s in %s\n", utt.c_str(),
+                transcripts.c_str());
+        exit(EXIT_FAILURE);
+      }
+      truths.push_back(it->second);
+    }
+  }
+
+  sherpa_ncnn::SymbolTable sym_table(config.tokens);
+
+  bool fp32 = float_precision == "fp32";
+
+  // The reference and the candidates use the same options, so that the
+  // WER increase is caused by int8 layers only. With --float-precision=fp16,
+  // fp16 is used where the hardware supports it.
+  ncnn::Option opt;
+  opt.num_threads = num_threads;
+  opt.use_int8_inference = true;
+  opt.use_fp16_packed = !fp32;
+  opt.use_fp16_storage = !fp32;
+  opt.use_fp16_arithmetic = !fp32;
+  config.encoder_opt = opt;
+  config.decoder_opt = opt;
+  config.joiner_opt = opt;
+
+  fprintf(stderr, "Decoding %d files with the %s model\n",
+          static_cast<int32_t>(waves.size()), float_precision.c_str());
+
+  double reference_seconds = 0;
+  std::vector<std::string> refs =
+      Evaluate(config, nullptr, encoder_table, joiner_table, sym_table, waves,
+               &reference_seconds);
+  double reference_wer =
+      truths.empty() ? 0 : sherpa_ncnn::ComputeWer(truths, refs);
+
+  std::map<int32_t, Candidate> candidates;
+  auto evaluate = [&](int32_t num_float_layers) -> const Candidate & {
+    auto it = candidates.find(num_float_layers);
+    if (it != candidates.end()) {
+      return it->second;
+    }
+
+    Plan plan = MakePlan(layers, num_float_layers, fp32);
+
+    Candidate c;
+    c.num_float_layers = num_float_layers;
+
+    auto hyps = Evaluate(config, &plan, encoder_table, joiner_table,
+                         sym_table, waves, &c.elapsed_seconds);
+    c.rtf = c.elapsed_seconds / total_audio_seconds;
+    c.wer_vs_reference = sherpa_ncnn::ComputeWer(refs, hyps);
+    c.wer = truths.empty() ? c.wer_vs_reference
+                           : sherpa_ncnn::ComputeWer(truths, hyps);
+
+    fprintf(stderr,
+            "float layers: %d/%d, WER: %.3f, WER vs %s: %.3f, RTF: %.4f\n",
+            num_float_layers, num_layers, c.wer, float_precision.c_str(),
+            c.wer_vs_reference, c.rtf);
+
+    return candidates[num_float_layers] = c;
+  };
+
+  auto within_wer = [&](const Candidate &c) {
+    return max_wer_increase < 0 || c.wer - reference_wer <= max_wer_increase;
+  };
+
+  auto within_rtf = [&](const Candidate &c) {
+    return max_rtf <= 0 || c.rtf <= max_rtf;
+  };
+
+  for (int32_t k = 0; k < num_layers; k = std::max(1, 2 * k)) {
+    evaluate(k);
+  }
+  evaluate(num_layers);
+
+  // Keeping more layers in floating point does not make the WER worse,
+  // so bisect between the largest failing and the smallest passing
+  // number of float layers
+  if (max_wer_increase >= 0) {
+    int32_t hi = -1;
+    int32_t lo = -1;
+    for (const auto &kv : candidates) {
+      if (within_wer(kv.second)) {
+        hi = kv.first;
+        break;
+      }
+      lo = kv.first;
+    }
+
+    while (hi != -1 && lo != -1 && hi - lo > 1) {
+      int32_t mid = lo + (hi - lo) / 2;
+      if (within_wer(evaluate(mid))) {
+        hi = mid;
+      } else {
+        lo = mid;
+      }
+    }
+  }
+
+  // The fastest candidate within the budget. If there is none, the most
+  // accurate one.
+  const Candidate *best = nullptr;
+  for (const auto &kv : candidates) {
+    const Candidate &c = kv.second;
+    if (within_wer(c) && within_rtf(c) && (!best || c.rtf < best->rtf)) {
+      best = &c;
+    }
+  }
+
+  if (!best) {
+    fprintf(stderr,
+            "No candidate is within the budget. Select the most accurate "
+            "one\n");
+    for (const auto &kv : candidates) {
+      const Candidate &c = kv.second;
+      if (!best || c.wer < best->wer ||
+          (c.wer == best->wer && c.rtf < best->rtf)) {
+        best = &c;
+      }
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(output_dir, ec);
+  if (ec) {
+    fprintf(stderr, "Failed to create %s\n", output_dir.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  std::ostringstream os;
+  os << "{\n";
+  os << "  \"num_files\": " << waves.size() << ",\n";
+  os << "  \"audio_seconds\": " << total_audio_seconds << ",\n";
+  os << "  \"num_threads\": " << num_threads << ",\n";
+  os << "  \"float_precision\": \"" << float_precision << "\",\n";
+  os << "  \"num_quantizable_layers\": " << num_layers << ",\n";
+  os << "  \"reference\": {\"wer\": " << reference_wer
+     << ", \"rtf\": " << reference_seconds / total_audio_seconds << "},\n";
+  os << "  \"candidates\": [\n";
+  for (auto it = candidates.begin(); it != candidates.end(); ++it) {
+    const Candidate &c = it->second;
+    os << "    {\"num_float_layers\": " << c.num_float_layers
+       << ", \"wer\": " << c.wer
+       << ", \"wer_vs_reference\": " << c.wer_vs_reference
+       << ", \"rtf\": " << c.rtf << ", \"elapsed_seconds\": "
+       << c.elapsed_seconds << ", \"within_budget\": "
+       << (within_wer(c) && within_rtf(c) ? "true" : "false") << "}"
+       << (std::next(it) != candidates.end() ? "," : "") << "\n";
+  }
+  os << "  ],\n";
+  os << "  \"selected\": " << best->num_float_layers << "\n";
+  os << "}\n";
+
+  std::ofstream(output_dir + "/candidates.json") << os.str();
+
+  Plan plan = MakePlan(layers, best->num_float_layers, fp32);
+
+  {
+    std::ofstream precision(output_dir + "/precision.txt");
+    for (int32_t i = 0; i != num_layers; ++i) {
+      const std::string &p =
+          i >= best->num_float_layers ? std::string("int8") : float_precision;
+      precision << layers[i].model << " " << layers[i].name << " " << p
+                << "\n";
+    }
+  }
+
+  if (!WriteScaleTable(output_dir + "/encoder-scale-table.txt", encoder_table,
+                       plan.encoder_int8) ||
+      !WriteScaleTable(output_dir + "/joiner-scale-table.txt", joiner_table,
+                       plan.joiner_int8) ||
+      !WriteParam(config.encoder_param, output_dir + "/encoder.ncnn.param",
+                  plan.encoder_fp32) ||
+      !WriteParam(config.joiner_param, output_dir + "/joiner.ncnn.param",
+                  plan.joiner_fp32)) {
+    exit(EXIT_FAILURE);
+  }
+
+  fprintf(stderr,
+          "Selected: %d of %d layers in %s, WER: %.3f (%s: %.3f), RTF: "
+          "%.4f\n",
+          best->num_float_layers, num_layers, float_precision.c_str(),
+          best->wer, float_precision.c_str(), reference_wer, best->rtf);
+
+  return 0;
+}
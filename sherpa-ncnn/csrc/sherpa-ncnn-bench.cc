@@ -0,0 +1,756 @@
+// sherpa-ncnn/csrc/sherpa-ncnn-bench.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <filesystem>  // NOLINT
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/execution-profile.h"
+#include "sherpa-ncnn/csrc/parse-options.h"
+#include "sherpa-ncnn/csrc/recognizer.h"
+#include "sherpa-ncnn/csrc/wave-reader.h"
+#include "sherpa-ncnn/csrc/wer.h"
+
+namespace {
+
+struct Wave {
+  std::string filename;
+  int32_t sample_rate = 0;
+  std::vector<float> samples;
+};
+
+// A simulated client that sends the waves assigned to it one after
+// another, chunk by chunk
+struct SimulatedStream {
+  std::vector<const Wave *> waves;
+  int32_t wave_index = 0;
+
+  std::unique_ptr<sherpa_ncnn::Stream> stream;
+
+  // Number of samples of the current wave sent so far
+  int32_t num_sent = 0;
+
+  // When the first chunk of the current wave is due, in seconds since
+  // the benchmark started
+  double start_time = 0;
+
+  // (number of samples sent, time) after each chunk
+  std::vector<std::pair<int32_t, double>> send_log;
+
+  bool got_first_token = false;
+  bool input_finished = false;
+  double input_finished_time = 0;
+  bool done = false;
+};
+
+// Statistics of one run of the simulated streams. Latencies are in
+// milliseconds.
+struct RunStats {
+  double audio_seconds = 0;
+  double wall_seconds = 0;
+  double cpu_seconds = 0;
+
+  // Time spent in each call of DecodeStream()
+  std::vector<double> chunk_latencies;
+
+  // Time from when the audio needed by a call of DecodeStream() was sent
+  // to when the call returns. Unlike chunk_latencies, it includes the
+  // time the chunk waits for other streams to be decoded.
+  std::vector<double> chunk_delays;
+
+  std::vector<double> first_token_latencies;
+  std::vector<double> final_latencies;
+};
+
+// JSON has no inf or nan, so they are written as null
+std::string JsonNumber(double x) {
+  if (!std::isfinite(x)) {
+    return "null";
+  }
+
+  std::ostringstream os;
+  os << x;
+  return os.str();
+}
+
+// Nearest-rank percentile of a sorted list. It returns 0 if the list
+// is empty.
+double Percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+
+  int32_t k = static_cast<int32_t>(std::ceil(p / 100 * sorted.size())) - 1;
+  return sorted[std::max(k, 0)];
+}
+
+// Summary of a list of latencies in milliseconds
+std::string Summarize(std::vector<double> v) {
+  std::ostringstream os;
+  os << "{\"count\": " << v.size();
+  if (!v.empty()) {
+    std::sort(v.begin(), v.end());
+
+    double sum = 0;
+    for (auto d : v) {
+      sum += d;
+    }
+
+    os << ", \"mean\": " << JsonNumber(sum / v.size());
+    os << ", \"p50\": " << JsonNumber(Percentile(v, 50));
+    os << ", \"p95\": " << JsonNumber(Percentile(v, 95));
+    os << ", \"p99\": " << JsonNumber(Percentile(v, 99));
+    os << ", \"max\": " << JsonNumber(v.back());
+  }
+  os << "}";
+  return os.str();
+}
+
+// Return peak resident set size in MB, or -1 if it is not available
+double PeakRssMB() {
+#if defined(_WIN32)
+  return -1;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return -1;
+  }
+#if defined(__APPLE__)
+  return usage.ru_maxrss / 1024.0 / 1024.0;  // bytes
+#else
+  return usage.ru_maxrss / 1024.0;  // kilobytes
+#endif
+#endif
+}
+
+// Return processor time used by this process in seconds
+double CpuSeconds() {
+#if defined(_WIN32)
+  return -1;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return -1;
+  }
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#endif
+}
+
+// Escape a string for use in a JSON string literal
+std::string Escape(const std::string &s) {
+  std::ostringstream os;
+  for (char c : s) {
+    switch (c) {
+      case '"':
+        os << "\\\"";
+        break;
+      case '\\':
+        os << "\\\\";
+        break;
+      case '\b':
+        os << "\\b";
+        break;
+      case '\f':
+        os << "\\f";
+        break;
+      case '\n':
+        os << "\\n";
+        break;
+      case '\r':
+        os << "\\r";
+        break;
+      case '\t':
+        os << "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          os << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+             << static_cast<int32_t>(c) << std::dec;
+        } else {
+          os << c;
+        }
+    }
+  }
+  return os.str();
+}
+
+// Expand directories into the .wav files inside them
+std::vector<std::string> ListWaves(const std::vector<std::string> &args) {
+  std::vector<std::string> ans;
+  for (const auto &a : args) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(a, ec)) {
+      ans.push_back(a);
+      continue;
+    }
+
+    std::vector<std::string> files;
+    for (const auto &entry : std::filesystem::directory_iterator(a, ec)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".wav") {
+        files.push_back(entry.path().string());
+      }
+    }
+    std::sort(files.begin(), files.end());
+    ans.insert(ans.end(), files.begin(), files.end());
+  }
+  return ans;
+}
+
+// Decode a wave with a single stream and return the text
+std::string DecodeWave(const sherpa_ncnn::Recognizer &recognizer,
+                       const Wave &w) {
+  auto s = recognizer.CreateStream();
+  s->AcceptWaveform(w.sample_rate, w.samples.data(), w.samples.size());
+  s->InputFinished();
+  recognizer.FinalizeStream(s.get());
+
+  return recognizer.GetResult(s.get()).text;
+}
+
+// Return when the sample at sample_index was sent. send_log contains
+// (number of samples sent, time) after each chunk.
+double SentTime(const std::vector<std::pair<int32_t, double>> &send_log,
+                int32_t sample_index) {
+  auto it = std::upper_bound(
+      send_log.begin(), send_log.end(), sample_index,
+      [](int32_t k, const std::pair<int32_t, double> &p) {
+        return k < p.first;
+      });
+  return it == send_log.end() ? send_log.back().second : it->second;
+}
+
+// Return the number of seconds of audio a new stream needs before
+// recognizer.IsReady() returns true for it. The n-th frame after it
+// makes the stream ready again if n frames have been processed.
+double SecondsUntilReady(const sherpa_ncnn::Recognizer &recognizer,
+                         int32_t sample_rate) {
+  auto s = recognizer.CreateStream();
+
+  // 1 ms at a time
+  int32_t n = sample_rate / 1000;
+  std::vector<float> samples(n);
+
+  int32_t num_samples = 0;
+  while (!recognizer.IsReady(s.get())) {
+    s->AcceptWaveform(sample_rate, samples.data(), n);
+    s->WaitForFeatures();
+    num_samples += n;
+  }
+
+  return num_samples / static_cast<double>(sample_rate);
+}
+
+// Send the waves with num_streams simulated streams and decode them
+//
+// @param ready_seconds  Returned by SecondsUntilReady()
+// @param frame_shift_ms Frame shift of the features
+RunStats RunStreams(const sherpa_ncnn::Recognizer &recognizer,
+                    const std::vector<Wave> &waves, int32_t num_streams,
+                    int32_t chunk_ms, bool real_time, double ready_seconds,
+                    float frame_shift_ms) {
+  RunStats stats;
+
+  // Waves are assigned to streams in a round-robin fashion. If there are
+  // fewer waves than streams, a wave is used by several streams.
+  int32_t num_waves = static_cast<int32_t>(waves.size());
+  std::vector<SimulatedStream> streams(num_streams);
+  for (int32_t i = 0; i < std::max(num_waves, num_streams); ++i) {
+    streams[i % num_streams].waves.push_back(&waves[i % num_waves]);
+  }
+
+  for (const auto &s : streams) {
+    for (const auto *w : s.waves) {
+      stats.audio_seconds +=
+          w->samples.size() / static_cast<double>(w->sample_rate);
+    }
+  }
+
+  auto begin = std::chrono::steady_clock::now();
+  auto elapsed = [&begin]() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         begin)
+        .count();
+  };
+
+  double cpu_begin = CpuSeconds();
+
+  for (int32_t i = 0; i != num_streams; ++i) {
+    // Spread the streams over a chunk so that their chunks do not arrive
+    // at the same time
+    streams[i].start_time =
+        real_time ? i * chunk_ms / 1000.0 / num_streams : 0;
+    streams[i].stream = recognizer.CreateStream();
+  }
+
+  int32_t num_done = 0;
+  while (num_done < num_streams) {
+    bool busy = false;
+
+    for (auto &s : streams) {
+      if (s.done) {
+        continue;
+      }
+
+      const Wave &w = *s.waves[s.wave_index];
+      int32_t num_samples = static_cast<int32_t>(w.samples.size());
+      int32_t chunk_size = w.sample_rate * chunk_ms / 1000;
+
+      // Send chunks that are due
+      double now = elapsed();
+      while (!s.input_finished && now >= s.start_time) {
+        int32_t num_due = num_samples;
+        if (real_time) {
+          int32_t num_chunks =
+              static_cast<int32_t>((now - s.start_time) * 1000 / chunk_ms) + 1;
+          num_due = std::min<int64_t>(
+              static_cast<int64_t>(num_chunks) * chunk_size, num_samples);
+        }
+
+        if (s.num_sent >= num_due) {
+          break;
+        }
+
+        int32_t n = std::min(chunk_size, num_samples - s.num_sent);
+        s.stream->AcceptWaveform(w.sample_rate, w.samples.data() + s.num_sent,
+                                 n);
+        s.num_sent += n;
+        s.send_log.emplace_back(s.num_sent, elapsed());
+
+        if (s.num_sent == num_samples) {
+          s.stream->InputFinished();
+          s.input_finished = true;
+          s.input_finished_time = elapsed();
+        }
+
+        if (!real_time) {
+          // one chunk per stream at a time, so that streams are interleaved
+          break;
+        }
+      }
+
+      while (recognizer.IsReady(s.stream.get())) {
+        busy = true;
+
+        int32_t num_processed = s.stream->GetNumProcessedFrames();
+
+        double start = elapsed();
+        recognizer.DecodeStream(s.stream.get());
+        double stop = elapsed();
+        stats.chunk_latencies.push_back((stop - start) * 1000);
+
+        // The last sample needed by this call. After InputFinished(), it
+        // may be past the end of the wave.
+        double needed_seconds =
+            ready_seconds + num_processed * frame_shift_ms / 1000;
+        int32_t needed_index =
+            static_cast<int32_t>(std::ceil(needed_seconds * w.sample_rate)) - 1;
+        needed_index = std::min(needed_index, num_samples - 1);
+        stats.chunk_delays.push_back(
+            (stop - SentTime(s.send_log, needed_index)) * 1000);
+
+        if (s.got_first_token) {
+          continue;
+        }
+
+        auto result = recognizer.GetResult(s.stream.get());
+        if (result.tokens.empty()) {
+          continue;
+        }
+
+        s.got_first_token = true;
+
+        // Find when the audio of the first token was sent
+        int32_t sample_index =
+            result.timestamps.empty()
+                ? 0
+                : static_cast<int32_t>(result.timestamps[0] * w.sample_rate);
+        stats.first_token_latencies.push_back(
+            (stop - SentTime(s.send_log, sample_index)) * 1000);
+      }
+
+      if (s.input_finished && !recognizer.IsReady(s.stream.get())) {
+        // With --feature-threads, the last frames may not be computed yet
+        s.stream->WaitForFeatures();
+        if (recognizer.IsReady(s.stream.get())) {
+          continue;
+        }
+
+        // Decode the last partial chunk without tail padding
+        recognizer.FinalizeStream(s.stream.get());
+        recognizer.GetResult(s.stream.get());
+        stats.final_latencies.push_back(
+            (elapsed() - s.input_finished_time) * 1000);
+
+        s.wave_index += 1;
+        if (s.wave_index == static_cast<int32_t>(s.waves.size())) {
+          s.done = true;
+          s.stream.reset();
+          ++num_done;
+          continue;
+        }
+
+        s.stream = recognizer.CreateStream();
+        s.num_sent = 0;
+        s.start_time = real_time ? elapsed() : 0;
+        s.send_log.clear();
+        s.got_first_token = false;
+        s.input_finished = false;
+      }
+    }
+
+    if (real_time && !busy) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  stats.wall_seconds = elapsed();
+  stats.cpu_seconds = CpuSeconds() - cpu_begin;
+
+  return stats;
+}
+
+// Return the largest number of streams, up to max_streams, that are
+// decoded in real time, i.e., the p95 chunk delay does not exceed
+// chunk_ms. It returns 0 if even a single stream is not.
+int32_t FindMaxStreams(const sherpa_ncnn::Recognizer &recognizer,
+                       const std::vector<Wave> &waves, int32_t chunk_ms,
+                       double ready_seconds, float frame_shift_ms,
+                       int32_t max_streams) {
+  auto is_sustainable = [&](int32_t num_streams) {
+    RunStats stats = RunStreams(recognizer, waves, num_streams, chunk_ms,
+                                /*real_time*/ true, ready_seconds,
+                                frame_shift_ms);
+    std::sort(stats.chunk_delays.begin(), stats.chunk_delays.end());
+    double p95 = Percentile(stats.chunk_delays, 95);
+    fprintf(stderr, "%d streams: p95 chunk delay %.1f ms\n", num_streams,
+            p95);
+    return p95 <= chunk_ms;
+  };
+
+  if (!is_sustainable(1)) {
+    return 0;
+  }
+
+  // Double the number of streams until it is too many, then bisect
+  int32_t good = 1;
+  int32_t bad = 0;
+  while (good < max_streams) {
+    int32_t n = std::min(2 * good, max_streams);
+    if (!is_sustainable(n)) {
+      bad = n;
+      break;
+    }
+    good = n;
+  }
+
+  while (bad != 0 && bad - good > 1) {
+    int32_t n = good + (bad - good) / 2;
+    if (is_sustainable(n)) {
+      good = n;
+    } else {
+      bad = n;
+    }
+  }
+
+  return good;
+}
+
+}  // namespace
+
+int32_t main(int32_t argc, char *argv[]) {
+  const char *kUsageMessage = R"usage(
+Benchmark streaming speech recognition with sherpa-ncnn.
+
+The given wave files are sent by --num-streams simulated clients at the
+same time. Each client sends its waves one after another in chunks of
+--chunk-ms milliseconds. With --real-time=true, chunks are sent at the
+speed they are recorded; otherwise they are sent as fast as possible.
+
+Results are printed in JSON format. chunk_latency_ms is the time spent
+in decoding a chunk. chunk_delay_ms also includes the time the chunk
+waits for the chunks of other streams to be decoded.
+
+With --max-streams, the waves are decoded again in real time with an
+increasing number of streams, until the p95 chunk delay exceeds
+--chunk-ms. The largest number of streams that does not, divided by
+--num-threads plus --feature-threads, is reported as the maximum number
+of streams per core.
+
+With --reference-profile, each wave is also decoded with that execution
+profile, e.g., accurate, and the WER of the results of --execution-profile
+against it is reported. With --transcripts, the WER of both profiles
+against the transcripts and their difference are reported, too.
+
+Usage:
+
+./bin/sherpa-ncnn-bench \
+  --tokens=/path/to/tokens.txt \
+  --encoder-param=/path/to/encoder.ncnn.param \
+  --encoder-bin=/path/to/encoder.ncnn.bin \
+  --decoder-param=/path/to/decoder.ncnn.param \
+  --decoder-bin=/path/to/decoder.ncnn.bin \
+  --joiner-param=/path/to/joiner.ncnn.param \
+  --joiner-bin=/path/to/joiner.ncnn.bin \
+  --num-threads=1 \
+  --num-streams=4 \
+  /path/to/foo.wav /path/to/dir-containing-wave-files
+
+Please refer to
+https://k2-fsa.github.io/sherpa/ncnn/pretrained_models/index.html
+for a list of pre-trained models to download.
+)usage";
+
+  sherpa_ncnn::ParseOptions po(kUsageMessage);
+
+  sherpa_ncnn::RecognizerConfig config;
+  int32_t num_threads = 1;
+  int32_t num_streams = 1;
+  int32_t chunk_ms = 100;
+  bool real_time = true;
+  std::string output_json;
+  std::string reference_profile;
+  std::string transcripts;
+  int32_t max_streams = 0;
+
+  po.Register("tokens", &config.model_config.tokens, "Path to tokens.txt");
+  po.Register("encoder-param", &config.model_config.encoder_param,
+              "Path to encoder.ncnn.param");
+  po.Register("encoder-bin", &config.model_config.encoder_bin,
+              "Path to encoder.ncnn.bin");
+  po.Register("decoder-param", &config.model_config.decoder_param,
+              "Path to decoder.ncnn.param");
+  po.Register("decoder-bin", &config.model_config.decoder_bin,
+              "Path to decoder.ncnn.bin");
+  po.Register("joiner-param", &config.model_config.joiner_param,
+              "Path to joiner.ncnn.param");
+  po.Register("joiner-bin", &config.model_config.joiner_bin,
+              "Path to joiner.ncnn.bin");
+  po.Register("num-threads", &num_threads,
+              "Number of threads for running the neural networks");
+  po.Register("decoding-method", &config.decoder_config.method,
+              "greedy_search or modified_beam_search");
+  po.Register("num-active-paths", &config.decoder_config.num_active_paths,
+              "Used only for modified_beam_search");
+  po.Register("hotwords-file", &config.hotwords_file,
+              "Optional. Used only for modified_beam_search");
+  po.Register("hotwords-score", &config.hotwords_score,
+              "Boosting score for hotwords");
+  po.Register("feature-threads", &config.feature_threads,
+              "If positive, compute features on this many threads in "
+              "parallel with decoding");
+  po.Register("num-streams", &num_streams,
+              "Number of streams that are decoded at the same time");
+  po.Register("chunk-ms", &chunk_ms,
+              "Audio is sent in chunks of this many milliseconds");
+  po.Register("real-time", &real_time,
+              "true to send audio at the speed it is recorded. false to send "
+              "it as fast as possible");
+  po.Register("output-json", &output_json,
+              "If not empty, write results to this file instead of stdout");
+  po.Register("execution-profile", &config.model_config.execution_profile,
+              "accurate, balanced or fast. If empty, use the default ncnn "
+              "options");
+  po.Register("reference-profile", &reference_profile,
+              "If not empty, also decode each wave with this execution "
+              "profile and report the WER of the results against it");
+  po.Register("transcripts", &transcripts,
+              "Optional. Path to a file with lines of "
+              "'<wave name without .wav> <transcript>'. Used only with "
+              "--reference-profile");
+  po.Register("max-streams", &max_streams,
+              "If positive, also find the largest number of streams, up to "
+              "this value, that can be decoded in real time, i.e., with a "
+              "p95 chunk delay not exceeding --chunk-ms, and report it "
+              "divided by the number of cores used");
+  po.Register("enable-profiling", &config.model_config.enable_profiling,
+              "true to print the time spent in each layer of the models to "
+              "stderr at the end");
+
+  po.Read(argc, argv);
+
+  if (po.NumArgs() == 0) {
+    po.PrintUsage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (num_streams < 1 || chunk_ms < 1) {
+    fprintf(stderr, "--num-streams and --chunk-ms must be positive\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (!config.Validate()) {
+    fprintf(stderr, "Errors in config!\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if (!sherpa_ncnn::IsValidExecutionProfile(reference_profile)) {
+    fprintf(stderr, "Valid execution profiles are: accurate, balanced, fast\n");
+    exit(EXIT_FAILURE);
+  }
+
+  config.model_config.encoder_opt.num_threads = num_threads;
+  config.model_config.decoder_opt.num_threads = num_threads;
+  config.model_config.joiner_opt.num_threads = num_threads;
+
+  std::vector<std::string> args;
+  for (int32_t i = 1; i <= po.NumArgs(); ++i) {
+    args.push_back(po.GetArg(i));
+  }
+
+  std::vector<Wave> waves;
+  for (const auto &filename : ListWaves(args)) {
+    Wave w;
+    w.filename = filename;
+
+    bool is_ok = false;
+    w.samples = sherpa_ncnn::ReadWave(filename, &w.sample_rate, &is_ok);
+    if (!is_ok) {
+      fprintf(stderr, "Failed to read %s\n", filename.c_str());
+      exit(EXIT_FAILURE);
+    }
+    waves.push_back(std::move(w));
+  }
+
+  if (waves.empty()) {
+    fprintf(stderr, "No wave files are found\n");
+    exit(EXIT_FAILURE);
+  }
+
+  sherpa_ncnn::Recognizer recognizer(config);
+
+  float frame_shift_ms = config.feat_config.frame_shift_ms;
+  double ready_seconds =
+      SecondsUntilReady(recognizer, config.feat_config.sampling_rate);
+
+  RunStats stats = RunStreams(recognizer, waves, num_streams, chunk_ms,
+                              real_time, ready_seconds, frame_shift_ms);
+
+  double rtf = stats.wall_seconds / stats.audio_seconds;
+  double cpu_rtf = stats.cpu_seconds / stats.audio_seconds;
+
+  std::ostringstream os;
+  os << "{\n";
+  os << "  \"decoding_method\": \"" << Escape(config.decoder_config.method)
+     << "\",\n";
+  os << "  \"num_threads\": " << num_threads << ",\n";
+  os << "  \"feature_threads\": " << config.feature_threads << ",\n";
+  os << "  \"num_streams\": " << num_streams << ",\n";
+  os << "  \"num_waves\": " << waves.size() << ",\n";
+  os << "  \"chunk_ms\": " << chunk_ms << ",\n";
+  os << "  \"real_time\": " << (real_time ? "true" : "false") << ",\n";
+  os << "  \"audio_seconds\": " << JsonNumber(stats.audio_seconds) << ",\n";
+  os << "  \"wall_seconds\": " << JsonNumber(stats.wall_seconds) << ",\n";
+  os << "  \"cpu_seconds\": " << JsonNumber(stats.cpu_seconds) << ",\n";
+  os << "  \"rtf\": " << JsonNumber(rtf) << ",\n";
+  os << "  \"cpu_rtf\": " << JsonNumber(cpu_rtf) << ",\n";
+  os << "  \"peak_rss_mb\": " << JsonNumber(PeakRssMB()) << ",\n";
+  os << "  \"chunk_latency_ms\": " << Summarize(stats.chunk_latencies)
+     << ",\n";
+  os << "  \"chunk_delay_ms\": " << Summarize(stats.chunk_delays) << ",\n";
+  os << "  \"first_token_latency_ms\": "
+     << Summarize(stats.first_token_latencies) << ",\n";
+  os << "  \"final_latency_ms\": " << Summarize(stats.final_latencies);
+
+  // Exclude the decoding below from the report
+  std::string profiling_report = recognizer.GetProfilingReport();
+
+  if (max_streams > 0) {
+    int32_t num_cores = num_threads + std::max(config.feature_threads, 0);
+    int32_t n = FindMaxStreams(recognizer, waves, chunk_ms, ready_seconds,
+                               frame_shift_ms, max_streams);
+
+    os << ",\n";
+    os << "  \"max_sustainable_streams\": " << n << ",\n";
+    os << "  \"max_sustainable_streams_per_core\": "
+       << JsonNumber(static_cast<double>(n) / num_cores);
+  }
+
+  if (!reference_profile.empty()) {
+    // It is run after the benchmark so that it does not affect the
+    // measured time and memory
+    auto reference_config = config;
+    reference_config.model_config.execution_profile = reference_profile;
+    reference_config.model_config.enable_profiling = false;
+    sherpa_ncnn::Recognizer reference_recognizer(reference_config);
+
+    std::vector<std::string> hyps;
+    std::vector<std::string> refs;
+    for (const auto &w : waves) {
+      hyps.push_back(DecodeWave(recognizer, w));
+      refs.push_back(DecodeWave(reference_recognizer, w));
+    }
+
+    os << ",\n";
+    os << "  \"execution_profile\": \""
+       << Escape(config.model_config.execution_profile) << "\",\n";
+    os << "  \"reference_profile\": \"" << Escape(reference_profile)
+       << "\",\n";
+    os << "  \"wer_vs_reference\": "
+       << JsonNumber(sherpa_ncnn::ComputeWer(refs, hyps));
+
+    if (!transcripts.empty()) {
+      std::map<std::string, std::string> texts;
+      if (!sherpa_ncnn::ReadTranscripts(transcripts, &texts)) {
+        fprintf(stderr, "Failed to open %s\n", transcripts.c_str());
+        exit(EXIT_FAILURE);
+      }
+
+      std::vector<std::string> truths;
+      for (const auto &w : waves) {
+        std::string utt = std::filesystem::path(w.filename).stem().string();
+        auto it = texts.find(utt);
+        if (it == texts.end()) {
+          fprintf(stderr, "No transcript for %s in %s\n", utt.c_str(),
+                  transcripts.c_str());
+          exit(EXIT_FAILURE);
+        }
+        truths.push_back(it->second);
+      }
+
+      double wer = sherpa_ncnn::ComputeWer(truths, hyps);
+      double reference_wer = sherpa_ncnn::ComputeWer(truths, refs);
+
+      os << ",\n";
+      os << "  \"wer\": " << JsonNumber(wer) << ",\n";
+      os << "  \"reference_wer\": " << JsonNumber(reference_wer) << ",\n";
+      os << "  \"wer_delta\": " << JsonNumber(wer - reference_wer);
+    }
+  }
+
+  os << "\n}\n";
+
+  if (output_json.empty()) {
+    fprintf(stdout, "%s", os.str().c_str());
+  } else {
+    std::ofstream of(output_json);
+    if (!of) {
+      fprintf(stderr, "Failed to open %s\n", output_json.c_str());
+      exit(EXIT_FAILURE);
+    }
+    of << os.str();
+  }
+
+  if (config.model_config.enable_profiling) {
+    fprintf(stderr, "%s", profiling_report.c_str());
+  }
+
+  return 0;
+}
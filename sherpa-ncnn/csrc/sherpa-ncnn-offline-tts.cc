@@ -44,6 +44,7 @@ or details.
   sherpa_ncnn::ParseOptions po(kUsageMessage);
   std::string output_filename = "./generated.wav";
   int32_t sid = 0;
+  int64_t seed = -1;
 
   po.Register("output-filename", &output_filename,
               "Path to save the generated audio");
@@ -53,6 +54,11 @@ or details.
               "trained using the VCTK dataset. Not used for single-speaker "
               "models, e.g., models trained using the LJSpeech dataset");
 
+  po.Register("seed", &seed,
+              "If non-negative, use it to seed the noise so that the same "
+              "text always produces the same audio. If negative, a random "
+              "seed is used.");
+
   sherpa_ncnn::OfflineTtsConfig config;
 
   config.Register(&po);
@@ -87,6 +93,7 @@ or details.
   sherpa_ncnn::TtsArgs args;
   args.text = po.GetArg(1);
   args.sid = sid;
+  args.seed = seed;
   args.speed = 1.0;
   auto audio = tts.Generate(args, AudioCallback);
   const auto end = std::chrono::steady_clock::now();
@@ -109,5 +109,9 @@ for a list of pre-trained models to download.
   fprintf(stderr, "Real time factor (RTF): %.3f / %.3f = %.3f\n",
           elapsed_seconds, duration, rtf);
 
+  if (config.model_config.enable_profiling) {
+    fprintf(stderr, "\n%s", recognizer.GetProfilingReport().c_str());
+  }
+
   return 0;
 }
@@ -108,14 +108,8 @@ for a list of pre-trained models to download.
   auto stream = recognizer.CreateStream();
   stream->AcceptWaveform(expected_sampling_rate, samples.data(),
                          samples.size());
-  std::vector<float> tail_paddings(
-      static_cast<int>(0.3 * expected_sampling_rate));
-  stream->AcceptWaveform(expected_sampling_rate, tail_paddings.data(),
-                         tail_paddings.size());
-  while (recognizer.IsReady(stream.get())) {
-    recognizer.DecodeStream(stream.get());
-  }
-  stream->Finalize();
+  stream->InputFinished();
+  recognizer.FinalizeStream(stream.get());
   auto result = recognizer.GetResult(stream.get());
   std::cout << "Done!\n";
 
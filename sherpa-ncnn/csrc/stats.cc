@@ -0,0 +1,186 @@
+// sherpa-ncnn/csrc/stats.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace sherpa_ncnn {
+
+const char *StatsStageName(StatsStage stage) {
+  switch (stage) {
+    case StatsStage::kFeature:
+      return "feature";
+    case StatsStage::kEncoder:
+      return "encoder";
+    case StatsStage::kDecoder:
+      return "decoder";
+    case StatsStage::kJoiner:
+      return "joiner";
+    case StatsStage::kSearch:
+      return "search";
+  }
+  return "unknown";
+}
+
+static int32_t BucketIndex(int64_t us) {
+  int32_t i = 0;
+  while (us > 0 && i < kNumStatsBuckets - 1) {
+    us >>= 1;
+    ++i;
+  }
+  return i;
+}
+
+double StageStats::PercentileMs(float p) const {
+  if (count == 0) {
+    return 0;
+  }
+
+  int64_t rank = static_cast<int64_t>(std::ceil(p / 100 * count));
+  rank = std::max<int64_t>(rank, 1);
+
+  int64_t n = 0;
+  for (int32_t i = 0; i != kNumStatsBuckets; ++i) {
+    n += histogram[i];
+    if (n >= rank) {
+      // upper bound of bucket i
+      int64_t us = i == 0 ? 1 : (int64_t(1) << i);
+      return std::min(us, max_us) / 1000.0;
+    }
+  }
+
+  return max_us / 1000.0;
+}
+
+std::string StatsReport::ToString() const {
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(3);
+  for (int32_t i = 0; i != kNumStatsStages; ++i) {
+    const auto &s = stages[i];
+    os << std::setw(8) << StatsStageName(static_cast<StatsStage>(i)) << ": ";
+    os << "count=" << s.count << ", ";
+    os << "total=" << s.total_us / 1000.0 << " ms, ";
+    os << "mean=" << s.MeanMs() << " ms, ";
+    os << "p50<=" << s.PercentileMs(50) << " ms, ";
+    os << "p95<=" << s.PercentileMs(95) << " ms, ";
+    os << "p99<=" << s.PercentileMs(99) << " ms, ";
+    os << "max=" << s.max_us / 1000.0 << " ms\n";
+  }
+  return os.str();
+}
+
+std::string StatsReport::ToJson() const {
+  std::ostringstream os;
+  os << "{";
+  for (int32_t i = 0; i != kNumStatsStages; ++i) {
+    const auto &s = stages[i];
+    if (i) {
+      os << ", ";
+    }
+    os << "\"" << StatsStageName(static_cast<StatsStage>(i)) << "\": {";
+    os << "\"count\": " << s.count << ", ";
+    os << "\"total_ms\": " << s.total_us / 1000.0 << ", ";
+    os << "\"mean_ms\": " << s.MeanMs() << ", ";
+    os << "\"p50_ms\": " << s.PercentileMs(50) << ", ";
+    os << "\"p95_ms\": " << s.PercentileMs(95) << ", ";
+    os << "\"p99_ms\": " << s.PercentileMs(99) << ", ";
+    os << "\"max_ms\": " << s.max_us / 1000.0 << ", ";
+    os << "\"histogram\": [";
+    for (int32_t k = 0; k != kNumStatsBuckets; ++k) {
+      if (k) {
+        os << ", ";
+      }
+      os << s.histogram[k];
+    }
+    os << "]}";
+  }
+  os << "}";
+  return os.str();
+}
+
+void Stats::Add(StatsStage stage, int64_t us) {
+  auto &s = stages_[static_cast<int32_t>(stage)];
+  s.count.fetch_add(1, std::memory_order_relaxed);
+  s.total_us.fetch_add(us, std::memory_order_relaxed);
+  s.histogram[BucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+
+  int64_t max_us = s.max_us.load(std::memory_order_relaxed);
+  while (us > max_us && !s.max_us.compare_exchange_weak(
+                            max_us, us, std::memory_order_relaxed)) {
+  }
+}
+
+StatsReport Stats::Get() const {
+  StatsReport ans;
+  for (int32_t i = 0; i != kNumStatsStages; ++i) {
+    const auto &src = stages_[i];
+    auto &dst = ans.stages[i];
+    dst.count = src.count.load(std::memory_order_relaxed);
+    dst.total_us = src.total_us.load(std::memory_order_relaxed);
+    dst.max_us = src.max_us.load(std::memory_order_relaxed);
+    for (int32_t k = 0; k != kNumStatsBuckets; ++k) {
+      dst.histogram[k] = src.histogram[k].load(std::memory_order_relaxed);
+    }
+  }
+  return ans;
+}
+
+void Stats::Reset() {
+  for (auto &s : stages_) {
+    s.count = 0;
+    s.total_us = 0;
+    s.max_us = 0;
+    for (auto &h : s.histogram) {
+      h = 0;
+    }
+  }
+}
+
+#if SHERPA_NCNN_ENABLE_STATS
+
+// The innermost timer of the current thread
+static thread_local ScopedStageTimer *current_timer = nullptr;
+
+ScopedStageTimer::ScopedStageTimer(StatsStage stage, Stats *stats,
+                                   Stats *stats2)
+    : stage_(stage),
+      stats_(stats),
+      stats2_(stats2),
+      parent_(current_timer),
+      start_(std::chrono::steady_clock::now()) {
+  if (!stats_ && !stats2_ && parent_) {
+    stats_ = parent_->stats_;
+    stats2_ = parent_->stats2_;
+  }
+  current_timer = this;
+}
+
+ScopedStageTimer::~ScopedStageTimer() {
+  int64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start_)
+                           .count();
+
+  int64_t us = std::max<int64_t>(elapsed_us - nested_us_, 0);
+  if (stats_) {
+    stats_->Add(stage_, us);
+  }
+
+  if (stats2_) {
+    stats2_->Add(stage_, us);
+  }
+
+  if (parent_) {
+    parent_->nested_us_ += elapsed_us;
+  }
+  current_timer = parent_;
+}
+
+#endif  // SHERPA_NCNN_ENABLE_STATS
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,129 @@
+// sherpa-ncnn/csrc/stats.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_STATS_H_
+#define SHERPA_NCNN_CSRC_STATS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <string>
+
+namespace sherpa_ncnn {
+
+// Stages of speech recognition whose time is measured
+enum class StatsStage : int32_t {
+  kFeature = 0,  // feature extraction, e.g., fbank
+  kEncoder = 1,  // running the encoder network
+  kDecoder = 2,  // running the decoder network
+  kJoiner = 3,   // running the joiner network
+  kSearch = 4,   // decoding, excluding the decoder and joiner networks
+};
+
+constexpr int32_t kNumStatsStages = 5;
+
+// Number of buckets of a latency histogram. Bucket 0 counts calls that
+// take less than 1 microsecond. Bucket i (i > 0) counts calls that take
+// [2^(i-1), 2^i) microseconds. The last bucket also counts slower calls.
+constexpr int32_t kNumStatsBuckets = 32;
+
+const char *StatsStageName(StatsStage stage);
+
+struct StageStats {
+  int64_t count = 0;
+  int64_t total_us = 0;
+  int64_t max_us = 0;
+  std::array<int64_t, kNumStatsBuckets> histogram{};
+
+  double MeanMs() const {
+    return count ? total_us / 1000.0 / count : 0;
+  }
+
+  // Return an upper bound of the given percentile in milliseconds,
+  // estimated from the histogram.
+  // @param p A value in the range [0, 100]
+  double PercentileMs(float p) const;
+};
+
+// A copy of the statistics at some point in time
+struct StatsReport {
+  std::array<StageStats, kNumStatsStages> stages;
+
+  const StageStats &operator[](StatsStage stage) const {
+    return stages[static_cast<int32_t>(stage)];
+  }
+
+  std::string ToString() const;
+  std::string ToJson() const;
+};
+
+/** Accumulates the time spent in each stage.
+ *
+ * It is safe to call Add() and Get() from different threads at the
+ * same time. Counters are updated with relaxed atomic operations, so
+ * Get() does not block Add().
+ */
+class Stats {
+ public:
+  void Add(StatsStage stage, int64_t us);
+
+  StatsReport Get() const;
+
+  void Reset();
+
+ private:
+  struct AtomicStageStats {
+    std::atomic<int64_t> count{0};
+    std::atomic<int64_t> total_us{0};
+    std::atomic<int64_t> max_us{0};
+    std::array<std::atomic<int64_t>, kNumStatsBuckets> histogram{};
+  };
+
+  std::array<AtomicStageStats, kNumStatsStages> stages_;
+};
+
+#if SHERPA_NCNN_ENABLE_STATS
+
+/** Measure the time from its construction to its destruction and add it
+ * to up to two Stats objects, e.g., one for a stream and one for the
+ * recognizer.
+ *
+ * Timers can be nested on the same thread. Only the time not spent in
+ * nested timers is added, so the stages do not overlap. A timer without
+ * Stats objects uses those of the enclosing timer, so that code deep
+ * down, e.g., in a decoder, does not need to know where the time goes.
+ */
+class ScopedStageTimer {
+ public:
+  explicit ScopedStageTimer(StatsStage stage, Stats *stats = nullptr,
+                            Stats *stats2 = nullptr);
+  ~ScopedStageTimer();
+
+  ScopedStageTimer(const ScopedStageTimer &) = delete;
+  ScopedStageTimer &operator=(const ScopedStageTimer &) = delete;
+
+ private:
+  StatsStage stage_;
+  Stats *stats_;
+  Stats *stats2_;
+  ScopedStageTimer *parent_;
+  std::chrono::steady_clock::time_point start_;
+  int64_t nested_us_ = 0;
+};
+
+#else
+
+// It is compiled out if SHERPA_NCNN_ENABLE_STATS is not set
+class ScopedStageTimer {
+ public:
+  explicit ScopedStageTimer(StatsStage /*stage*/, Stats * /*stats*/ = nullptr,
+                            Stats * /*stats2*/ = nullptr) {}
+};
+
+#endif  // SHERPA_NCNN_ENABLE_STATS
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_STATS_H_
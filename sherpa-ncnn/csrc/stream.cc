@@ -18,22 +18,82 @@
 
 #include "sherpa-ncnn/csrc/stream.h"
 
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <iostream>
+#include <mutex>  // NOLINT
 #include <utility>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/metrics.h"
 
 namespace sherpa_ncnn {
 
 class Stream::Impl {
  public:
-  explicit Impl(const FeatureExtractorConfig &config,
-                ContextGraphPtr context_graph)
-      : feat_extractor_(config), context_graph_(context_graph) {}
+  Impl(const FeatureExtractorConfig &config, ContextGraphPtr context_graph,
+       ContextGraphPtr overlay_context_graph)
+      : feat_extractor_(config),
+        context_graph_(context_graph),
+        overlay_context_graph_(overlay_context_graph) {
+    GetOnlineAsrMetrics().active_streams->Inc();
+  }
+
+  ~Impl() {
+    // Queued samples reference this object, so wait for them
+    WaitForFeatures();
+
+    const auto &metrics = GetOnlineAsrMetrics();
+    metrics.active_streams->Dec();
+    metrics.queued_chunks->Add(-queued_chunks_);
+  }
+
+  void SetFeaturePipeline(std::shared_ptr<FeaturePipeline> pipeline) {
+    pipeline_ = std::move(pipeline);
+  }
+
+  bool HasFeaturePipeline() const { return pipeline_ != nullptr; }
+
+  FeatureExtractor *GetFeatureExtractor() { return &feat_extractor_; }
+
+  // Called after the features of this stream are computed together with
+  // those of other streams. us is its share of the time.
+  void OnFeaturesComputed(int64_t us) {
+#if SHERPA_NCNN_ENABLE_STATS
+    stats_.Add(StatsStage::kFeature, us);
+    if (shared_stats_) {
+      shared_stats_->Add(StatsStage::kFeature, us);
+    }
+#endif
+    UpdateQueuedChunks();
+  }
 
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n) {
-    feat_extractor_.AcceptWaveform(sampling_rate, waveform, n);
+    if (pipeline_) {
+      Enqueue({sampling_rate, std::vector<float>(waveform, waveform + n),
+               false});
+      return;
+    }
+
+    ComputeFeatures(sampling_rate, waveform, n);
   }
 
-  void InputFinished() { feat_extractor_.InputFinished(); }
+  void InputFinished() {
+    if (pipeline_) {
+      Enqueue({0, {}, true});
+      return;
+    }
+
+    feat_extractor_.InputFinished();
+    UpdateQueuedChunks();
+  }
+
+  void WaitForFeatures() {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    queue_cond_.wait(lock, [this] { return !scheduled_; });
+  }
 
   int32_t NumFramesReady() const {
     return feat_extractor_.NumFramesReady() - start_frame_index_;
@@ -48,23 +108,34 @@ class Stream::Impl {
   }
 
   void Reset() {
-    start_frame_index_ += num_processed_frames_;
-    num_processed_frames_ = 0;
+    start_frame_index_ += num_processed_frames_.exchange(0);
+    UpdateQueuedChunks();
   }
 
   void Finalize() {
-    if (!context_graph_) return;
+    if (!context_graph_ && !overlay_context_graph_) return;
     auto &cur = result_.hyps;
     for (auto iter = cur.begin(); iter != cur.end(); ++iter) {
-      auto context_res = context_graph_->Finalize(iter->second.context_state);
-      iter->second.log_prob += context_res.first;
-      iter->second.context_state = context_res.second;
+      if (context_graph_) {
+        auto context_res =
+            context_graph_->Finalize(iter->second.context_state);
+        iter->second.log_prob += context_res.first;
+        iter->second.context_state = context_res.second;
+      }
+
+      if (overlay_context_graph_) {
+        auto context_res =
+            overlay_context_graph_->Finalize(iter->second.overlay_context_state);
+        iter->second.log_prob += context_res.first;
+        iter->second.overlay_context_state = context_res.second;
+      }
     }
-    auto hyp = result_.hyps.GetMostProbable(true);
-    result_.tokens = std::move(hyp.ys);
+    result_.SetBestPath(result_.hyps.GetMostProbable(true));
   }
 
-  int32_t &GetNumProcessedFrames() { return num_processed_frames_; }
+  std::atomic<int32_t> &GetNumProcessedFrames() {
+    return num_processed_frames_;
+  }
 
   void SetResult(const DecoderResult &r) {
     int32_t offset = result_.frame_offset;
@@ -80,18 +151,157 @@ class Stream::Impl {
 
   const ContextGraphPtr &GetContextGraph() const { return context_graph_; }
 
+  const ContextGraphPtr &GetOverlayContextGraph() const {
+    return overlay_context_graph_;
+  }
+
+  void SetContextGraph(ContextGraphPtr context_graph, int32_t version) {
+    auto &cur = result_.hyps;
+    for (auto iter = cur.begin(); iter != cur.end(); ++iter) {
+      auto &hyp = iter->second;
+      if (context_graph_ && hyp.context_state) {
+        // cancel the boosting score of partial matches
+        hyp.log_prob += context_graph_->Finalize(hyp.context_state).first;
+      }
+      hyp.context_state = context_graph ? context_graph->Root() : nullptr;
+    }
+
+    context_graph_ = std::move(context_graph);
+    context_graph_version_ = version;
+  }
+
+  int32_t GetContextGraphVersion() const { return context_graph_version_; }
+
+  Stats &GetStats() { return stats_; }
+
+  void SetSharedStats(std::shared_ptr<Stats> stats) {
+    shared_stats_ = std::move(stats);
+  }
+
+  void SetChunkSize(int32_t segment, int32_t offset) {
+    segment_ = segment;
+    offset_ = offset;
+    UpdateQueuedChunks();
+  }
+
+  void UpdateQueuedChunks() {
+    if (offset_ <= 0) {
+      return;
+    }
+
+    // See Recognizer::IsReady()
+    int32_t pending = NumFramesReady() - num_processed_frames_;
+    int32_t n = pending > segment_ ? (pending - segment_ - 1) / offset_ + 1 : 0;
+
+    // It may be called from the thread feeding audio and the thread
+    // decoding the stream at the same time
+    int32_t old = queued_chunks_.exchange(n);
+    if (n != old) {
+      GetOnlineAsrMetrics().queued_chunks->Add(n - old);
+    }
+  }
+
+  void SetOverlayContextGraph(ContextGraphPtr overlay_context_graph) {
+    auto &cur = result_.hyps;
+    for (auto iter = cur.begin(); iter != cur.end(); ++iter) {
+      auto &hyp = iter->second;
+      if (overlay_context_graph_ && hyp.overlay_context_state) {
+        hyp.log_prob +=
+            overlay_context_graph_->Finalize(hyp.overlay_context_state).first;
+      }
+      hyp.overlay_context_state =
+          overlay_context_graph ? overlay_context_graph->Root() : nullptr;
+    }
+
+    overlay_context_graph_ = std::move(overlay_context_graph);
+  }
+
+ private:
+  struct Chunk {
+    int32_t sampling_rate;
+    std::vector<float> samples;
+    bool input_finished;
+  };
+
+  void ComputeFeatures(int32_t sampling_rate, const float *waveform,
+                       int32_t n) {
+    {
+      ScopedStageTimer timer(StatsStage::kFeature, &stats_,
+                             shared_stats_.get());
+      feat_extractor_.AcceptWaveform(sampling_rate, waveform, n);
+    }
+    UpdateQueuedChunks();
+  }
+
+  void Enqueue(Chunk chunk) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    queue_.push_back(std::move(chunk));
+    if (!scheduled_) {
+      // At most one task per stream is in the pipeline, so chunks of a
+      // stream are processed in order
+      scheduled_ = true;
+      pipeline_->Submit([this] { ProcessQueue(); });
+    }
+  }
+
+  // It runs on a thread of pipeline_
+  void ProcessQueue() {
+    while (true) {
+      Chunk chunk;
+      {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (queue_.empty()) {
+          scheduled_ = false;
+          // Note: The stream may be destroyed once we release the lock
+          queue_cond_.notify_all();
+          return;
+        }
+        chunk = std::move(queue_.front());
+        queue_.pop_front();
+      }
+
+      if (chunk.input_finished) {
+        feat_extractor_.InputFinished();
+        UpdateQueuedChunks();
+      } else {
+        ComputeFeatures(chunk.sampling_rate, chunk.samples.data(),
+                        chunk.samples.size());
+      }
+    }
+  }
+
  private:
   FeatureExtractor feat_extractor_;
   ContextGraphPtr context_graph_;
-  int32_t num_processed_frames_ = 0;  // before subsampling
-  int32_t start_frame_index_ = 0;
+  ContextGraphPtr overlay_context_graph_;
+  int32_t context_graph_version_ = 0;
+  Stats stats_;
+  std::shared_ptr<Stats> shared_stats_;
+  int32_t segment_ = 0;
+  int32_t offset_ = 0;
+  std::atomic<int32_t> queued_chunks_{0};
+  // They are read by UpdateQueuedChunks() on threads of pipeline_ while
+  // the decoding thread updates them
+  std::atomic<int32_t> num_processed_frames_{0};  // before subsampling
+  std::atomic<int32_t> start_frame_index_{0};
   DecoderResult result_;
   std::vector<ncnn::Mat> states_;
+
+  std::shared_ptr<FeaturePipeline> pipeline_;
+  std::mutex queue_mutex_;
+  std::condition_variable queue_cond_;
+  // Samples not yet processed by pipeline_. Protected by queue_mutex_.
+  std::deque<Chunk> queue_;
+  // True if a task for this stream is in pipeline_.
+  // Protected by queue_mutex_.
+  bool scheduled_ = false;
 };
 
 Stream::Stream(const FeatureExtractorConfig &config,
-               ContextGraphPtr context_graph)
-    : impl_(std::make_unique<Impl>(config, context_graph)) {}
+               ContextGraphPtr context_graph,
+               ContextGraphPtr overlay_context_graph)
+    : impl_(std::make_unique<Impl>(config, context_graph,
+                                   overlay_context_graph)) {}
 
 Stream::~Stream() = default;
 
@@ -100,8 +310,55 @@ void Stream::AcceptWaveform(int32_t sampling_rate, const float *waveform,
   impl_->AcceptWaveform(sampling_rate, waveform, n);
 }
 
+void Stream::AcceptWaveforms(Stream *const *streams, int32_t n,
+                             int32_t sampling_rate,
+                             const float *const *waveforms,
+                             const int32_t *num_samples) {
+  std::vector<Impl *> impls;
+  std::vector<FeatureExtractor *> extractors;
+  std::vector<const float *> batch_waveforms;
+  std::vector<int32_t> batch_num_samples;
+
+  for (int32_t i = 0; i != n; ++i) {
+    Impl *impl = streams[i]->impl_.get();
+    if (impl->HasFeaturePipeline()) {
+      impl->AcceptWaveform(sampling_rate, waveforms[i], num_samples[i]);
+      continue;
+    }
+
+    impls.push_back(impl);
+    extractors.push_back(impl->GetFeatureExtractor());
+    batch_waveforms.push_back(waveforms[i]);
+    batch_num_samples.push_back(num_samples[i]);
+  }
+
+  if (impls.empty()) {
+    return;
+  }
+
+  int32_t num_batch = impls.size();
+
+  auto start = std::chrono::steady_clock::now();
+  FeatureExtractor::AcceptWaveforms(extractors.data(), num_batch,
+                                    sampling_rate, batch_waveforms.data(),
+                                    batch_num_samples.data());
+  int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now() - start)
+                   .count();
+
+  for (auto *impl : impls) {
+    impl->OnFeaturesComputed(us / num_batch);
+  }
+}
+
 void Stream::InputFinished() { impl_->InputFinished(); }
 
+void Stream::SetFeaturePipeline(std::shared_ptr<FeaturePipeline> pipeline) {
+  impl_->SetFeaturePipeline(std::move(pipeline));
+}
+
+void Stream::WaitForFeatures() { impl_->WaitForFeatures(); }
+
 int32_t Stream::NumFramesReady() const { return impl_->NumFramesReady(); }
 
 bool Stream::IsLastFrame(int32_t frame) const {
@@ -116,7 +373,7 @@ void Stream::Reset() { impl_->Reset(); }
 
 void Stream::Finalize() { impl_->Finalize(); }
 
-int32_t &Stream::GetNumProcessedFrames() {
+std::atomic<int32_t> &Stream::GetNumProcessedFrames() {
   return impl_->GetNumProcessedFrames();
 }
 
@@ -133,4 +390,36 @@ std::vector<ncnn::Mat> &Stream::GetStates() { return impl_->GetStates(); }
 const ContextGraphPtr &Stream::GetContextGraph() const {
   return impl_->GetContextGraph();
 }
+
+const ContextGraphPtr &Stream::GetOverlayContextGraph() const {
+  return impl_->GetOverlayContextGraph();
+}
+
+void Stream::SetContextGraph(ContextGraphPtr context_graph,
+                             int32_t version /*= 0*/) {
+  impl_->SetContextGraph(std::move(context_graph), version);
+}
+
+int32_t Stream::GetContextGraphVersion() const {
+  return impl_->GetContextGraphVersion();
+}
+
+void Stream::SetOverlayContextGraph(ContextGraphPtr overlay_context_graph) {
+  impl_->SetOverlayContextGraph(std::move(overlay_context_graph));
+}
+
+Stats &Stream::GetStats() { return impl_->GetStats(); }
+
+StatsReport Stream::GetStatsReport() const { return impl_->GetStats().Get(); }
+
+void Stream::SetSharedStats(std::shared_ptr<Stats> stats) {
+  impl_->SetSharedStats(std::move(stats));
+}
+
+void Stream::SetChunkSize(int32_t segment, int32_t offset) {
+  impl_->SetChunkSize(segment, offset);
+}
+
+void Stream::UpdateQueuedChunks() { impl_->UpdateQueuedChunks(); }
+
 }  // namespace sherpa_ncnn
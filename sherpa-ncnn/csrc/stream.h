@@ -19,18 +19,30 @@
 #ifndef SHERPA_NCNN_CSRC_STREAM_H_
 #define SHERPA_NCNN_CSRC_STREAM_H_
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
 #include "sherpa-ncnn/csrc/context-graph.h"
 #include "sherpa-ncnn/csrc/decoder.h"
+#include "sherpa-ncnn/csrc/feature-pipeline.h"
 #include "sherpa-ncnn/csrc/features.h"
+#include "sherpa-ncnn/csrc/stats.h"
 
 namespace sherpa_ncnn {
 class Stream {
  public:
+  /**
+   * @param config Config for the feature extractor
+   * @param context_graph If not null, it contains hotwords. It is usually
+   *                      shared by all streams of a recognizer.
+   * @param overlay_context_graph If not null, it contains extra hotwords
+   *                              for this stream only. Its scores are
+   *                              added to those from context_graph.
+   */
   explicit Stream(const FeatureExtractorConfig &config = {},
-                  ContextGraphPtr context_graph = nullptr);
+                  ContextGraphPtr context_graph = nullptr,
+                  ContextGraphPtr overlay_context_graph = nullptr);
   ~Stream();
 
   /**
@@ -44,6 +56,23 @@ class Stream {
    */
   void AcceptWaveform(int32_t sampling_rate, const float *waveform, int32_t n);
 
+  /** Same as calling AcceptWaveform() on each of the given streams, but
+   * features of streams without a feature pipeline are computed in one
+   * batch, so that frames of different streams share the SIMD lanes of
+   * the fbank computation. Samples of streams with a feature pipeline are
+   * queued as in AcceptWaveform().
+   *
+   * @param streams Distinct streams.
+   * @param n Number of streams.
+   * @param sampling_rate The sampling rate of all of the waveforms.
+   * @param waveforms waveforms[i] contains num_samples[i] samples for
+   *                  streams[i].
+   */
+  static void AcceptWaveforms(Stream *const *streams, int32_t n,
+                              int32_t sampling_rate,
+                              const float *const *waveforms,
+                              const int32_t *num_samples);
+
   /**
    * InputFinished() tells the class you won't be providing any
    * more waveform.  This will help flush out the last frame or two
@@ -52,6 +81,22 @@ class Stream {
    */
   void InputFinished();
 
+  /** Compute features on the threads of the given pipeline.
+   *
+   * AcceptWaveform() and InputFinished() then only queue the samples
+   * and return, so that the caller is not blocked by feature extraction.
+   * Frames become visible to NumFramesReady() once they are computed.
+   *
+   * It must be called before AcceptWaveform().
+   */
+  void SetFeaturePipeline(std::shared_ptr<FeaturePipeline> pipeline);
+
+  /** Block until all queued samples are processed. It returns at once
+   * if no pipeline is set. Call it after InputFinished() to make sure
+   * that all frames are available before decoding the remaining chunks.
+   */
+  void WaitForFeatures();
+
   int32_t NumFramesReady() const;
 
   /** Note: IsLastFrame() will only ever return true if you have called
@@ -83,7 +128,8 @@ class Stream {
   // Initially, it is 0. It is always less than NumFramesReady().
   //
   // The returned reference is valid as long as this object is alive.
-  int32_t &GetNumProcessedFrames();
+  // It is atomic since the feature pipeline reads it while decoding.
+  std::atomic<int32_t> &GetNumProcessedFrames();
 
   void SetResult(const DecoderResult &r);
   DecoderResult &GetResult();
@@ -97,6 +143,58 @@ class Stream {
    */
   const ContextGraphPtr &GetContextGraph() const;
 
+  /**
+   * Get the per-stream context graph that is used together with
+   * GetContextGraph().
+   *
+   * @return Return null if there are no hotwords specific to this stream.
+   */
+  const ContextGraphPtr &GetOverlayContextGraph() const;
+
+  /**
+   * Replace the context graph of this stream.
+   *
+   * Boosting scores of partial matches against the old graph are
+   * cancelled and all hypotheses restart from the root of the new graph.
+   * It must not be called while the stream is being decoded.
+   *
+   * @param context_graph The new graph. Null to disable hotwords.
+   * @param version It is used by the recognizer to find streams that have
+   *                an outdated graph. See Recognizer::SetHotwords().
+   */
+  void SetContextGraph(ContextGraphPtr context_graph, int32_t version = 0);
+
+  int32_t GetContextGraphVersion() const;
+
+  /**
+   * Replace the per-stream context graph. Like SetContextGraph(), it
+   * must not be called while the stream is being decoded.
+   */
+  void SetOverlayContextGraph(ContextGraphPtr overlay_context_graph);
+
+  /** Time spent on this stream in each stage.
+   *
+   * Feature extraction is measured in AcceptWaveform(). The other stages
+   * are measured by Recognizer::DecodeStream().
+   */
+  Stats &GetStats();
+  StatsReport GetStatsReport() const;
+
+  /** Time spent in each stage is also added to the given object, which
+   * is usually shared by all streams of a recognizer. The stream keeps
+   * it alive, so the recognizer may be destroyed first.
+   */
+  void SetSharedStats(std::shared_ptr<Stats> stats);
+
+  /** Set the number of frames per chunk and the number of frames between
+   * two chunks of the model. They are used only to report the number of
+   * queued chunks in GetOnlineAsrMetrics().
+   */
+  void SetChunkSize(int32_t segment, int32_t offset);
+
+  // The recognizer calls it after changing GetNumProcessedFrames()
+  void UpdateQueuedChunks();
+
  private:
   class Impl;
   std::unique_ptr<Impl> impl_;
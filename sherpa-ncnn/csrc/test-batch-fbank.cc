@@ -0,0 +1,210 @@
+// sherpa-ncnn/csrc/test-batch-fbank.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+// It checks that OnlineBatchFbank produces the same features as
+// knf::OnlineFbank, for a single stream and for several streams whose
+// frames are computed together.
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "kaldi-native-fbank/csrc/online-feature.h"
+#include "sherpa-ncnn/csrc/batch-fbank.h"
+
+static int32_t num_failures = 0;
+
+static std::vector<float> GenerateWaveform(int32_t n, int32_t seed = 0) {
+  constexpr float kPi = 3.14159265358979f;
+  std::mt19937 gen(20250101 + seed);
+  std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+
+  std::vector<float> ans(n);
+  for (int32_t i = 0; i != n; ++i) {
+    float t = i / 16000.0f;
+    ans[i] = 0.3f * std::sin(2 * kPi * 440 * t) +
+             0.2f * std::sin(2 * kPi * 1234 * t) + noise(gen);
+  }
+  return ans;
+}
+
+// Compare frames [start, end) and the number of frames
+static bool Compare(const char *name, knf::OnlineFbank *expected,
+                    const sherpa_ncnn::OnlineBatchFbank &actual,
+                    int32_t start, int32_t end) {
+  if (expected->NumFramesReady() != actual.NumFramesReady()) {
+    fprintf(stderr, "%s: expected %d frames, got %d\n", name,
+            expected->NumFramesReady(), actual.NumFramesReady());
+    return false;
+  }
+
+  int32_t dim = expected->Dim();
+  if (actual.Dim() != dim) {
+    fprintf(stderr, "%s: expected dim %d, got %d\n", name, dim, actual.Dim());
+    return false;
+  }
+
+  for (int32_t f = start; f < end; ++f) {
+    const float *e = expected->GetFrame(f);
+    const float *a = actual.GetFrame(f);
+    for (int32_t i = 0; i != dim; ++i) {
+      float tol = 2e-3f * std::max(1.0f, std::abs(e[i]));
+      if (!(std::abs(e[i] - a[i]) <= tol)) {
+        fprintf(stderr, "%s: frame %d, bin %d: expected %f, got %f\n", name,
+                f, i, e[i], a[i]);
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+static knf::FbankOptions GetOptions(bool snip_edges) {
+  knf::FbankOptions opts;
+  opts.frame_opts.dither = 0;
+  opts.frame_opts.snip_edges = snip_edges;
+  opts.frame_opts.samp_freq = 16000;
+  opts.mel_opts.num_bins = 80;
+  opts.mel_opts.high_freq = -400;
+  return opts;
+}
+
+// Feed the waveform in chunks of chunk_size samples. If pop is true,
+// every frame is popped from both after it has been compared.
+static void TestHelper(bool snip_edges, int32_t chunk_size, bool pop) {
+  char name[128];
+  snprintf(name, sizeof(name), "snip_edges=%d, chunk_size=%d, pop=%d",
+           snip_edges, chunk_size, pop);
+
+  knf::FbankOptions opts = GetOptions(snip_edges);
+
+  knf::OnlineFbank expected(opts);
+  sherpa_ncnn::OnlineBatchFbank actual(opts);
+
+  std::vector<float> waveform = GenerateWaveform(16000 + 1234);
+  int32_t num_samples = waveform.size();
+
+  int32_t num_compared = 0;
+  for (int32_t start = 0; start < num_samples; start += chunk_size) {
+    int32_t n = std::min(chunk_size, num_samples - start);
+    expected.AcceptWaveform(16000, waveform.data() + start, n);
+    actual.AcceptWaveform(16000, waveform.data() + start, n);
+
+    int32_t num_frames = expected.NumFramesReady();
+    if (!Compare(name, &expected, actual, num_compared, num_frames)) {
+      ++num_failures;
+      return;
+    }
+
+    if (pop) {
+      expected.Pop(num_frames - num_compared);
+      actual.Pop(num_frames - num_compared);
+    }
+    num_compared = num_frames;
+  }
+
+  // It flushes the last frames if snip_edges is false
+  expected.InputFinished();
+  actual.InputFinished();
+
+  int32_t num_frames = expected.NumFramesReady();
+  if (!Compare(name, &expected, actual, num_compared, num_frames)) {
+    ++num_failures;
+    return;
+  }
+
+  if (num_frames == 0) {
+    fprintf(stderr, "%s: no frames\n", name);
+    ++num_failures;
+  }
+}
+
+// Feed num_streams streams with OnlineBatchFbank::AcceptWaveforms().
+// Streams use different chunk sizes, so each call computes a different
+// number of frames per stream, often fewer than the number of lanes.
+static void TestMultipleStreams(bool snip_edges, int32_t num_streams) {
+  char name[128];
+  snprintf(name, sizeof(name), "snip_edges=%d, num_streams=%d", snip_edges,
+           num_streams);
+
+  knf::FbankOptions opts = GetOptions(snip_edges);
+
+  std::vector<std::unique_ptr<knf::OnlineFbank>> expected;
+  std::vector<std::unique_ptr<sherpa_ncnn::OnlineBatchFbank>> actual;
+  std::vector<std::vector<float>> waveforms;
+  for (int32_t i = 0; i != num_streams; ++i) {
+    expected.push_back(std::make_unique<knf::OnlineFbank>(opts));
+    actual.push_back(std::make_unique<sherpa_ncnn::OnlineBatchFbank>(opts));
+    waveforms.push_back(GenerateWaveform(8000 + 321 * i, i));
+  }
+
+  std::vector<int32_t> num_sent(num_streams);
+  while (true) {
+    std::vector<sherpa_ncnn::OnlineBatchFbank *> fbanks;
+    std::vector<const float *> samples;
+    std::vector<int32_t> sizes;
+
+    for (int32_t i = 0; i != num_streams; ++i) {
+      int32_t chunk_size = 37 + 211 * i;
+      int32_t num_samples = waveforms[i].size();
+      int32_t n = std::min(chunk_size, num_samples - num_sent[i]);
+      if (n == 0) {
+        continue;
+      }
+
+      const float *p = waveforms[i].data() + num_sent[i];
+      expected[i]->AcceptWaveform(16000, p, n);
+
+      fbanks.push_back(actual[i].get());
+      samples.push_back(p);
+      sizes.push_back(n);
+      num_sent[i] += n;
+    }
+
+    if (fbanks.empty()) {
+      break;
+    }
+
+    sherpa_ncnn::OnlineBatchFbank::AcceptWaveforms(
+        fbanks.data(), fbanks.size(), samples.data(), sizes.data());
+  }
+
+  for (int32_t i = 0; i != num_streams; ++i) {
+    expected[i]->InputFinished();
+    actual[i]->InputFinished();
+
+    int32_t num_frames = expected[i]->NumFramesReady();
+    if (!Compare(name, expected[i].get(), *actual[i], 0, num_frames)) {
+      ++num_failures;
+      return;
+    }
+  }
+}
+
+int32_t main() {
+  for (bool snip_edges : {true, false}) {
+    for (int32_t chunk_size : {1, 37, 160, 400, 1601, 100000}) {
+      for (bool pop : {false, true}) {
+        TestHelper(snip_edges, chunk_size, pop);
+      }
+    }
+
+    for (int32_t num_streams : {1, 3, 11}) {
+      TestMultipleStreams(snip_edges, num_streams);
+    }
+  }
+
+  if (num_failures != 0) {
+    fprintf(stderr, "%d test(s) failed\n", num_failures);
+    return -1;
+  }
+
+  return 0;
+}
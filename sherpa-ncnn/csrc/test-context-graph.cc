@@ -70,12 +70,37 @@ static void TestCustomizeNonStrict() {
   TestHelper(queries, 5, false);
 }
 
+static void TestPhrase() {
+  std::vector<std::vector<int32_t>> contexts = {{1, 2, 3}, {1, 2}, {4}};
+  std::vector<std::string> phrases = {"abc", "ab", "d"};
+  auto context_graph = sherpa_ncnn::ContextGraph(contexts, 1, {}, phrases);
+
+  auto state = context_graph.Root();
+  for (int32_t t : {1, 2}) {
+    state = std::get<1>(context_graph.ForwardOneStep(state, t));
+  }
+  assert(state->is_end);
+  assert(context_graph.Phrase(state) == "ab");
+
+  auto res = context_graph.ForwardOneStep(state, 3);
+  assert(std::get<2>(res) != nullptr);
+  assert(context_graph.Phrase(std::get<2>(res)) == "abc");
+
+  res = context_graph.ForwardOneStep(std::get<1>(res), 4);
+  assert(context_graph.Phrase(std::get<2>(res)) == "d");
+
+  // unknown tokens go back to the root
+  res = context_graph.ForwardOneStep(std::get<1>(res), 100);
+  assert(std::get<1>(res) == context_graph.Root());
+  assert(std::get<2>(res) == nullptr);
+}
+
 static void Benchmark() {
   std::random_device rd;
   std::mt19937 mt(rd());
   std::uniform_int_distribution<int32_t> char_dist(0, 25);
   std::uniform_int_distribution<int32_t> len_dist(3, 8);
-  for (int32_t num = 10; num <= 10000; num *= 10) {
+  for (int32_t num = 10; num <= 100000; num *= 10) {
     std::vector<std::vector<int32_t>> contexts;
     for (int32_t i = 0; i < num; ++i) {
       std::vector<int32_t> tmp;
@@ -92,6 +117,27 @@ static void Benchmark() {
         std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
     fprintf(stderr, "Construct context graph for %d item takes %d us.\n", num,
             static_cast<int32_t>(duration.count()));
+
+    int32_t num_steps = 1000000;
+    std::vector<int32_t> tokens(num_steps);
+    for (auto &t : tokens) {
+      t = char_dist(mt);
+    }
+
+    float total_scores = 0;
+    auto state = context_graph.Root();
+    start = std::chrono::high_resolution_clock::now();
+    for (auto t : tokens) {
+      auto res = context_graph.ForwardOneStep(state, t, false);
+      total_scores += std::get<0>(res);
+      state = std::get<1>(res);
+    }
+    stop = std::chrono::high_resolution_clock::now();
+    duration =
+        std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+    fprintf(stderr, "  %d steps take %d us (%d states, score: %.2f).\n",
+            num_steps, static_cast<int32_t>(duration.count()),
+            context_graph.NumStates(), total_scores);
   }
 }
 
@@ -100,6 +146,7 @@ int32_t main() {
   TestBasicNonStrict();
   TestCustomize();
   TestCustomizeNonStrict();
+  TestPhrase();
   Benchmark();
   return 0;
 }
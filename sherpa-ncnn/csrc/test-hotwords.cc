@@ -0,0 +1,76 @@
+// sherpa-ncnn/csrc/test-hotwords.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/hotwords.h"
+#include "sherpa-ncnn/csrc/symbol-table.h"
+
+static int32_t num_failures = 0;
+
+static void Expect(bool ok, const std::string &hotwords, bool expected) {
+  if (ok != expected) {
+    fprintf(stderr, "ParseHotwords(\"%s\") returned %d, expected %d\n",
+            hotwords.c_str(), ok, expected);
+    ++num_failures;
+  }
+}
+
+static void TestScores(const sherpa_ncnn::SymbolTable &sym) {
+  std::vector<std::vector<int32_t>> token_ids;
+  std::vector<float> scores;
+
+  std::string hotwords =
+      "▁HE LL O :1.5/▁WORLD/▁HE LL O ▁WORLD :-2e-1/HELLO WORLD :2";
+  bool ok = sherpa_ncnn::ParseHotwords(hotwords, sym, &token_ids, &scores);
+  Expect(ok, hotwords, true);
+
+  std::vector<std::vector<int32_t>> expected_ids = {
+      {1, 2, 3}, {4}, {1, 2, 3, 4}, {1, 2, 3, 4}};
+  std::vector<float> expected_scores = {1.5f, 0.0f, -0.2f, 2.0f};
+  if (token_ids != expected_ids || scores != expected_scores) {
+    fprintf(stderr, "Wrong result for \"%s\"\n", hotwords.c_str());
+    for (size_t i = 0; i != scores.size(); ++i) {
+      fprintf(stderr, "  %d tokens, score %f\n",
+              static_cast<int32_t>(token_ids[i].size()), scores[i]);
+    }
+    ++num_failures;
+  }
+}
+
+static void TestMalformedScores(const sherpa_ncnn::SymbolTable &sym) {
+  for (const char *hotwords :
+       {"▁HE LL O :abc", "▁HE LL O :", "▁HE LL O :1.5x", "▁HE LL O :inf",
+        "▁HE LL O :nan", "▁HE LL O :1e99", "▁WORLD/▁HE LL O :-"}) {
+    std::vector<std::vector<int32_t>> token_ids;
+    std::vector<float> scores;
+    bool ok = sherpa_ncnn::ParseHotwords(hotwords, sym, &token_ids, &scores);
+    Expect(ok, hotwords, false);
+  }
+}
+
+int32_t main() {
+  std::string filename = "test-hotwords-tokens.txt";
+  {
+    std::ofstream os(filename);
+    os << "<blk> 0\n▁HE 1\nLL 2\nO 3\n▁WORLD 4\n";
+  }
+  sherpa_ncnn::SymbolTable sym(filename);
+  remove(filename.c_str());
+
+  TestScores(sym);
+  TestMalformedScores(sym);
+
+  if (num_failures != 0) {
+    fprintf(stderr, "%d test(s) failed\n", num_failures);
+    return -1;
+  }
+
+  return 0;
+}
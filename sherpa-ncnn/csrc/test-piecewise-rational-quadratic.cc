@@ -0,0 +1,80 @@
+// sherpa-ncnn/csrc/test-piecewise-rational-quadratic.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/piecewise-rational-quadratic.h"
+
+static constexpr int32_t kNumBins = 10;
+static constexpr int32_t kFilterChannels = 192;
+static constexpr float kTailBound = 5.0f;
+
+// Number of parameters per position
+static constexpr int32_t kStride = 3 * kNumBins - 1;
+
+static int32_t num_failures = 0;
+
+static void RandomFill(std::mt19937 *gen, float a, float b,
+                       std::vector<float> *v) {
+  std::uniform_real_distribution<float> dist(a, b);
+  for (auto &f : *v) {
+    f = dist(*gen);
+  }
+}
+
+static void TestHelper(int32_t n, bool reverse) {
+  std::mt19937 gen(n);
+
+  std::vector<float> h(n * kStride);
+  std::vector<float> x(n);
+
+  // some inputs are outside [-tail_bound, tail_bound]
+  RandomFill(&gen, -30, 30, &h);
+  RandomFill(&gen, -6, 6, &x);
+
+  std::vector<float> expected(n);
+  std::vector<float> y(n);
+
+  sherpa_ncnn::PiecewiseRationalQuadraticTransformReference(
+      h.data(), kStride, x.data(), n, kNumBins, kFilterChannels, kTailBound,
+      reverse, expected.data());
+
+  sherpa_ncnn::PiecewiseRationalQuadraticTransform(
+      h.data(), kStride, x.data(), n, kNumBins, kFilterChannels, kTailBound,
+      reverse, y.data());
+
+  for (int32_t i = 0; i != n; ++i) {
+    float tol = 1e-4f * (1 + std::abs(expected[i]));
+    // It also fails if y[i] is nan
+    if (!(std::abs(y[i] - expected[i]) <= tol)) {
+      fprintf(stderr,
+              "n: %d, reverse: %d, position %d: expected %f, got %f, "
+              "x: %f\n",
+              n, reverse, i, expected[i], y[i], x[i]);
+      ++num_failures;
+      return;
+    }
+  }
+}
+
+static void TestTransform() {
+  for (int32_t n : {1, 7, 16, 17, 100, 1000}) {
+    TestHelper(n, true);
+    TestHelper(n, false);
+  }
+}
+
+int32_t main() {
+  TestTransform();
+
+  if (num_failures != 0) {
+    fprintf(stderr, "%d test(s) failed\n", num_failures);
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,277 @@
+// sherpa-ncnn/csrc/test-wave-reader.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+// It checks that WaveFileReader parses the header of a wave file, reads
+// samples of each channel, handles truncated files and rejects files
+// that are not PCM encoded.
+
+#include <stdio.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "sherpa-ncnn/csrc/wave-reader.h"
+
+static int32_t num_failures = 0;
+
+static void Expect(bool ok, const char *name, const char *what) {
+  if (!ok) {
+    fprintf(stderr, "%s: %s\n", name, what);
+    ++num_failures;
+  }
+}
+
+template <typename T>
+static void Append(std::string *s, T value) {
+  s->append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+// Return a 44-byte wave header, which is followed by data_size bytes
+// of samples.
+static std::string WaveHeader(int16_t audio_format, int16_t num_channels,
+                              int32_t sample_rate, int16_t bits_per_sample,
+                              int32_t data_size) {
+  int16_t block_align = num_channels * bits_per_sample / 8;
+
+  std::string s;
+  s.append("RIFF");
+  Append<int32_t>(&s, 36 + data_size);
+  s.append("WAVE");
+  s.append("fmt ");
+  Append<int32_t>(&s, 16);
+  Append<int16_t>(&s, audio_format);
+  Append<int16_t>(&s, num_channels);
+  Append<int32_t>(&s, sample_rate);
+  Append<int32_t>(&s, sample_rate * block_align);
+  Append<int16_t>(&s, block_align);
+  Append<int16_t>(&s, bits_per_sample);
+  s.append("data");
+  Append<int32_t>(&s, data_size);
+  return s;
+}
+
+static void WriteFile(const std::string &filename, const std::string &s) {
+  std::ofstream os(filename, std::ofstream::binary);
+  os.write(s.data(), s.size());
+}
+
+// Sample i of channel c in the 16-bit test files
+static int16_t Int16Sample(int32_t i, int32_t c) {
+  return static_cast<int16_t>((i * 37 + c * 1000) % 65536 - 32768);
+}
+
+static void TestInt16(int32_t num_channels) {
+  char name[64];
+  snprintf(name, sizeof(name), "int16, num_channels=%d", num_channels);
+
+  int32_t num_frames = 1000;
+  std::string s = WaveHeader(1, num_channels, 16000, 16,
+                             num_frames * num_channels * 2);
+  for (int32_t i = 0; i != num_frames; ++i) {
+    for (int32_t c = 0; c != num_channels; ++c) {
+      Append<int16_t>(&s, Int16Sample(i, c));
+    }
+  }
+
+  std::string filename = "test-wave-reader-int16.wav";
+  WriteFile(filename, s);
+
+  sherpa_ncnn::WaveFileReader reader(filename);
+  Expect(reader.IsOk(), name, "IsOk() is false");
+  Expect(reader.SampleRate() == 16000, name, "wrong sample rate");
+  Expect(reader.NumChannels() == num_channels, name, "wrong channels");
+  Expect(reader.NumFrames() == num_frames, name, "wrong number of frames");
+
+  // Read all channels in chunks whose size does not divide num_frames
+  std::vector<std::vector<float>> samples;
+  int32_t num_read = 0;
+  int32_t n;
+  bool same = true;
+  while ((n = reader.Read(333, &samples)) > 0) {
+    same = same && static_cast<int32_t>(samples.size()) == num_channels;
+    for (int32_t c = 0; same && c != num_channels; ++c) {
+      same = static_cast<int32_t>(samples[c].size()) == n;
+      for (int32_t i = 0; same && i != n; ++i) {
+        same = samples[c][i] == Int16Sample(num_read + i, c) / 32768.0f;
+      }
+    }
+    num_read += n;
+  }
+  Expect(same, name, "wrong samples from Read(n, samples)");
+  Expect(num_read == num_frames, name, "wrong number of samples read");
+  Expect(reader.Tell() == num_frames, name, "wrong Tell() at the end");
+
+  // Read one channel after seeking back
+  int32_t c = num_channels - 1;
+  reader.Seek(990);
+  std::vector<float> buf(100);
+  n = reader.Read(c, buf.size(), buf.data());
+  Expect(n == 10, name, "Read(channel) past the end");
+  same = true;
+  for (int32_t i = 0; i != n; ++i) {
+    same = same && buf[i] == Int16Sample(990 + i, c) / 32768.0f;
+  }
+  Expect(same, name, "wrong samples from Read(channel, n, samples)");
+  Expect(reader.Read(c, buf.size(), buf.data()) == 0, name,
+         "Read() at the end returned samples");
+  Expect(reader.Read(num_channels, 1, buf.data()) == 0, name,
+         "Read() accepted an invalid channel");
+
+  reader.Seek(-5);
+  Expect(reader.Tell() == 0, name, "Seek() is not clamped to 0");
+
+  if (num_channels == 1) {
+    // It should agree with ReadWave()
+    int32_t sampling_rate = -1;
+    bool is_ok = false;
+    std::vector<float> expected =
+        sherpa_ncnn::ReadWave(filename, &sampling_rate, &is_ok);
+    std::vector<float> actual(num_frames);
+    reader.Read(0, num_frames, actual.data());
+
+    same = is_ok && static_cast<int32_t>(expected.size()) == num_frames;
+    for (int32_t i = 0; same && i != num_frames; ++i) {
+      same = std::abs(expected[i] - actual[i]) < 1e-6f;
+    }
+    Expect(same, name, "different from ReadWave()");
+  }
+
+  remove(filename.c_str());
+}
+
+static void TestOtherFormats() {
+  std::string filename = "test-wave-reader-other.wav";
+  std::vector<float> buf(4);
+
+  {
+    std::string s = WaveHeader(1, 1, 8000, 8, 4);
+    for (uint8_t v : {0, 64, 128, 255}) {
+      Append<uint8_t>(&s, v);
+    }
+    WriteFile(filename, s);
+
+    sherpa_ncnn::WaveFileReader reader(filename);
+    int32_t n = reader.Read(0, buf.size(), buf.data());
+    Expect(reader.IsOk() && reader.SampleRate() == 8000 && n == 4 &&
+               buf[0] == -1 && buf[1] == -0.5f && buf[2] == 0 &&
+               buf[3] == 127 / 128.0f,
+           "uint8", "wrong samples");
+  }
+
+  {
+    std::string s = WaveHeader(1, 1, 16000, 32, 16);
+    for (int32_t v : {INT32_MIN, -(1 << 30), 0, 1 << 30}) {
+      Append<int32_t>(&s, v);
+    }
+    WriteFile(filename, s);
+
+    sherpa_ncnn::WaveFileReader reader(filename);
+    int32_t n = reader.Read(0, buf.size(), buf.data());
+    Expect(reader.IsOk() && n == 4 && buf[0] == -1 && buf[1] == -0.5f &&
+               buf[2] == 0 && buf[3] == 0.5f,
+           "int32", "wrong samples");
+  }
+
+  {
+    std::string s = WaveHeader(3, 1, 16000, 32, 16);
+    for (float v : {-1.0f, -0.25f, 0.0f, 0.75f}) {
+      Append<float>(&s, v);
+    }
+    WriteFile(filename, s);
+
+    sherpa_ncnn::WaveFileReader reader(filename);
+    int32_t n = reader.Read(0, buf.size(), buf.data());
+    Expect(reader.IsOk() && n == 4 && buf[0] == -1 && buf[1] == -0.25f &&
+               buf[2] == 0 && buf[3] == 0.75f,
+           "float32", "wrong samples");
+  }
+
+  remove(filename.c_str());
+}
+
+static void TestTruncated() {
+  std::string filename = "test-wave-reader-truncated.wav";
+
+  // The header claims 1000 stereo frames, but the file contains
+  // only 500 frames and half of another one.
+  std::string s = WaveHeader(1, 2, 16000, 16, 1000 * 4);
+  for (int32_t i = 0; i != 500 * 2 + 1; ++i) {
+    Append<int16_t>(&s, static_cast<int16_t>(i));
+  }
+  WriteFile(filename, s);
+  {
+    sherpa_ncnn::WaveFileReader reader(filename);
+    Expect(reader.IsOk(), "truncated data", "IsOk() is false");
+    Expect(reader.NumFrames() == 500, "truncated data",
+           "the incomplete frame is counted");
+
+    std::vector<std::vector<float>> samples;
+    int32_t n = reader.Read(1000, &samples);
+    Expect(n == 500 && samples[1][499] == 999 / 32768.0f, "truncated data",
+           "wrong samples");
+    Expect(reader.Read(1000, &samples) == 0 && samples[0].empty(),
+           "truncated data", "Read() past the end returned samples");
+  }
+
+  // The file ends in the middle of the header
+  WriteFile(filename, WaveHeader(1, 1, 16000, 16, 0).substr(0, 30));
+  {
+    sherpa_ncnn::WaveFileReader reader(filename);
+    Expect(!reader.IsOk(), "truncated header", "IsOk() is true");
+
+    std::vector<float> buf(10);
+    Expect(reader.Read(0, buf.size(), buf.data()) == 0, "truncated header",
+           "Read() returned samples");
+  }
+
+  remove(filename.c_str());
+
+  sherpa_ncnn::WaveFileReader reader("test-wave-reader-missing.wav");
+  Expect(!reader.IsOk(), "missing file", "IsOk() is true");
+}
+
+static void TestNonPcm() {
+  std::string filename = "test-wave-reader-non-pcm.wav";
+
+  struct Format {
+    const char *name;
+    int16_t audio_format;
+    int16_t bits_per_sample;
+  };
+
+  for (const Format &f : {Format{"ADPCM", 2, 16}, Format{"A-law", 6, 8},
+                          Format{"extensible", -2, 16},
+                          Format{"16-bit float", 3, 16},
+                          Format{"24-bit PCM", 1, 24}}) {
+    std::string s = WaveHeader(f.audio_format, 1, 16000, f.bits_per_sample,
+                               8 * f.bits_per_sample / 8);
+    s.append(8 * f.bits_per_sample / 8, '\0');
+    WriteFile(filename, s);
+
+    sherpa_ncnn::WaveFileReader reader(filename);
+    Expect(!reader.IsOk(), f.name, "it is not rejected");
+  }
+
+  remove(filename.c_str());
+}
+
+int32_t main() {
+  TestInt16(1);
+  TestInt16(2);
+  TestInt16(3);
+  TestOtherFormats();
+  TestTruncated();
+  TestNonPcm();
+
+  if (num_failures != 0) {
+    fprintf(stderr, "%d test(s) failed\n", num_failures);
+    return -1;
+  }
+
+  return 0;
+}
@@ -22,6 +22,7 @@
 #include <utility>
 
 #include "sherpa-ncnn/csrc/circular-buffer.h"
+#include "sherpa-ncnn/csrc/metrics.h"
 #include "sherpa-ncnn/csrc/silero-vad-model.h"
 
 namespace sherpa_ncnn {
@@ -97,7 +98,7 @@ class VoiceActivityDetector::Impl {
         segment.start = start_;
         segment.samples = std::move(s);
 
-        segments_.push(std::move(segment));
+        PushSegment(std::move(segment));
 
         buffer_.Pop(end - buffer_.Head());
       }
@@ -149,7 +150,7 @@ class VoiceActivityDetector::Impl {
     segment.start = start_;
     segment.samples = std::move(s);
 
-    segments_.push(std::move(segment));
+    PushSegment(std::move(segment));
 
     buffer_.Pop(end - buffer_.Head());
     start_ = -1;
@@ -160,6 +161,15 @@ class VoiceActivityDetector::Impl {
   const SileroVadModelConfig &GetConfig() const { return config_; }
 
  private:
+  void PushSegment(SpeechSegment segment) {
+    const auto &metrics = GetVadMetrics();
+    metrics.segments->Inc();
+    metrics.speech_seconds->Inc(static_cast<double>(segment.samples.size()) /
+                                config_.sample_rate);
+
+    segments_.push(std::move(segment));
+  }
+
   std::queue<SpeechSegment> segments_;
 
   std::unique_ptr<SileroVadModel> model_;
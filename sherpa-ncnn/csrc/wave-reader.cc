@@ -18,12 +18,29 @@
 
 #include "sherpa-ncnn/csrc/wave-reader.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <utility>
 #include <vector>
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if __ARM_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SHERPA_NCNN_WAVE_READER_SSE2 1
+#include <emmintrin.h>
+#endif
+
 #include "platform.h"  // NOLINT
 
 namespace sherpa_ncnn {
@@ -75,18 +92,16 @@ because sox uses WAVE_FORMAT_EXTENSIBLE, which is not easy to support
 in sherpa-ncnn.
  */
 
-// Read a wave file of mono-channel.
-// Return its samples normalized to the range [-1, 1).
-std::vector<float> ReadWaveImpl(std::istream &is, int32_t *sampling_rate,
-                                bool *is_ok) {
-  WaveHeader header{};
+// Read and validate the header of a wave file. On success, the stream
+// is positioned at the first sample of the data chunk.
+bool ReadWaveHeader(std::istream &is, WaveHeader *p) {
+  WaveHeader &header = *p;
   is.read(reinterpret_cast<char *>(&header.chunk_id), sizeof(header.chunk_id));
 
   //                        F F I R
   if (header.chunk_id != 0x46464952) {
     NCNN_LOGE("Expected chunk_id RIFF. Given: 0x%08x\n", header.chunk_id);
-    *is_ok = false;
-    return {};
+    return false;
   }
 
   is.read(reinterpret_cast<char *>(&header.chunk_size),
@@ -97,8 +112,7 @@ std::vector<float> ReadWaveImpl(std::istream &is, int32_t *sampling_rate,
   //                      E V A W
   if (header.format != 0x45564157) {
     NCNN_LOGE("Expected format WAVE. Given: 0x%08x\n", header.format);
-    *is_ok = false;
-    return {};
+    return false;
   }
 
   is.read(reinterpret_cast<char *>(&header.subchunk1_id),
@@ -121,8 +135,7 @@ std::vector<float> ReadWaveImpl(std::istream &is, int32_t *sampling_rate,
   if (header.subchunk1_id != 0x20746d66) {
     NCNN_LOGE("Expected subchunk1_id 0x20746d66. Given: 0x%08x\n",
               header.subchunk1_id);
-    *is_ok = false;
-    return {};
+    return false;
   }
 
   // NAudio uses 18
@@ -130,8 +143,7 @@ std::vector<float> ReadWaveImpl(std::istream &is, int32_t *sampling_rate,
   if (header.subchunk1_size != 16 &&
       header.subchunk1_size != 18) {  // 16 for PCM
     NCNN_LOGE("Expected subchunk1_size 16. Given: %d\n", header.subchunk1_size);
-    *is_ok = false;
-    return {};
+    return false;
   }
 
   is.read(reinterpret_cast<char *>(&header.audio_format),
@@ -148,17 +160,15 @@ std::vector<float> ReadWaveImpl(std::istream &is, int32_t *sampling_rate,
       NCNN_LOGE("We don't support WAVE_FORMAT_EXTENSIBLE files.");
     }
 
-    *is_ok = false;
-    return {};
+    return false;
   }
 
   is.read(reinterpret_cast<char *>(&header.num_channels),
           sizeof(header.num_channels));
 
-  if (header.num_channels != 1) {  // we support only single channel for now
-    NCNN_LOGE(
-        "Warning: %d channels are found. We only use the first channel.\n",
-        header.num_channels);
+  if (header.num_channels < 1) {
+    NCNN_LOGE("Invalid number of channels: %d\n", header.num_channels);
+    return false;
   }
 
   is.read(reinterpret_cast<char *>(&header.sample_rate),
@@ -178,24 +188,21 @@ std::vector<float> ReadWaveImpl(std::istream &is, int32_t *sampling_rate,
     NCNN_LOGE("Incorrect byte rate: %d. Expected: %d", header.byte_rate,
               (header.sample_rate * header.num_channels *
                header.bits_per_sample / 8));
-    *is_ok = false;
-    return {};
+    return false;
   }
 
   if (header.block_align !=
       (header.num_channels * header.bits_per_sample / 8)) {
     NCNN_LOGE("Incorrect block align: %d. Expected: %d\n", header.block_align,
               (header.num_channels * header.bits_per_sample / 8));
-    *is_ok = false;
-    return {};
+    return false;
   }
 
   if (header.bits_per_sample != 8 && header.bits_per_sample != 16 &&
       header.bits_per_sample != 32) {
     NCNN_LOGE("Expected bits_per_sample 8, 16 or 32. Given: %d\n",
               header.bits_per_sample);
-    *is_ok = false;
-    return {};
+    return false;
   }
 
   if (header.subchunk1_size == 18) {
@@ -210,8 +217,7 @@ std::vector<float> ReadWaveImpl(std::istream &is, int32_t *sampling_rate,
           "Extra size should be 0 for wave from NAudio. Current extra size "
           "%d\n",
           extra_size);
-      *is_ok = false;
-      return {};
+      return false;
     }
   }
 
@@ -223,10 +229,147 @@ std::vector<float> ReadWaveImpl(std::istream &is, int32_t *sampling_rate,
 
   header.SeekToDataChunk(is);
   if (!is) {
+    return false;
+  }
+
+  return true;
+}
+
+// The following functions convert n samples of one channel to float.
+// frames points to the first byte of the first frame, channel is the
+// channel to extract and num_channels is the number of interleaved channels.
+//
+// frames may have any alignment since the data chunk can start at an odd
+// offset, so samples are read with memcpy or unaligned vector loads.
+// The vector loops never read past the last frame.
+
+template <typename T>
+T LoadSample(const char *p) {
+  T ans;
+  std::memcpy(&ans, p, sizeof(T));
+  return ans;
+}
+
+void ConvertInt16(const char *frames, int32_t channel, int32_t num_channels,
+                  int32_t n, float *dst) {
+  constexpr float kScale = 1.0f / 32768;
+  int32_t i = 0;
+
+#if __ARM_NEON
+  float32x4_t scale = vdupq_n_f32(kScale);
+  if (num_channels == 1 || num_channels == 2) {
+    for (; i + 8 <= n; i += 8) {
+      const uint8_t *p =
+          reinterpret_cast<const uint8_t *>(frames) + 2 * num_channels * i;
+      int16x8_t v = vreinterpretq_s16_u8(vld1q_u8(p));
+      if (num_channels == 2) {
+        // 8 frames. Deinterleave and keep the requested channel
+        int16x8_t w = vreinterpretq_s16_u8(vld1q_u8(p + 16));
+        int16x8x2_t u = vuzpq_s16(v, w);
+        v = channel == 0 ? u.val[0] : u.val[1];
+      }
+      vst1q_f32(dst + i,
+                vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+      vst1q_f32(dst + i + 4,
+                vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+    }
+  }
+#elif SHERPA_NCNN_WAVE_READER_SSE2
+  __m128 scale = _mm_set1_ps(kScale);
+  if (num_channels == 1) {
+    for (; i + 8 <= n; i += 8) {
+      __m128i v = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(frames + 2 * i));
+      // sign extend to int32
+      __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+      __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+      _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+      _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+  } else if (num_channels == 2) {
+    for (; i + 4 <= n; i += 4) {
+      // 4 frames. Channel 0 is in the lower half of each int32 and
+      // channel 1 in the upper half
+      __m128i v = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(frames + 4 * i));
+      __m128i x = channel == 0 ? _mm_srai_epi32(_mm_slli_epi32(v, 16), 16)
+                               : _mm_srai_epi32(v, 16);
+      _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+    }
+  }
+#endif
+
+  for (; i < n; ++i) {
+    dst[i] = LoadSample<int16_t>(frames + 2 * (i * num_channels + channel)) *
+             kScale;
+  }
+}
+
+void ConvertInt32(const char *frames, int32_t channel, int32_t num_channels,
+                  int32_t n, float *dst) {
+  constexpr float kScale = 1.0f / 2147483648.0f;
+  int32_t i = 0;
+
+  if (num_channels == 1) {
+#if __ARM_NEON
+    float32x4_t scale = vdupq_n_f32(kScale);
+    for (; i + 4 <= n; i += 4) {
+      int32x4_t v = vreinterpretq_s32_u8(
+          vld1q_u8(reinterpret_cast<const uint8_t *>(frames) + 4 * i));
+      vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(v), scale));
+    }
+#elif SHERPA_NCNN_WAVE_READER_SSE2
+    __m128 scale = _mm_set1_ps(kScale);
+    for (; i + 4 <= n; i += 4) {
+      __m128i v = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(frames + 4 * i));
+      _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+#endif
+  }
+
+  for (; i < n; ++i) {
+    dst[i] = LoadSample<int32_t>(frames + 4 * (i * num_channels + channel)) *
+             kScale;
+  }
+}
+
+void ConvertUint8(const char *frames, int32_t channel, int32_t num_channels,
+                  int32_t n, float *dst) {
+  const uint8_t *src = reinterpret_cast<const uint8_t *>(frames) + channel;
+  for (int32_t i = 0; i < n; ++i) {
+    dst[i] = src[i * num_channels] / 128.0f - 1;
+  }
+}
+
+void ConvertFloat(const char *frames, int32_t channel, int32_t num_channels,
+                  int32_t n, float *dst) {
+  if (num_channels == 1) {
+    std::memcpy(dst, frames, n * sizeof(float));
+    return;
+  }
+
+  for (int32_t i = 0; i < n; ++i) {
+    dst[i] = LoadSample<float>(frames + 4 * (i * num_channels + channel));
+  }
+}
+
+// Read a wave file of mono-channel.
+// Return its samples normalized to the range [-1, 1).
+std::vector<float> ReadWaveImpl(std::istream &is, int32_t *sampling_rate,
+                                bool *is_ok) {
+  WaveHeader header{};
+  if (!ReadWaveHeader(is, &header)) {
     *is_ok = false;
     return {};
   }
 
+  if (header.num_channels != 1) {  // we support only single channel for now
+    NCNN_LOGE(
+        "Warning: %d channels are found. We only use the first channel.\n",
+        header.num_channels);
+  }
+
   *sampling_rate = header.sample_rate;
 
   std::vector<float> ans;
@@ -360,4 +503,234 @@ std::vector<float> ReadWave(std::istream &is, int32_t expected_sampling_rate,
   return samples;
 }
 
+class WaveFileReader::Impl {
+ public:
+  explicit Impl(const std::string &filename) {
+    std::ifstream is(filename, std::ifstream::binary);
+    if (!is) {
+      NCNN_LOGE("Failed to open %s", filename.c_str());
+      return;
+    }
+
+    if (!ReadWaveHeader(is, &header_)) {
+      NCNN_LOGE("Failed to read the header of %s", filename.c_str());
+      return;
+    }
+
+    if (!IsSupported()) {
+      NCNN_LOGE(
+          "Unsupported %d bits per sample and audio format: %d. Supported "
+          "values are: 8, 16, 32.",
+          header_.bits_per_sample, header_.audio_format);
+      return;
+    }
+
+    data_offset_ = is.tellg();
+    is.seekg(0, std::istream::end);
+    int64_t file_size = is.tellg();
+
+    // subchunk2_size is unsigned. Some tools write a wrong value
+    // for files that are written in a streaming way, so we also check
+    // the file size here.
+    int64_t data_size =
+        std::min<int64_t>(static_cast<uint32_t>(header_.subchunk2_size),
+                          file_size - data_offset_);
+    num_frames_ = data_size / header_.block_align;
+
+#if !defined(_WIN32)
+    is.close();
+    if (!Map(filename, file_size)) {
+      return;
+    }
+#else
+    is_ = std::move(is);
+#endif
+
+    is_ok_ = true;
+  }
+
+  ~Impl() {
+#if !defined(_WIN32)
+    if (mapped_) {
+      munmap(mapped_, mapped_size_);
+    }
+#endif
+  }
+
+  bool IsOk() const { return is_ok_; }
+
+  int32_t SampleRate() const { return header_.sample_rate; }
+
+  int32_t NumChannels() const { return header_.num_channels; }
+
+  int64_t NumFrames() const { return num_frames_; }
+
+  int64_t Tell() const { return pos_; }
+
+  void Seek(int64_t frame) {
+    pos_ = std::max<int64_t>(0, std::min(frame, num_frames_));
+  }
+
+  int32_t Read(int32_t channel, int32_t n, float *samples) {
+    if (!is_ok_ || channel < 0 || channel >= header_.num_channels) {
+      return 0;
+    }
+
+    n = static_cast<int32_t>(std::min<int64_t>(n, num_frames_ - pos_));
+    if (n <= 0) {
+      return 0;
+    }
+
+    const char *p = GetFrames(n);
+    if (!p) {
+      return 0;
+    }
+
+    Convert(p, channel, n, samples);
+    pos_ += n;
+
+    return n;
+  }
+
+  int32_t Read(int32_t n, std::vector<std::vector<float>> *samples) {
+    samples->resize(std::max<int32_t>(header_.num_channels, 0));
+    if (!is_ok_) {
+      return 0;
+    }
+
+    n = static_cast<int32_t>(std::min<int64_t>(n, num_frames_ - pos_));
+    n = std::max(n, 0);
+
+    const char *p = n > 0 ? GetFrames(n) : nullptr;
+    if (!p) {
+      n = 0;
+    }
+
+    for (int32_t c = 0; c != header_.num_channels; ++c) {
+      auto &s = (*samples)[c];
+      s.resize(n);
+      if (n > 0) {
+        Convert(p, c, n, s.data());
+      }
+    }
+    pos_ += n;
+
+    return n;
+  }
+
+ private:
+  bool IsSupported() const {
+    switch (header_.bits_per_sample) {
+      case 8:
+      case 16:
+        return header_.audio_format == 1;
+      case 32:
+        return header_.audio_format == 1 || header_.audio_format == 3;
+      default:
+        return false;
+    }
+  }
+
+#if !defined(_WIN32)
+  bool Map(const std::string &filename, int64_t file_size) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+      NCNN_LOGE("Failed to open %s", filename.c_str());
+      return false;
+    }
+
+    void *p = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (p == MAP_FAILED) {
+      NCNN_LOGE("Failed to mmap %s", filename.c_str());
+      return false;
+    }
+
+    // We read the file from the beginning to the end
+    madvise(p, file_size, MADV_SEQUENTIAL);
+
+    mapped_ = p;
+    mapped_size_ = file_size;
+    return true;
+  }
+#endif
+
+  // Return a pointer to the raw bytes of n frames starting at pos_
+  const char *GetFrames(int32_t n) {
+    int64_t offset =
+        data_offset_ + pos_ * static_cast<int64_t>(header_.block_align);
+#if !defined(_WIN32)
+    (void)n;
+    return static_cast<const char *>(mapped_) + offset;
+#else
+    buf_.resize(static_cast<size_t>(n) * header_.block_align);
+    is_.clear();
+    is_.seekg(offset, std::istream::beg);
+    is_.read(buf_.data(), buf_.size());
+    if (!is_) {
+      NCNN_LOGE("Failed to read %d bytes", static_cast<int32_t>(buf_.size()));
+      return nullptr;
+    }
+    return buf_.data();
+#endif
+  }
+
+  void Convert(const char *frames, int32_t channel, int32_t n,
+               float *samples) const {
+    int32_t num_channels = header_.num_channels;
+
+    if (header_.bits_per_sample == 16) {
+      ConvertInt16(frames, channel, num_channels, n, samples);
+    } else if (header_.bits_per_sample == 8) {
+      ConvertUint8(frames, channel, num_channels, n, samples);
+    } else if (header_.audio_format == 1) {
+      ConvertInt32(frames, channel, num_channels, n, samples);
+    } else {
+      ConvertFloat(frames, channel, num_channels, n, samples);
+    }
+  }
+
+ private:
+  WaveHeader header_{};
+  bool is_ok_ = false;
+  int64_t data_offset_ = 0;
+  int64_t num_frames_ = 0;
+  int64_t pos_ = 0;
+
+#if !defined(_WIN32)
+  void *mapped_ = nullptr;
+  size_t mapped_size_ = 0;
+#else
+  std::ifstream is_;
+  std::vector<char> buf_;
+#endif
+};
+
+WaveFileReader::WaveFileReader(const std::string &filename)
+    : impl_(std::make_unique<Impl>(filename)) {}
+
+WaveFileReader::~WaveFileReader() = default;
+
+bool WaveFileReader::IsOk() const { return impl_->IsOk(); }
+
+int32_t WaveFileReader::SampleRate() const { return impl_->SampleRate(); }
+
+int32_t WaveFileReader::NumChannels() const { return impl_->NumChannels(); }
+
+int64_t WaveFileReader::NumFrames() const { return impl_->NumFrames(); }
+
+int64_t WaveFileReader::Tell() const { return impl_->Tell(); }
+
+void WaveFileReader::Seek(int64_t frame) { impl_->Seek(frame); }
+
+int32_t WaveFileReader::Read(int32_t channel, int32_t n, float *samples) {
+  return impl_->Read(channel, n, samples);
+}
+
+int32_t WaveFileReader::Read(int32_t n,
+                             std::vector<std::vector<float>> *samples) {
+  return impl_->Read(n, samples);
+}
+
 }  // namespace sherpa_ncnn
@@ -18,7 +18,9 @@
 #ifndef SHERPA_NCNN_CSRC_WAVE_READER_H_
 #define SHERPA_NCNN_CSRC_WAVE_READER_H_
 
+#include <cstdint>
 #include <istream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -45,6 +47,78 @@ std::vector<float> ReadWave(const std::string &filename,
 std::vector<float> ReadWave(std::istream &is, int32_t expected_sampling_rate,
                             bool *is_ok);
 
+/** Read a wave file chunk by chunk.
+
+    Unlike ReadWave(), it does not load the whole file into memory. On POSIX
+    systems, the file is memory-mapped; otherwise, it is read with buffered
+    I/O. Samples of all channels are available, so both sides of a stereo
+    recording can be decoded without reading the file twice.
+
+    Usage:
+
+      WaveFileReader reader(filename);
+      if (!reader.IsOk()) { ... }
+
+      std::vector<std::vector<float>> samples;
+      while (reader.Read(3200, &samples) > 0) {
+        stream0->AcceptWaveform(reader.SampleRate(), samples[0].data(),
+                                samples[0].size());
+        stream1->AcceptWaveform(reader.SampleRate(), samples[1].data(),
+                                samples[1].size());
+        ...
+      }
+ */
+class WaveFileReader {
+ public:
+  explicit WaveFileReader(const std::string &filename);
+  ~WaveFileReader();
+
+  WaveFileReader(const WaveFileReader &) = delete;
+  WaveFileReader &operator=(const WaveFileReader &) = delete;
+
+  // Return true if the file is opened and its header is valid
+  bool IsOk() const;
+
+  int32_t SampleRate() const;
+
+  int32_t NumChannels() const;
+
+  // Number of samples per channel in the file
+  int64_t NumFrames() const;
+
+  // Index of the next frame to read
+  int64_t Tell() const;
+
+  // Set the index of the next frame to read. It is clamped to
+  // [0, NumFrames()].
+  void Seek(int64_t frame);
+
+  /** Read samples of one channel, normalized to the range [-1, 1).
+
+      @param channel  0 <= channel < NumChannels()
+      @param n  Maximum number of samples to read.
+      @param samples  It must have space for n samples.
+
+      @return Return the number of samples read, which is 0 at the end of
+              the file.
+   */
+  int32_t Read(int32_t channel, int32_t n, float *samples);
+
+  /** Read samples of all channels, normalized to the range [-1, 1).
+
+      @param n  Maximum number of samples per channel to read.
+      @param samples On return, (*samples)[c] contains samples of channel c.
+
+      @return Return the number of samples per channel read, which is 0 at
+              the end of the file.
+   */
+  int32_t Read(int32_t n, std::vector<std::vector<float>> *samples);
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
 }  // namespace sherpa_ncnn
 
 #endif  // SHERPA_NCNN_CSRC_WAVE_READER_H_
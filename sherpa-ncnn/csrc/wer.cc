@@ -0,0 +1,77 @@
+// sherpa-ncnn/csrc/wer.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/csrc/wer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "sherpa-ncnn/csrc/text-utils.h"
+
+namespace sherpa_ncnn {
+
+std::vector<std::string> SplitWords(const std::string &text) {
+  return SplitUtf8(ToLowerCase(text));
+}
+
+int32_t EditDistance(const std::vector<std::string> &ref,
+                     const std::vector<std::string> &hyp) {
+  std::vector<int32_t> prev(hyp.size() + 1);
+  std::vector<int32_t> cur(hyp.size() + 1);
+  for (int32_t j = 0; j <= static_cast<int32_t>(hyp.size()); ++j) {
+    prev[j] = j;
+  }
+
+  for (int32_t i = 1; i <= static_cast<int32_t>(ref.size()); ++i) {
+    cur[0] = i;
+    for (int32_t j = 1; j <= static_cast<int32_t>(hyp.size()); ++j) {
+      int32_t sub = prev[j - 1] + (ref[i - 1] == hyp[j - 1] ? 0 : 1);
+      cur[j] = std::min({sub, prev[j] + 1, cur[j - 1] + 1});
+    }
+    std::swap(prev, cur);
+  }
+
+  return prev.back();
+}
+
+double ComputeWer(const std::vector<std::string> &refs,
+                  const std::vector<std::string> &hyps) {
+  int64_t num_errors = 0;
+  int64_t num_words = 0;
+  for (size_t i = 0; i != refs.size(); ++i) {
+    auto ref = SplitWords(refs[i]);
+    num_errors += EditDistance(ref, SplitWords(hyps[i]));
+    num_words += ref.size();
+  }
+
+  return num_words > 0 ? 100.0 * num_errors / num_words : 0;
+}
+
+bool ReadTranscripts(const std::string &filename,
+                     std::map<std::string, std::string> *transcripts) {
+  std::ifstream is(filename);
+  if (!is) {
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(is, line)) {
+    std::istringstream iss(line);
+    std::string utt;
+    iss >> utt;
+    if (utt.empty()) {
+      continue;
+    }
+
+    std::string text;
+    std::getline(iss >> std::ws, text);
+    (*transcripts)[utt] = text;
+  }
+
+  return true;
+}
+
+}  // namespace sherpa_ncnn
@@ -0,0 +1,37 @@
+// sherpa-ncnn/csrc/wer.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_CSRC_WER_H_
+#define SHERPA_NCNN_CSRC_WER_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace sherpa_ncnn {
+
+// Words for computing WER. Each CJK character is a word.
+std::vector<std::string> SplitWords(const std::string &text);
+
+// Number of substitutions, deletions and insertions to turn ref into hyp
+int32_t EditDistance(const std::vector<std::string> &ref,
+                     const std::vector<std::string> &hyp);
+
+// Return WER in percent of the hypotheses against the references
+double ComputeWer(const std::vector<std::string> &refs,
+                  const std::vector<std::string> &hyps);
+
+/** Read a file in the format of kaldi's text file. Each line contains
+ * an utterance ID followed by its transcript. The utterance ID is the
+ * name of the wave file without the directory and .wav.
+ *
+ * @return Return false if the file cannot be opened.
+ */
+bool ReadTranscripts(const std::string &filename,
+                     std::map<std::string, std::string> *transcripts);
+
+}  // namespace sherpa_ncnn
+
+#endif  // SHERPA_NCNN_CSRC_WER_H_
@@ -0,0 +1,27 @@
+// sherpa-ncnn/python/csrc/metrics.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/python/csrc/metrics.h"
+
+#include <string>
+
+#include "sherpa-ncnn/csrc/metrics.h"
+
+namespace sherpa_ncnn {
+
+void PybindMetrics(py::module *m) {
+  m->def(
+      "get_metrics", [] { return MetricsRegistry::Global().ToString(); },
+      "Return metrics of all recognizers, VADs and TTS engines in the "
+      "Prometheus text exposition format");
+
+  m->def(
+      "save_metrics",
+      [](const std::string &filename) {
+        return MetricsRegistry::Global().SaveToFile(filename);
+      },
+      py::arg("filename"), py::call_guard<py::gil_scoped_release>());
+}
+
+}  // namespace sherpa_ncnn
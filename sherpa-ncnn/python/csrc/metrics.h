@@ -0,0 +1,16 @@
+// sherpa-ncnn/python/csrc/metrics.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_PYTHON_CSRC_METRICS_H_
+#define SHERPA_NCNN_PYTHON_CSRC_METRICS_H_
+
+#include "sherpa-ncnn/python/csrc/sherpa-ncnn.h"
+
+namespace sherpa_ncnn {
+
+void PybindMetrics(py::module *m);
+
+}
+
+#endif  // SHERPA_NCNN_PYTHON_CSRC_METRICS_H_
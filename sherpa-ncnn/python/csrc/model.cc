@@ -49,6 +49,13 @@ Args:
     Number of threads to use for neural network computation.
   tokens:
     Path to tokens.txt
+  enable_profiling:
+    True to measure the time spent in each layer of the encoder, decoder
+    and joiner. See Recognizer.get_profiling_report().
+  execution_profile:
+    accurate, balanced or fast. It selects fp32, fp16 or int8 execution
+    for each network and the matching model files, e.g.,
+    encoder.ncnn.int8.param for fast. Empty to use the default options.
 )doc";
 
 static void PybindModelConfig(py::module *m) {
@@ -60,7 +67,9 @@ static void PybindModelConfig(py::module *m) {
                        const std::string &decoder_bin,
                        const std::string &joiner_param,
                        const std::string &joiner_bin, int32_t num_threads,
-                       const std::string &tokens) -> std::unique_ptr<PyClass> {
+                       const std::string &tokens, bool enable_profiling,
+                       const std::string &execution_profile)
+                        -> std::unique_ptr<PyClass> {
              auto ans = std::make_unique<PyClass>();
              ans->encoder_param = encoder_param;
              ans->encoder_bin = encoder_bin;
@@ -71,6 +80,8 @@ static void PybindModelConfig(py::module *m) {
              ans->tokens = tokens;
 
              ans->use_vulkan_compute = false;
+             ans->enable_profiling = enable_profiling;
+             ans->execution_profile = execution_profile;
 
              ans->encoder_opt.num_threads = num_threads;
              ans->decoder_opt.num_threads = num_threads;
@@ -81,7 +92,12 @@ static void PybindModelConfig(py::module *m) {
            py::arg("encoder_param"), py::arg("encoder_bin"),
            py::arg("decoder_param"), py::arg("decoder_bin"),
            py::arg("joiner_param"), py::arg("joiner_bin"),
-           py::arg("num_threads"), py::arg("tokens"), kModelConfigInitDoc);
+           py::arg("num_threads"), py::arg("tokens"),
+           py::arg("enable_profiling") = false,
+           py::arg("execution_profile") = "", kModelConfigInitDoc)
+      .def_readwrite("enable_profiling", &PyClass::enable_profiling)
+      .def_readwrite("execution_profile", &PyClass::execution_profile)
+      .def("validate", &PyClass::Validate);
 }
 
 void PybindModel(py::module *m) { PybindModelConfig(m); }
@@ -18,14 +18,15 @@ void PybindOfflineModelConfig(py::module *m) {
   using PyClass = OfflineModelConfig;
   py::class_<PyClass>(*m, "OfflineModelConfig")
       .def(py::init<const OfflineSenseVoiceModelConfig &, const std::string &,
-                    int32_t, bool>(),
+                    int32_t, bool, bool>(),
            py::arg("sense_voice") = OfflineSenseVoiceModelConfig(),
            py::arg("tokens") = "", py::arg("num_threads") = 1,
-           py::arg("debug") = false)
+           py::arg("debug") = false, py::arg("enable_profiling") = false)
       .def_readwrite("sense_voice", &PyClass::sense_voice)
       .def_readwrite("tokens", &PyClass::tokens)
       .def_readwrite("num_threads", &PyClass::num_threads)
       .def_readwrite("debug", &PyClass::debug)
+      .def_readwrite("enable_profiling", &PyClass::enable_profiling)
       .def("validate", &PyClass::Validate)
       .def("__str__", &PyClass::ToString);
 }
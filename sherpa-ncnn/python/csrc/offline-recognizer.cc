@@ -42,7 +42,7 @@ void PybindOfflineRecognizer(py::module *m) {
       .def(
           "create_stream",
           [](const PyClass &self) { return self.CreateStream(); },
-          py::call_guard<py::gil_scoped_release>())
+          py::keep_alive<0, 1>(), py::call_guard<py::gil_scoped_release>())
       .def("decode_stream", &PyClass::DecodeStream, py::arg("s"),
            py::call_guard<py::gil_scoped_release>())
       .def("set_config", &PyClass::SetConfig, py::arg("config"),
@@ -52,7 +52,11 @@ void PybindOfflineRecognizer(py::module *m) {
           [](const PyClass &self, std::vector<OfflineStream *> ss) {
             self.DecodeStreams(ss.data(), ss.size());
           },
-          py::arg("ss"), py::call_guard<py::gil_scoped_release>());
+          py::arg("ss"), py::call_guard<py::gil_scoped_release>())
+      .def("get_stats", &PyClass::GetStats)
+      .def("reset_stats", &PyClass::ResetStats)
+      .def("get_profiling_report", &PyClass::GetProfilingReport)
+      .def("reset_profiling", &PyClass::ResetProfiling);
 }
 
 }  // namespace sherpa_ncnn
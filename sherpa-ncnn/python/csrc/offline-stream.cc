@@ -57,7 +57,8 @@ void PybindOfflineStream(py::module *m) {
           },
           py::arg("sample_rate"), py::arg("waveform"), kAcceptWaveformUsage,
           py::call_guard<py::gil_scoped_release>())
-      .def_property_readonly("result", &PyClass::GetResult);
+      .def_property_readonly("result", &PyClass::GetResult)
+      .def("get_stats", &PyClass::GetStatsReport);
 }
 
 }  // namespace sherpa_ncnn
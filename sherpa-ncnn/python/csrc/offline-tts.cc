@@ -19,6 +19,8 @@ static void PybindGeneratedAudio(py::module *m) {
       .def(py::init<>())
       .def_readwrite("samples", &PyClass::samples)
       .def_readwrite("sample_rate", &PyClass::sample_rate)
+      .def_readwrite("tokens", &PyClass::tokens)
+      .def_readwrite("durations", &PyClass::durations)
       .def("__str__", [](PyClass &self) {
         std::ostringstream os;
         os << "GeneratedAudio(sample_rate=" << self.sample_rate << ", ";
@@ -32,17 +34,20 @@ static void PybindTtsArgs(py::module *m) {
   py::class_<PyClass>(*m, "TtsArgs")
       .def(py::init<const std::string &,
                     const std::vector<std::vector<int32_t>> &, int32_t, float,
-                    float, float>(),
+                    float, float, int64_t>(),
            py::arg("text") = "",
            py::arg("tokens") = std::vector<std::vector<int32_t>>{},
            py::arg("sid") = 0, py::arg("speed") = 1.0f,
-           py::arg("noise_scale") = 0.667f, py::arg("noise_scale_w") = 0.8f)
+           py::arg("noise_scale") = 0.667f, py::arg("noise_scale_w") = 0.8f,
+           py::arg("seed") = -1)
       .def_readwrite("text", &PyClass::text)
       .def_readwrite("tokens", &PyClass::tokens)
       .def_readwrite("sid", &PyClass::sid)
       .def_readwrite("speed", &PyClass::speed)
       .def_readwrite("noise_scale", &PyClass::noise_scale)
       .def_readwrite("noise_scale_w", &PyClass::noise_scale_w)
+      .def_readwrite("seed", &PyClass::seed)
+      .def_readwrite("return_durations", &PyClass::return_durations)
       .def("__str__", [](PyClass &self) {
         std::ostringstream os;
         os << "TtsArgs(";
@@ -70,6 +75,7 @@ static void PybindTtsArgs(py::module *m) {
         os << ", speed=" << self.speed;
         os << ", noise_scale=" << self.noise_scale;
         os << ", noise_scale_w=" << self.noise_scale_w;
+        os << ", seed=" << self.seed;
         os << ")";
         return os.str();
       });
@@ -85,12 +91,16 @@ static void PybindOfflineTtsConfig(py::module *m) {
                     const std::string &, int32_t, float>(),
            py::arg("model"), py::arg("rule_fsts") = "",
            py::arg("rule_fars") = "", py::arg("max_num_sentences") = 1,
-           py::arg("silence_scale") = 0.2)
+           py::arg("silence_scale") = 1.0)
       .def_readwrite("model", &PyClass::model)
       .def_readwrite("rule_fsts", &PyClass::rule_fsts)
       .def_readwrite("rule_fars", &PyClass::rule_fars)
       .def_readwrite("max_num_sentences", &PyClass::max_num_sentences)
       .def_readwrite("silence_scale", &PyClass::silence_scale)
+      .def_readwrite("gain", &PyClass::gain)
+      .def_readwrite("output_sample_rate", &PyClass::output_sample_rate)
+      .def_readwrite("cache_size", &PyClass::cache_size)
+      .def_readwrite("cache_dir", &PyClass::cache_dir)
       .def("validate", &PyClass::Validate)
       .def("__str__", &PyClass::ToString);
 }
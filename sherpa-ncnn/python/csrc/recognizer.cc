@@ -59,6 +59,18 @@ static void PybindRecognitionResult(py::module *m) {
           [](PyClass &self) -> std::vector<float> { return self.timestamps; });
 }
 
+static void PybindRecognitionResultDelta(py::module *m) {
+  using PyClass = RecognitionResultDelta;
+  py::class_<PyClass>(*m, "RecognitionResultDelta")
+      .def_readonly("start", &PyClass::start)
+      .def_readonly("num_stable_tokens", &PyClass::num_stable_tokens)
+      .def_readonly("text", &PyClass::text)
+      .def_readonly("tokens", &PyClass::tokens)
+      .def_readonly("stokens", &PyClass::stokens)
+      .def_readonly("timestamps", &PyClass::timestamps)
+      .def("__str__", &PyClass::ToString);
+}
+
 static void PybindRecognizerConfig(py::module *m) {
   using PyClass = RecognizerConfig;
   py::class_<PyClass>(*m, "RecognizerConfig")
@@ -70,28 +82,67 @@ static void PybindRecognizerConfig(py::module *m) {
            py::arg("enable_endpoint"), py::arg("hotwords_file") = "",
            py::arg("hotwords_score") = 1.5, kRecognizerConfigInitDoc)
       .def("__str__", &PyClass::ToString)
+      .def("validate", &PyClass::Validate)
       .def_readwrite("feat_config", &PyClass::feat_config)
       .def_readwrite("model_config", &PyClass::model_config)
       .def_readwrite("decoder_config", &PyClass::decoder_config)
       .def_readwrite("endpoint_config", &PyClass::endpoint_config)
       .def_readwrite("enable_endpoint", &PyClass::enable_endpoint)
       .def_readwrite("hotwords_file", &PyClass::hotwords_file)
-      .def_readwrite("hotwords_score", &PyClass::hotwords_score);
+      .def_readwrite("hotwords_score", &PyClass::hotwords_score)
+      .def_readwrite("feature_threads", &PyClass::feature_threads);
 }
 
 void PybindRecognizer(py::module *m) {
   PybindRecognitionResult(m);
+  PybindRecognitionResultDelta(m);
   PybindRecognizerConfig(m);
 
   using PyClass = Recognizer;
   py::class_<PyClass>(*m, "Recognizer")
       .def(py::init<const RecognizerConfig &>(), py::arg("config"))
-      .def("create_stream", &PyClass::CreateStream)
-      .def("decode_stream", &PyClass::DecodeStream, py::arg("s"))
-      .def("is_ready", &PyClass::IsReady, py::arg("s"))
-      .def("reset", &PyClass::Reset, py::arg("s"))
-      .def("is_endpoint", &PyClass::IsEndpoint, py::arg("s"))
-      .def("get_result", &PyClass::GetResult, py::arg("s"));
+      .def(
+          "create_stream",
+          [](const PyClass &self, const std::string &hotwords) {
+            if (hotwords.empty()) {
+              return self.CreateStream();
+            }
+            return self.CreateStream(hotwords);
+          },
+          py::arg("hotwords") = "", py::keep_alive<0, 1>())
+      .def("set_hotwords",
+           py::overload_cast<const std::string &, bool>(&PyClass::SetHotwords),
+           py::arg("hotwords"), py::arg("update_existing_streams") = false,
+           py::call_guard<py::gil_scoped_release>())
+      .def("set_stream_hotwords",
+           py::overload_cast<Stream *, const std::string &>(
+               &PyClass::SetHotwords, py::const_),
+           py::arg("s"), py::arg("hotwords"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("decode_stream", &PyClass::DecodeStream, py::arg("s"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("finalize_stream", &PyClass::FinalizeStream, py::arg("s"),
+           py::call_guard<py::gil_scoped_release>())
+      .def(
+          "decode_streams",
+          [](const PyClass &self, std::vector<Stream *> ss) {
+            self.DecodeStreams(ss.data(), ss.size());
+          },
+          py::arg("ss"), py::call_guard<py::gil_scoped_release>())
+      .def("is_ready", &PyClass::IsReady, py::arg("s"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("reset", &PyClass::Reset, py::arg("s"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("is_endpoint", &PyClass::IsEndpoint, py::arg("s"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("get_result", &PyClass::GetResult, py::arg("s"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("get_result_delta", &PyClass::GetResultDelta, py::arg("s"),
+           py::call_guard<py::gil_scoped_release>())
+      .def("get_stats", &PyClass::GetStats)
+      .def("reset_stats", &PyClass::ResetStats)
+      .def("get_profiling_report", &PyClass::GetProfilingReport)
+      .def("reset_profiling", &PyClass::ResetProfiling);
 }
 
 }  // namespace sherpa_ncnn
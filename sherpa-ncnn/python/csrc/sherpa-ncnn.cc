@@ -27,7 +27,9 @@
 #include "sherpa-ncnn/python/csrc/offline-recognizer.h"
 #include "sherpa-ncnn/python/csrc/offline-stream.h"
 #include "sherpa-ncnn/python/csrc/offline-tts.h"
+#include "sherpa-ncnn/python/csrc/metrics.h"
 #include "sherpa-ncnn/python/csrc/recognizer.h"
+#include "sherpa-ncnn/python/csrc/stats.h"
 #include "sherpa-ncnn/python/csrc/stream.h"
 
 namespace sherpa_ncnn {
@@ -39,6 +41,8 @@ PYBIND11_MODULE(_sherpa_ncnn, m) {
   PybindFeatures(&m);
   PybindModel(&m);
   PybindDecoder(&m);
+  PybindStats(&m);
+  PybindMetrics(&m);
   PybindStream(&m);
   PybindRecognizer(&m);
 
@@ -0,0 +1,47 @@
+// sherpa-ncnn/python/csrc/stats.cc
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#include "sherpa-ncnn/python/csrc/stats.h"
+
+#include <string>
+
+#include "sherpa-ncnn/csrc/stats.h"
+
+namespace sherpa_ncnn {
+
+static void PybindStageStats(py::module *m) {
+  using PyClass = StageStats;
+  py::class_<PyClass>(*m, "StageStats")
+      .def_readonly("count", &PyClass::count)
+      .def_property_readonly(
+          "total_ms",
+          [](const PyClass &self) { return self.total_us / 1000.0; })
+      .def_property_readonly("mean_ms", &PyClass::MeanMs)
+      .def_property_readonly(
+          "max_ms", [](const PyClass &self) { return self.max_us / 1000.0; })
+      .def_readonly("histogram", &PyClass::histogram)
+      .def("percentile_ms", &PyClass::PercentileMs, py::arg("p"));
+}
+
+void PybindStats(py::module *m) {
+  PybindStageStats(m);
+
+  using PyClass = StatsReport;
+  py::class_<PyClass>(*m, "StatsReport")
+      .def("__str__", &PyClass::ToString)
+      .def("to_json", &PyClass::ToJson)
+      .def(
+          "__getitem__",
+          [](const PyClass &self, const std::string &name) {
+            for (int32_t i = 0; i != kNumStatsStages; ++i) {
+              if (name == StatsStageName(static_cast<StatsStage>(i))) {
+                return self.stages[i];
+              }
+            }
+            throw py::key_error(name);
+          },
+          py::arg("stage"));
+}
+
+}  // namespace sherpa_ncnn
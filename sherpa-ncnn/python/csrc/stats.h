@@ -0,0 +1,16 @@
+// sherpa-ncnn/python/csrc/stats.h
+//
+// Copyright (c)  2025  Xiaomi Corporation
+
+#ifndef SHERPA_NCNN_PYTHON_CSRC_STATS_H_
+#define SHERPA_NCNN_PYTHON_CSRC_STATS_H_
+
+#include "sherpa-ncnn/python/csrc/sherpa-ncnn.h"
+
+namespace sherpa_ncnn {
+
+void PybindStats(py::module *m);
+
+}
+
+#endif  // SHERPA_NCNN_PYTHON_CSRC_STATS_H_
@@ -18,24 +18,81 @@
 
 #include "sherpa-ncnn/python/csrc/stream.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 
 #include "sherpa-ncnn/csrc/stream.h"
 
 namespace sherpa_ncnn {
 
+constexpr const char *kAcceptWaveformUsage = R"(
+Process audio samples.
+
+Args:
+  sample_rate:
+    Sample rate of the input samples.
+  waveform:
+    A 1-D array containing audio samples. A C-contiguous numpy array of
+    dtype float32 is used without a copy; samples should be normalized
+    to the range [-1, 1]. A numpy array of dtype int16 is also accepted and
+    is divided by 32768. Other inputs, e.g., a list of floats, are copied.
+)";
+
+// Number of int16 samples to convert at a time
+static constexpr int32_t kInt16ChunkSize = 3200;
+
 void PybindStream(py::module *m) {
   using PyClass = Stream;
   py::class_<PyClass>(*m, "Stream")
+      .def(
+          "accept_waveform",
+          [](PyClass &self, float sample_rate,
+             py::array_t<float, py::array::c_style> waveform) {
+            // data() needs the GIL
+            const float *p = waveform.data();
+            int32_t n = waveform.size();
+
+            py::gil_scoped_release release;
+            self.AcceptWaveform(sample_rate, p, n);
+          },
+          py::arg("sample_rate"), py::arg("waveform"), kAcceptWaveformUsage)
+      .def(
+          "accept_waveform",
+          [](PyClass &self, float sample_rate,
+             py::array_t<int16_t, py::array::c_style> waveform) {
+            const int16_t *p = waveform.data();
+            int32_t n = waveform.size();
+
+            py::gil_scoped_release release;
+
+            float buf[kInt16ChunkSize];
+            for (int32_t start = 0; start < n; start += kInt16ChunkSize) {
+              int32_t this_chunk = std::min(kInt16ChunkSize, n - start);
+              for (int32_t i = 0; i != this_chunk; ++i) {
+                buf[i] = p[start + i] / 32768.0f;
+              }
+              self.AcceptWaveform(sample_rate, buf, this_chunk);
+            }
+          },
+          py::arg("sample_rate"), py::arg("waveform"), kAcceptWaveformUsage)
       .def(
           "accept_waveform",
           [](PyClass &self, float sample_rate,
              const std::vector<float> &waveform) {
             self.AcceptWaveform(sample_rate, waveform.data(), waveform.size());
           },
+          py::arg("sample_rate"), py::arg("waveform"), kAcceptWaveformUsage,
           py::call_guard<py::gil_scoped_release>())
       .def("input_finished", &PyClass::InputFinished,
-           py::call_guard<py::gil_scoped_release>());
+           py::call_guard<py::gil_scoped_release>())
+      .def("wait_for_features", &PyClass::WaitForFeatures,
+           py::call_guard<py::gil_scoped_release>())
+      .def("get_stats", &PyClass::GetStatsReport)
+      .def_property_readonly("num_frames_ready", &PyClass::NumFramesReady)
+      .def_property_readonly("num_processed_frames", [](PyClass &self) {
+        return self.GetNumProcessedFrames().load();
+      });
 }
 
 }  // namespace sherpa_ncnn
@@ -62,9 +62,7 @@ class Recognizer(object):
 
             recognizer.accept_waveform(recognizer.sample_rate, samples_float32)
 
-            tail_paddings = np.zeros(int(recognizer.sample_rate * 0.5), dtype=np.float32)
-            recognizer.accept_waveform(recognizer.sample_rate, tail_paddings)
-
+            # It decodes the remaining audio. No tail padding is needed.
             recognizer.input_finished()
 
             print(recognizer.text)
@@ -93,6 +91,8 @@ class Recognizer(object):
         model_sample_rate: int = 16000,
         hotwords_file: str = "",
         hotwords_score: float = 1.5,
+        enable_profiling: bool = False,
+        execution_profile: str = "",
     ):
         """
         Please refer to
@@ -153,6 +153,15 @@ class Recognizer(object):
           hotwords_score:
             The scale applied to hotwords score. Used only
             when hotwords_file is not empty.
+          enable_profiling:
+            True to measure the time spent in each layer of the models.
+            See :meth:`get_profiling_report`.
+          execution_profile:
+            ``accurate``, ``balanced`` or ``fast``. It selects fp32, fp16
+            or int8 execution for each network. With ``fast``, int8 model
+            files, e.g., ``encoder_param`` with ``.param`` replaced by
+            ``.int8.param``, are used if they exist. Leave it empty to use
+            the default options.
         """
         _assert_file_exists(tokens)
         _assert_file_exists(encoder_param)
@@ -181,6 +190,8 @@ class Recognizer(object):
             joiner_bin=joiner_bin,
             num_threads=num_threads,
             tokens=tokens,
+            enable_profiling=enable_profiling,
+            execution_profile=execution_profile,
         )
 
         endpoint_config = EndpointConfig(
@@ -204,6 +215,9 @@ class Recognizer(object):
             hotwords_score=hotwords_score,
         )
 
+        if not self.config.validate():
+            raise ValueError(f"Invalid config: {self.config}")
+
         self.sample_rate = self.config.feat_config.sampling_rate
 
         self.recognizer = _Recognizer(self.config)
@@ -225,9 +239,11 @@ class Recognizer(object):
         self._decode()
 
     def input_finished(self):
-        """Signal that no more audio samples are available."""
+        """Signal that no more audio samples are available and decode the
+        remaining audio. The result is final afterwards.
+        """
         self.stream.input_finished()
-        self._decode()
+        self.recognizer.finalize_stream(self.stream)
 
     def _decode(self):
         while self.recognizer.is_ready(self.stream):
@@ -255,3 +271,29 @@ class Recognizer(object):
 
     def reset(self):
         self.recognizer.reset(self.stream)
+
+    def set_hotwords(self, hotwords: str) -> bool:
+        """Replace the hotwords without reloading the models.
+
+        Used only when decoding_method is modified_beam_search.
+
+        Args:
+          hotwords:
+            Hotwords separated by ``/`` or new lines, e.g.,
+            ``"HELLO WORLD/HI :2.0"``. Each hotword is either tokens
+            separated by spaces or text, which is split into tokens of
+            the model. An optional boosting score starting with ``:``
+            can follow it. An empty string removes all hotwords.
+        Returns:
+          Return False if the hotwords are invalid. The current hotwords
+          are kept in that case.
+        """
+        return self.recognizer.set_hotwords(
+            hotwords, update_existing_streams=True
+        )
+
+    def get_profiling_report(self) -> str:
+        """Return the time spent in each layer of the models, sorted by
+        time. It is empty unless enable_profiling is True.
+        """
+        return self.recognizer.get_profiling_report()